@@ -43,6 +43,23 @@
 
 #define XYSSL_AES_ROM_TABLES 1 /* avoid regenerating tables each time */
 
+/*
+ * Use the AES-NI instructions when the CPU has them. This needs a compiler
+ * which can build them without enabling them for the whole file.
+ */
+#if defined(HAVE_SSE2) && !defined(XYSSL_NO_AESNI)
+#  if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#    define XYSSL_HAVE_AESNI
+#    include <intrin.h>
+#    include <wmmintrin.h>
+#  elif (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)) || defined(__clang__)) && \
+        (defined(__x86_64__) || defined(__i386__))
+#    define XYSSL_HAVE_AESNI
+#    include <cpuid.h>
+#    include <wmmintrin.h>
+#  endif
+#endif
+
 /*
  * 32-bit integer manipulation macros (little endian)
  */
@@ -443,6 +460,10 @@ static void aes_gen_tables( void )
 
 #endif
 
+#if defined(XYSSL_HAVE_AESNI)
+static void aesni_setkey( aes_context *ctx );
+#endif
+
 /*
  * AES key schedule (encryption)
  */
@@ -544,6 +565,10 @@ void aes_setkey_enc( aes_context *ctx, const unsigned char *key, int keysize )
 
             break;
     }
+
+#if defined(XYSSL_HAVE_AESNI)
+    aesni_setkey( ctx );
+#endif
 }
 
 /*
@@ -595,6 +620,10 @@ void aes_setkey_dec( aes_context *ctx, const unsigned char *key, int keysize )
     *RK++ = *SK++;
 
     memset( &cty, 0, sizeof( aes_context ) );
+
+#if defined(XYSSL_HAVE_AESNI)
+    aesni_setkey( ctx );
+#endif
 }
 
 #define AES_FROUND(X0,X1,X2,X3,Y0,Y1,Y2,Y3)     \
@@ -643,6 +672,218 @@ void aes_setkey_dec( aes_context *ctx, const unsigned char *key, int keysize )
                  RT3[ ( Y0 >> 24 ) & 0xFF ];    \
 }
 
+#if defined(XYSSL_HAVE_AESNI)
+/*
+ * AES-NI support: the round keys are the same as those used by the table
+ * code (aes_setkey_dec produces the "equivalent inverse cipher" keys that
+ * AESDEC expects), so only the block operations differ.
+ */
+#if defined(_MSC_VER)
+#define AESNI_TARGET
+#else
+#define AESNI_TARGET __attribute__((target("aes,sse2")))
+#endif
+
+static int aesni_supports( void )
+{
+    static int supported = -1;
+
+    if( supported < 0 )
+    {
+#if defined(_MSC_VER)
+        int regs[4];
+
+        __cpuid( regs, 1 );
+        supported = ( regs[2] >> 25 ) & 1;
+#else
+        unsigned int a, b, c, d;
+
+        supported = __get_cpuid( 1, &a, &b, &c, &d ) ? ( c >> 25 ) & 1 : 0;
+#endif
+    }
+    return( supported );
+}
+
+/*
+ * The round keys are kept as unsigned long, which is 64 bits wide on
+ * LP64 systems, so keep a packed copy that can be loaded directly.
+ */
+static void aesni_setkey( aes_context *ctx )
+{
+    int i;
+
+    for( i = 0; i < ( ctx->nr + 1 ) * 4; i++ )
+        ctx->ni_rk[i] = (unsigned int) ctx->rk[i];
+}
+
+#define AESNI_KEY(ctx, i) _mm_loadu_si128( (const __m128i *) ( (ctx)->ni_rk + 4 * (i) ) )
+
+AESNI_TARGET
+static void aesni_load_keys( const aes_context *ctx, __m128i *keys )
+{
+    int i;
+
+    for( i = 0; i <= ctx->nr; i++ )
+        keys[i] = AESNI_KEY( ctx, i );
+}
+
+AESNI_TARGET
+static __m128i aesni_encrypt( const __m128i *keys, int nr, __m128i x )
+{
+    int i;
+
+    x = _mm_xor_si128( x, keys[0] );
+    for( i = 1; i < nr; i++ )
+        x = _mm_aesenc_si128( x, keys[i] );
+    return( _mm_aesenclast_si128( x, keys[nr] ) );
+}
+
+AESNI_TARGET
+static __m128i aesni_decrypt( const __m128i *keys, int nr, __m128i x )
+{
+    int i;
+
+    x = _mm_xor_si128( x, keys[0] );
+    for( i = 1; i < nr; i++ )
+        x = _mm_aesdec_si128( x, keys[i] );
+    return( _mm_aesdeclast_si128( x, keys[nr] ) );
+}
+
+/*
+ * A single block: each round key is loaded as it is needed, rather than
+ * copying the whole schedule first.
+ */
+AESNI_TARGET
+static void aesni_crypt_ecb( aes_context *ctx, int mode,
+                             const unsigned char input[16],
+                             unsigned char output[16] )
+{
+    __m128i x = _mm_loadu_si128( (const __m128i *) input );
+    int nr = ctx->nr, i;
+
+    x = _mm_xor_si128( x, AESNI_KEY( ctx, 0 ) );
+    if( mode == AES_DECRYPT )
+    {
+        for( i = 1; i < nr; i++ )
+            x = _mm_aesdec_si128( x, AESNI_KEY( ctx, i ) );
+        x = _mm_aesdeclast_si128( x, AESNI_KEY( ctx, nr ) );
+    }
+    else
+    {
+        for( i = 1; i < nr; i++ )
+            x = _mm_aesenc_si128( x, AESNI_KEY( ctx, i ) );
+        x = _mm_aesenclast_si128( x, AESNI_KEY( ctx, nr ) );
+    }
+    _mm_storeu_si128( (__m128i *) output, x );
+}
+
+/*
+ * CFB: the keystream blocks depend on each other, but the round keys are
+ * only loaded once for the whole buffer.
+ */
+AESNI_TARGET
+static void aesni_crypt_cfb( aes_context *ctx, int mode, int length,
+                             int *iv_off, unsigned char iv[16],
+                             const unsigned char *input,
+                             unsigned char *output )
+{
+    __m128i keys[15];
+    int c, n = *iv_off, nr = ctx->nr;
+
+    aesni_load_keys( ctx, keys );
+    while( length-- )
+    {
+        if( n == 0 )
+            _mm_storeu_si128( (__m128i *) iv,
+                aesni_encrypt( keys, nr,
+                               _mm_loadu_si128( (const __m128i *) iv ) ) );
+        c = *input++;
+        *output++ = (unsigned char)( c ^ iv[n] );
+        iv[n] = (unsigned char)( mode == AES_DECRYPT ? c : c ^ iv[n] );
+        n = (n + 1) & 0x0F;
+    }
+    *iv_off = n;
+}
+
+/*
+ * CBC decryption has no dependency between blocks, so four blocks are
+ * decrypted at a time to keep the AES unit busy.
+ */
+AESNI_TARGET
+static void aesni_crypt_cbc( aes_context *ctx, int mode, int length,
+                             unsigned char iv[16],
+                             const unsigned char *input,
+                             unsigned char *output )
+{
+    __m128i keys[15];
+    __m128i v = _mm_loadu_si128( (const __m128i *) iv );
+    int nr = ctx->nr, i;
+
+    aesni_load_keys( ctx, keys );
+    if( mode == AES_DECRYPT )
+    {
+        while( length >= 64 )
+        {
+            __m128i c0 = _mm_loadu_si128( (const __m128i *) input );
+            __m128i c1 = _mm_loadu_si128( (const __m128i *) ( input + 16 ) );
+            __m128i c2 = _mm_loadu_si128( (const __m128i *) ( input + 32 ) );
+            __m128i c3 = _mm_loadu_si128( (const __m128i *) ( input + 48 ) );
+            __m128i x0 = _mm_xor_si128( c0, keys[0] );
+            __m128i x1 = _mm_xor_si128( c1, keys[0] );
+            __m128i x2 = _mm_xor_si128( c2, keys[0] );
+            __m128i x3 = _mm_xor_si128( c3, keys[0] );
+
+            for( i = 1; i < nr; i++ )
+            {
+                x0 = _mm_aesdec_si128( x0, keys[i] );
+                x1 = _mm_aesdec_si128( x1, keys[i] );
+                x2 = _mm_aesdec_si128( x2, keys[i] );
+                x3 = _mm_aesdec_si128( x3, keys[i] );
+            }
+            x0 = _mm_xor_si128( _mm_aesdeclast_si128( x0, keys[nr] ), v );
+            x1 = _mm_xor_si128( _mm_aesdeclast_si128( x1, keys[nr] ), c0 );
+            x2 = _mm_xor_si128( _mm_aesdeclast_si128( x2, keys[nr] ), c1 );
+            x3 = _mm_xor_si128( _mm_aesdeclast_si128( x3, keys[nr] ), c2 );
+            v = c3;
+            _mm_storeu_si128( (__m128i *) output, x0 );
+            _mm_storeu_si128( (__m128i *) ( output + 16 ), x1 );
+            _mm_storeu_si128( (__m128i *) ( output + 32 ), x2 );
+            _mm_storeu_si128( (__m128i *) ( output + 48 ), x3 );
+
+            input  += 64;
+            output += 64;
+            length -= 64;
+        }
+        while( length > 0 )
+        {
+            __m128i c = _mm_loadu_si128( (const __m128i *) input );
+
+            _mm_storeu_si128( (__m128i *) output,
+                              _mm_xor_si128( aesni_decrypt( keys, nr, c ), v ) );
+            v = c;
+
+            input  += 16;
+            output += 16;
+            length -= 16;
+        }
+    }
+    else
+    {
+        while( length > 0 )
+        {
+            v = _mm_xor_si128( _mm_loadu_si128( (const __m128i *) input ), v );
+            v = aesni_encrypt( keys, nr, v );
+            _mm_storeu_si128( (__m128i *) output, v );
+
+            input  += 16;
+            output += 16;
+            length -= 16;
+        }
+    }
+    _mm_storeu_si128( (__m128i *) iv, v );
+}
+#endif /* XYSSL_HAVE_AESNI */
+
 /*
  * AES-ECB block encryption/decryption
  */
@@ -665,6 +906,14 @@ void aes_crypt_ecb( aes_context *ctx,
     if (ctx == NULL || ctx->rk == NULL)
         return;
 
+#if defined(XYSSL_HAVE_AESNI)
+    if( aesni_supports() )
+    {
+        aesni_crypt_ecb( ctx, mode, input, output );
+        return;
+    }
+#endif
+
     RK = ctx->rk;
 
     GET_ULONG_LE( X0, input,  0 ); X0 ^= *RK++;
@@ -760,6 +1009,14 @@ void aes_crypt_cbc( aes_context *ctx,
     }
 #endif
 
+#if defined(XYSSL_HAVE_AESNI)
+    if( ctx->rk != NULL && aesni_supports() )
+    {
+        aesni_crypt_cbc( ctx, mode, length, iv, input, output );
+        return;
+    }
+#endif
+
     if( mode == AES_DECRYPT )
     {
         while( length > 0 )
@@ -807,6 +1064,14 @@ void aes_crypt_cfb( aes_context *ctx,
 {
     int c, n = *iv_off;
 
+#if defined(XYSSL_HAVE_AESNI)
+    if( ctx->rk != NULL && aesni_supports() )
+    {
+        aesni_crypt_cfb( ctx, mode, length, iv_off, iv, input, output );
+        return;
+    }
+#endif
+
     if( mode == AES_DECRYPT )
     {
         while( length-- )
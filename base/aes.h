@@ -46,6 +46,7 @@ typedef struct
     int nr;                     /*!<  number of rounds  */
     unsigned long *rk;          /*!<  AES round keys    */
     unsigned long buf[68];      /*!<  unaligned data    */
+    unsigned int ni_rk[60];     /*!<  round keys packed for AES-NI */
 }
 aes_context;
 
@@ -174,6 +174,7 @@ typedef struct {
     FILE        *(*get_file)(gp_file *file);
     void         (*clearerr)(gp_file *file);
     gp_file     *(*reopen)(gp_file *f, const char *fname, const char *mode);
+    const void  *(*mmap)(gp_file *file, size_t max_size, size_t *psize);
 } gp_file_ops_t;
 
 struct gp_file_s {
@@ -317,6 +318,17 @@ gp_clearerr(gp_file *f) {
         (f->ops.clearerr)(f);
 }
 
+/* Map the whole of a regular file into memory, read only. Returns NULL
+ * if the file cannot be mapped (not a regular file, empty, larger than
+ * max_size, or no platform support). The mapping belongs to the gp_file
+ * and remains valid until it is closed. */
+static inline const void *
+gp_fmmap(gp_file *f, size_t max_size, size_t *psize) {
+    if (f->ops.mmap == NULL)
+        return NULL;
+    return (f->ops.mmap)(f, max_size, psize);
+}
+
 /* fname is always in utf8 format */
 static inline gp_file *
 gp_freopen(const char *fname, const char *mode, gp_file *f) {
@@ -648,6 +660,18 @@ FILE *gp_fdup_impl(FILE *f, const char *mode);
 
 int gp_fseekable_impl(FILE *f);
 
+/* Map a regular file (of at most max_size bytes) into memory, read only.
+ * Returns NULL if the file cannot be mapped, or is on a file system (such
+ * as a network one) where reading the mapping is likely to fail. */
+void *gp_mmap_impl(FILE *f, size_t max_size, size_t *psize);
+
+void gp_munmap_impl(void *addr, size_t size);
+
+/* Read up to count bytes, waiting only until some data is available, as a
+ * read from a pipe does. Returns the number of bytes read, 0 at EOF, or -1
+ * on error. f must not have been read through its stdio buffer. */
+int gp_read_some_impl(char *buf, size_t count, FILE *f);
+
 /* Force given file into binary mode (no eol translations, etc) */
 /* if 2nd param true, text mode if 2nd param false */
 int gp_setmode_binary_impl(FILE * pfile, bool mode);
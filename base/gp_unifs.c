@@ -31,8 +31,17 @@
 #include "stat_.h"
 #include "dirent_.h"
 #include "unistd_.h"
+#include "errno_.h"
 #include <stdlib.h>             /* for mkstemp/mktemp */
 
+#if !defined(GS_NO_FILESYSTEM) && defined(_POSIX_MAPPED_FILES) && _POSIX_MAPPED_FILES > 0
+#  include <sys/mman.h>
+#  define GP_HAVE_MMAP 1
+#  ifdef __linux__
+#    include <sys/vfs.h>
+#  endif
+#endif
+
 #if !defined(HAVE_FSEEKO)
 #define ftello ftell
 #define fseeko fseek
@@ -657,3 +666,80 @@ bool gp_fseekable_impl(FILE *f)
 
     return((bool)S_ISREG(s.st_mode));
 }
+
+#if defined(GP_HAVE_MMAP) && defined(__linux__)
+/* A page of a mapped file that can't be read raises SIGBUS rather than
+ * returning an error, which is much more likely on network file systems,
+ * so don't map files on those. */
+static bool
+gp_mmap_fs_ok(int fno)
+{
+    struct statfs fs;
+
+    if (fstatfs(fno, &fs) < 0)
+        return false;
+    switch ((unsigned long)fs.f_type) {
+        case 0x6969:		/* NFS */
+        case 0x517b:		/* SMB */
+        case 0xff534d42:	/* CIFS */
+        case 0xfe534d42:	/* SMB2 */
+        case 0x5346414f:	/* AFS */
+        case 0x73757245:	/* Coda */
+        case 0x65735546:	/* FUSE */
+        case 0x01021997:	/* 9P */
+            return false;
+        default:
+            return true;
+    }
+}
+#else
+#  define gp_mmap_fs_ok(fno) true
+#endif
+
+void *gp_mmap_impl(FILE *f, size_t max_size, size_t *psize)
+{
+#ifdef GP_HAVE_MMAP
+    struct stat s;
+    void *addr;
+    int fno;
+
+    fno = fileno(f);
+    if (fno < 0)
+        return NULL;
+    if (fstat(fno, &s) < 0 || !S_ISREG(s.st_mode) ||
+        s.st_size <= 0 || (uint64_t)s.st_size > max_size ||
+        !gp_mmap_fs_ok(fno))
+        return NULL;
+    addr = mmap(NULL, (size_t)s.st_size, PROT_READ, MAP_PRIVATE, fno, 0);
+    if (addr == MAP_FAILED)
+        return NULL;
+    *psize = (size_t)s.st_size;
+    return addr;
+#else
+    return NULL;
+#endif
+}
+
+void gp_munmap_impl(void *addr, size_t size)
+{
+#ifdef GP_HAVE_MMAP
+    munmap(addr, size);
+#endif
+}
+
+int gp_read_some_impl(char *buf, size_t count, FILE *f)
+{
+#ifdef GS_NO_FILESYSTEM
+    return 0;
+#else
+    int fno = fileno(f);
+    ssize_t n;
+
+    if (fno < 0)
+        return -1;
+    do {
+        n = read(fno, buf, count);
+    } while (n < 0 && errno == EINTR);
+    return (int)n;
+#endif
+}
@@ -733,3 +733,19 @@ bool gp_fseekable_impl(FILE *f)
 
     return((bool)S_ISREG(s.st_mode));
 }
+
+void *gp_mmap_impl(FILE *f, size_t max_size, size_t *psize)
+{
+    return NULL;
+}
+
+void gp_munmap_impl(void *addr, size_t size)
+{
+}
+
+int gp_read_some_impl(char *buf, size_t count, FILE *f)
+{
+    int n = fread(buf, 1, count, f);
+
+    return (n > 0 || !ferror(f) ? n : -1);
+}
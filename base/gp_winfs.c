@@ -206,3 +206,45 @@ bool gp_fseekable_impl(FILE *f)
 
     return((bool)S_ISREG(s.st_mode));
 }
+
+void *gp_mmap_impl(FILE *f, size_t max_size, size_t *psize)
+{
+    HANDLE hnd = (HANDLE)_get_osfhandle(fileno(f));
+    HANDLE map;
+    LARGE_INTEGER size;
+    void *addr;
+
+    if (hnd == INVALID_HANDLE_VALUE || GetFileType(hnd) != FILE_TYPE_DISK)
+        return NULL;
+    if (!GetFileSizeEx(hnd, &size) || size.QuadPart <= 0 ||
+        (uint64_t)size.QuadPart > max_size)
+        return NULL;
+    map = CreateFileMapping(hnd, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (map == NULL)
+        return NULL;
+    addr = MapViewOfFile(map, FILE_MAP_READ, 0, 0, (SIZE_T)size.QuadPart);
+    /* The view keeps the mapping object alive. */
+    CloseHandle(map);
+    if (addr == NULL)
+        return NULL;
+    *psize = (size_t)size.QuadPart;
+    return addr;
+}
+
+void gp_munmap_impl(void *addr, size_t size)
+{
+    UnmapViewOfFile(addr);
+}
+
+int gp_read_some_impl(char *buf, size_t count, FILE *f)
+{
+    HANDLE hnd = (HANDLE)_get_osfhandle(fileno(f));
+    DWORD ret;
+
+    if (hnd == INVALID_HANDLE_VALUE)
+        return -1;
+    /* A pipe returns what has been written so far; a closed one is EOF. */
+    if (!ReadFile(hnd, buf, (DWORD)count, &ret, NULL))
+        return (GetLastError() == ERROR_BROKEN_PIPE ? 0 : -1);
+    return (int)ret;
+}
@@ -491,13 +491,26 @@ typedef struct {
     gp_file base;
     FILE *file;
     int (*close)(FILE *file);
+    void *map;
+    size_t map_size;
 } gp_file_FILE;
 
+static void
+gp_file_FILE_unmap(gp_file_FILE *file)
+{
+    if (file->map != NULL) {
+        gp_munmap_impl(file->map, file->map_size);
+        file->map = NULL;
+        file->map_size = 0;
+    }
+}
+
 static int
 gp_file_FILE_close(gp_file *file_)
 {
     gp_file_FILE *file = (gp_file_FILE *)file_;
 
+    gp_file_FILE_unmap(file);
     return (file->close)(file->file);
 }
 
@@ -641,6 +654,7 @@ gp_file_FILE_reopen(gp_file *file_, const char *fname, const char *mode)
 {
     gp_file_FILE *file = (gp_file_FILE *)file_;
 
+    gp_file_FILE_unmap(file);
     file->file = freopen(fname, mode, file->file);
     if (file->file == NULL) {
         gp_file_dealloc(file_);
@@ -649,6 +663,19 @@ gp_file_FILE_reopen(gp_file *file_, const char *fname, const char *mode)
     return file_;
 }
 
+static const void *
+gp_file_FILE_mmap(gp_file *file_, size_t max_size, size_t *psize)
+{
+    gp_file_FILE *file = (gp_file_FILE *)file_;
+
+    if (file->map == NULL)
+        file->map = gp_mmap_impl(file->file, max_size, &file->map_size);
+    if (file->map == NULL || file->map_size > max_size)
+        return NULL;
+    *psize = file->map_size;
+    return file->map;
+}
+
 static const gp_file_ops_t gp_file_FILE_prototype =
 {
     gp_file_FILE_close,
@@ -668,7 +695,8 @@ static const gp_file_ops_t gp_file_FILE_prototype =
     gp_file_FILE_ferror,
     gp_file_FILE_get_file,
     gp_file_FILE_clearerr,
-    gp_file_FILE_reopen
+    gp_file_FILE_reopen,
+    gp_file_FILE_mmap
 };
 
 gp_file *gp_file_FILE_alloc(const gs_memory_t *mem)
@@ -0,0 +1,470 @@
+/* Copyright (C) 2001-2023 Artifex Software, Inc.
+   All Rights Reserved.
+
+   This software is provided AS-IS with no warranty, either express or
+   implied.
+
+   This software is distributed under license and may not be copied,
+   modified or distributed except as expressly authorized under the terms
+   of the license contained in the file LICENSE in this distribution.
+
+   Refer to licensing information at http://www.artifex.com or contact
+   Artifex Software, Inc.,  39 Mesa Street, Suite 108A, San Francisco,
+   CA 94129, USA, for further information.
+*/
+
+
+/* Read-ahead gp_file implementation */
+#include "stdio_.h"
+#include "memory_.h"
+#include "gx.h"
+#include "gp.h"
+#include "gpsync.h"
+#include "gxsync.h"
+#include "gpreadahead.h"
+
+/*
+ * A reader thread fills a ring of blocks from the underlying gp_file,
+ * while the client consumes them in the same order. The 'free' semaphore
+ * counts blocks the reader may fill, and 'full' the blocks ready for the
+ * client, so each block is only ever touched by one side at a time. The
+ * reader lives as long as the file; at EOF it just delivers empty blocks.
+ *
+ * A pipe is read with gp_read_some_impl, so a block holds whatever data
+ * had arrived, and the client never waits for a whole block. Closing a
+ * pipe early still waits for the reader's current read, which returns
+ * once the writer produces more data or exits, as pclose already waits
+ * for the child process. Terminals are never read ahead.
+ *
+ * Seeks are lazy: they just record the new position. The next read
+ * either moves within the current block, or takes back every block from
+ * the reader (which is then idle, waiting for 'free') and looks for the
+ * position in those. Only the blocks that don't continue on from it are
+ * handed back to be refilled, from the new position. This keeps the
+ * ftell/fseek sequences used by the file streams to find the file size,
+ * cheap. Pipes can't seek, so none of this applies to them.
+ *
+ * Random access readers such as pdfi mostly seek outside the blocks that
+ * have been read, and so gain nothing; read-ahead is therefore off unless
+ * it is asked for (see --readahead).
+ */
+
+#define RA_BLOCKS 2		/* double buffered */
+
+typedef struct {
+    byte *data;
+    uint count;			/* bytes read into data */
+    gs_offset_t pos;		/* file position of data[0] */
+    int status;			/* 0, or EOF/error after this block */
+} ra_block;
+
+typedef struct {
+    gp_file base;
+    gp_file *file;		/* underlying file */
+    FILE *pipe;			/* for a pipe, its FILE, read as data arrives */
+    uint block_size;
+    ra_block blocks[RA_BLOCKS];
+    gx_semaphore_t *free;
+    gx_semaphore_t *full;
+    gp_thread_id thread;
+    bool running;
+    volatile bool stop;
+    /* Used only by the reader thread while it has blocks to fill. */
+    int fill;			/* next block to fill */
+    gs_offset_t fill_pos;	/* position of the next block */
+    /* Used only by the client. */
+    int next;			/* next block to be delivered */
+    int ready;			/* blocks after cur already held by the client */
+    int inflight;		/* blocks handed to the reader */
+    int cur;			/* block being consumed, or -1 */
+    uint off;			/* offset of the next byte in cur */
+    gs_offset_t pos;		/* logical position (after seeks) */
+    gs_offset_t data_pos;	/* position of the next unread byte */
+    gs_offset_t size;		/* file size */
+    bool done;			/* no more blocks after cur */
+    bool eof;
+    bool error;
+} gp_file_readahead;
+
+static void
+readahead_thread(void *arg)
+{
+    gp_file_readahead *ra = (gp_file_readahead *)arg;
+
+    for (;;) {
+        ra_block *b;
+        int n;
+
+        gx_semaphore_wait(ra->free);
+        if (ra->stop)
+            break;
+        b = &ra->blocks[ra->fill];
+        if (ra->pipe != NULL) {
+            n = gp_read_some_impl((char *)b->data, ra->block_size, ra->pipe);
+            b->status = (n < 0 ? ERRC : n == 0 ? EOFC : 0);
+        } else {
+            n = gp_fread(b->data, 1, ra->block_size, ra->file);
+            b->status = (gp_ferror(ra->file) ? ERRC :
+                         n < ra->block_size || gp_feof(ra->file) ? EOFC : 0);
+        }
+        if (n < 0)
+            n = 0;
+        b->count = n;
+        b->pos = ra->fill_pos;
+        ra->fill_pos += n;
+        ra->fill = (ra->fill + 1) % RA_BLOCKS;
+        gx_semaphore_signal(ra->full);
+    }
+}
+
+/* Stop the reader thread, and wait for it to exit. */
+static void
+readahead_stop(gp_file_readahead *ra)
+{
+    if (!ra->running)
+        return;
+    ra->stop = true;
+    gx_semaphore_signal(ra->free);
+    gp_thread_finish(ra->thread);
+    ra->running = false;
+}
+
+/* Start the reader thread, filling every block from 'pos'. */
+static int
+readahead_start(gp_file_readahead *ra, gs_offset_t pos)
+{
+    int i;
+
+    ra->stop = false;
+    ra->fill = ra->next = 0;
+    ra->fill_pos = ra->pos = ra->data_pos = pos;
+    ra->cur = -1;
+    ra->off = 0;
+    ra->ready = 0;
+    ra->done = ra->eof = ra->error = false;
+    if (gp_thread_start(readahead_thread, ra, &ra->thread) < 0)
+        return -1;
+    gp_thread_label(ra->thread, "readahead");
+    ra->running = true;
+    for (i = 0; i < RA_BLOCKS; i++)
+        gx_semaphore_signal(ra->free);
+    ra->inflight = RA_BLOCKS;
+    return 0;
+}
+
+/* Does block b hold the data at pos? */
+static bool
+readahead_block_has(const ra_block *b, gs_offset_t pos)
+{
+    return (pos >= b->pos &&
+            (pos < b->pos + b->count ||
+             (pos == b->pos + b->count && b->status != 0)));
+}
+
+/* Apply a pending seek before reading. */
+static int
+readahead_reposition(gp_file_readahead *ra)
+{
+    gs_offset_t pos = ra->pos;
+    int i, j, found = -1, refill;
+
+    if (ra->cur >= 0) {
+        ra_block *b = &ra->blocks[ra->cur];
+
+        if (pos >= b->pos && pos <= b->pos + b->count) {
+            ra->off = (uint)(pos - b->pos);
+            ra->data_pos = pos;
+            return 0;
+        }
+    }
+    if (!ra->running) {
+        ra->error = true;
+        return -1;
+    }
+    /* Take back the blocks the reader has, which leaves it idle. */
+    for (; ra->inflight > 0; ra->inflight--)
+        gx_semaphore_wait(ra->full);
+    for (i = 0; i < RA_BLOCKS && found < 0; i++)
+        if (readahead_block_has(&ra->blocks[i], pos))
+            found = i;
+    if (found >= 0) {
+        /* Keep the blocks which carry on from this one. */
+        ra_block *b = &ra->blocks[found];
+
+        ra->cur = found;
+        ra->off = (uint)(pos - b->pos);
+        ra->ready = 0;
+        j = (found + 1) % RA_BLOCKS;
+        while (b->status == 0 && j != found &&
+               ra->blocks[j].pos == b->pos + b->count) {
+            b = &ra->blocks[j];
+            ra->ready++;
+            j = (j + 1) % RA_BLOCKS;
+        }
+        ra->next = (found + 1) % RA_BLOCKS;
+        ra->done = (ra->ready == 0 && b->status != 0);
+        ra->eof = ra->error = false;
+        ra->data_pos = pos;
+        /* At EOF the reader will just deliver empty blocks. */
+        ra->fill = j;
+        ra->fill_pos = b->pos + b->count;
+        refill = RA_BLOCKS - 1 - ra->ready;
+    } else {
+        ra->cur = -1;
+        ra->off = 0;
+        ra->ready = 0;
+        ra->fill = ra->next = 0;
+        ra->fill_pos = ra->data_pos = pos;
+        ra->done = ra->eof = ra->error = false;
+        refill = RA_BLOCKS;
+    }
+    gp_clearerr(ra->file);
+    if (gp_fseek(ra->file, ra->fill_pos, SEEK_SET) != 0) {
+        ra->error = true;
+        return -1;
+    }
+    for (; ra->inflight < refill; ra->inflight++)
+        gx_semaphore_signal(ra->free);
+    return 0;
+}
+
+/* Make the next block current. Return false at EOF or on error. */
+static bool
+readahead_next_block(gp_file_readahead *ra)
+{
+    ra_block *b;
+
+    if (ra->done) {
+        if (ra->blocks[ra->cur].status == ERRC)
+            ra->error = true;
+        else
+            ra->eof = true;
+        return false;
+    }
+    if (!ra->running) {
+        ra->error = true;
+        return false;
+    }
+    if (ra->cur >= 0) {
+        gx_semaphore_signal(ra->free);
+        ra->inflight++;
+    }
+    if (ra->ready > 0)
+        ra->ready--;
+    else {
+        gx_semaphore_wait(ra->full);
+        ra->inflight--;
+    }
+    ra->cur = ra->next;
+    ra->next = (ra->next + 1) % RA_BLOCKS;
+    ra->off = 0;
+    b = &ra->blocks[ra->cur];
+    if (b->status != 0)
+        ra->done = true;
+    return true;
+}
+
+static int
+readahead_read(gp_file *file_, size_t size, unsigned int count, void *buf)
+{
+    gp_file_readahead *ra = (gp_file_readahead *)file_;
+    size_t want = size * count, done = 0;
+
+    if (want == 0)
+        return 0;
+    if (ra->pos != ra->data_pos && readahead_reposition(ra) < 0)
+        return 0;
+    while (done < want) {
+        ra_block *b = (ra->cur >= 0 ? &ra->blocks[ra->cur] : NULL);
+        uint n;
+
+        if (b == NULL || ra->off == b->count) {
+            /* A pipe returns what has arrived, rather than wait for more. */
+            if (ra->pipe != NULL && done > 0)
+                break;
+            if (!readahead_next_block(ra))
+                break;
+            continue;
+        }
+        n = b->count - ra->off;
+        if (n > want - done)
+            n = (uint)(want - done);
+        memcpy((byte *)buf + done, b->data + ra->off, n);
+        ra->off += n;
+        done += n;
+    }
+    ra->pos = ra->data_pos += done;
+    return (int)(done / size);
+}
+
+static int
+readahead_getc(gp_file *file_)
+{
+    byte c;
+
+    return (readahead_read(file_, 1, 1, &c) == 1 ? c : EOF);
+}
+
+static int
+readahead_seek(gp_file *file_, gs_offset_t offset, int whence)
+{
+    gp_file_readahead *ra = (gp_file_readahead *)file_;
+    gs_offset_t pos;
+
+    switch (whence) {
+    case SEEK_SET:
+        pos = offset;
+        break;
+    case SEEK_CUR:
+        pos = ra->pos + offset;
+        break;
+    case SEEK_END:
+        if (ra->pipe != NULL)
+            return -1;
+        pos = ra->size + offset;
+        break;
+    default:
+        return -1;
+    }
+    if (pos < 0 || (ra->pipe != NULL && pos != ra->pos))
+        return -1;
+    ra->pos = pos;
+    ra->eof = false;
+    return 0;
+}
+
+static gs_offset_t
+readahead_tell(gp_file *file_)
+{
+    gp_file_readahead *ra = (gp_file_readahead *)file_;
+
+    return ra->pos;
+}
+
+static int
+readahead_eof(gp_file *file_)
+{
+    return ((gp_file_readahead *)file_)->eof;
+}
+
+static int
+readahead_seekable(gp_file *file_)
+{
+    return ((gp_file_readahead *)file_)->pipe == NULL;
+}
+
+static int
+readahead_ferror(gp_file *file_)
+{
+    return ((gp_file_readahead *)file_)->error;
+}
+
+static void
+readahead_clearerr(gp_file *file_)
+{
+    gp_file_readahead *ra = (gp_file_readahead *)file_;
+
+    ra->eof = ra->error = false;
+}
+
+static void
+readahead_free(gp_file_readahead *ra)
+{
+    int i;
+
+    for (i = 0; i < RA_BLOCKS; i++)
+        gs_free_object(ra->base.memory, ra->blocks[i].data,
+                       "readahead(block)");
+    if (ra->free != NULL)
+        gx_semaphore_free(ra->free);
+    if (ra->full != NULL)
+        gx_semaphore_free(ra->full);
+}
+
+static int
+readahead_close(gp_file *file_)
+{
+    gp_file_readahead *ra = (gp_file_readahead *)file_;
+
+    readahead_stop(ra);
+    readahead_free(ra);
+    return gp_fclose(ra->file);
+}
+
+static const gp_file_ops_t readahead_ops = {
+    readahead_close,
+    readahead_getc,
+    NULL, /* putc */
+    readahead_read,
+    NULL, /* write */
+    readahead_seek,
+    readahead_tell,
+    readahead_eof,
+    NULL, /* dup */
+    readahead_seekable,
+    NULL, /* pread */
+    NULL, /* pwrite */
+    NULL, /* is_char_buffered */
+    NULL, /* fflush */
+    readahead_ferror,
+    NULL, /* get_file */
+    readahead_clearerr,
+    NULL, /* reopen */
+    NULL  /* mmap */
+};
+
+gp_file *
+gp_file_readahead_open(gp_file *file, uint size)
+{
+    gp_file_readahead *ra;
+    FILE *pipe = NULL;
+    gs_offset_t pos = 0, end = -1;
+    int i;
+
+    if (size < 2 * RA_BLOCKS * 1024)
+        return NULL;
+    if (!gp_fseekable(file)) {
+        /* Pipes are read through their FILE, see above. */
+        pipe = gp_get_file(file);
+        if (pipe == NULL)
+            return NULL;
+    } else {
+        /* Small files gain nothing from a separate reader. */
+        pos = gp_ftell(file);
+        if (pos < 0 || gp_fseek(file, 0, SEEK_END) != 0)
+            return NULL;
+        end = gp_ftell(file);
+        if (gp_fseek(file, pos, SEEK_SET) != 0)
+            return NULL;
+        if (end < 0 || end - pos <= size)
+            return NULL;
+    }
+
+    ra = (gp_file_readahead *)gp_file_alloc(file->memory, &readahead_ops,
+                                            sizeof(*ra), "gp_file_readahead");
+    if (ra == NULL)
+        return NULL;
+    ra->file = file;
+    ra->pipe = pipe;
+    ra->block_size = size / RA_BLOCKS;
+    ra->size = end;
+    for (i = 0; i < RA_BLOCKS; i++) {
+        ra->blocks[i].data = gs_alloc_bytes(ra->base.memory, ra->block_size,
+                                            "readahead(block)");
+        if (ra->blocks[i].data == NULL)
+            goto fail;
+    }
+    ra->free = gx_semaphore_label(gx_semaphore_alloc(ra->base.memory),
+                                  "readahead(free)");
+    ra->full = gx_semaphore_label(gx_semaphore_alloc(ra->base.memory),
+                                  "readahead(full)");
+    if (ra->free == NULL || ra->full == NULL)
+        goto fail;
+    if (readahead_start(ra, pos) < 0)
+        goto fail;
+    return &ra->base;
+fail:
+    readahead_free(ra);
+    gp_file_dealloc(&ra->base);
+    return NULL;
+}
@@ -0,0 +1,38 @@
+/* Copyright (C) 2001-2023 Artifex Software, Inc.
+   All Rights Reserved.
+
+   This software is provided AS-IS with no warranty, either express or
+   implied.
+
+   This software is distributed under license and may not be copied,
+   modified or distributed except as expressly authorized under the terms
+   of the license contained in the file LICENSE in this distribution.
+
+   Refer to licensing information at http://www.artifex.com or contact
+   Artifex Software, Inc.,  39 Mesa Street, Suite 108A, San Francisco,
+   CA 94129, USA, for further information.
+*/
+
+
+/* Read-ahead gp_file implementation */
+
+#ifndef gpreadahead_INCLUDED
+#  define gpreadahead_INCLUDED
+
+#include "gp.h"
+
+/* Default amount of data kept ahead of the reader, in bytes; 0 is off. */
+#ifndef GS_READAHEAD_SIZE_DEFAULT
+#  define GS_READAHEAD_SIZE_DEFAULT 0
+#endif
+
+/*
+ * Wrap a gp_file opened for reading so that a separate thread reads up
+ * to 'size' bytes ahead of the caller, double buffered. This is only
+ * done for pipes, and for regular files larger than 'size'. On success
+ * the returned gp_file owns 'file' and closes it when it is itself
+ * closed; otherwise NULL is returned and 'file' is untouched.
+ */
+gp_file *gp_file_readahead_open(gp_file *file, uint size);
+
+#endif /* gpreadahead_INCLUDED */
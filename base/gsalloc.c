@@ -764,6 +764,7 @@ ialloc_alloc_state(gs_memory_t * parent, uint clump_size)
 #endif
     iimem->is_controlled = false;
     iimem->gc_status.vm_threshold = clump_size * 3L;
+    iimem->gc_status.threshold_percent = 0;
     iimem->gc_status.max_vm = MAX_MAX_VM;
     iimem->gc_status.signal_value = 0;
     iimem->gc_status.enabled = false;
@@ -937,7 +938,10 @@ ialloc_set_limit(register gs_ref_memory_t * mem)
          * The following code is intended to set the limit so that
          * we stop allocating when allocated + previous_status.allocated
          * exceeds the lesser of max_vm or (if GC is enabled)
-         * gc_allocated + vm_threshold.
+         * gc_allocated + vm_threshold.  If threshold_percent is set,
+         * the interval grows with the VM that survived the last GC, so
+         * that a large live heap isn't traced again after every
+         * vm_threshold bytes of new allocation.
          */
     size_t max_allocated =
     (mem->gc_status.max_vm > mem->previous_status.allocated ?
@@ -945,8 +949,19 @@ ialloc_set_limit(register gs_ref_memory_t * mem)
      0);
 
     if (mem->gc_status.enabled) {
-        size_t limit = mem->gc_allocated + mem->gc_status.vm_threshold;
+        size_t threshold = mem->gc_status.vm_threshold;
+        size_t limit;
 
+        if (mem->gc_status.threshold_percent > 0) {
+            size_t grown = mem->gc_allocated / 100 *
+                mem->gc_status.threshold_percent;
+
+            if (grown > threshold)
+                threshold = grown;
+        }
+        limit = mem->gc_allocated + threshold;
+        if (limit < mem->gc_allocated)	/* overflow */
+            limit = max_size_t;
         if (limit < mem->previous_status.allocated)
             mem->limit = 0;
         else {
@@ -1075,6 +1090,25 @@ gs_memory_set_vm_threshold(gs_ref_memory_t * mem, int64_t val)
     gs_memory_set_gc_status(stable, &stat);
 }
 
+/* Set the VM threshold growth percentage. */
+void
+gs_memory_set_vm_threshold_percent(gs_ref_memory_t * mem, int percent)
+{
+    gs_memory_gc_status_t stat;
+    gs_ref_memory_t * stable = (gs_ref_memory_t *)mem->stable_memory;
+
+    if (percent < 0)
+        percent = 0;
+    else if (percent > MAX_VM_THRESHOLD_PERCENT)
+        percent = MAX_VM_THRESHOLD_PERCENT;
+    gs_memory_gc_status(mem, &stat);
+    stat.threshold_percent = percent;
+    gs_memory_set_gc_status(mem, &stat);
+    gs_memory_gc_status(stable, &stat);
+    stat.threshold_percent = percent;
+    gs_memory_set_gc_status(stable, &stat);
+}
+
 /* Set VM reclaim. */
 void
 gs_memory_set_vm_reclaim(gs_ref_memory_t * mem, bool enabled)
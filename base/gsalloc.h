@@ -31,6 +31,8 @@ typedef struct gs_memory_gc_status_s {
         /* Set by client */
     /* Note vm_threshold is set as a signed value */
     int64_t vm_threshold;	/* GC interval */
+    int threshold_percent;	/* if > 0, GC interval is at least this */
+                                /* percentage of the VM left after a GC */
     size_t max_vm;		/* maximum allowed allocation */
 
     int signal_value;		/* value to store in gs_lib_ctx->gcsignal */
@@ -47,12 +49,14 @@ typedef struct gs_memory_gc_status_s {
 #endif
 #define MAX_MAX_VM (max_size_t>>1)
 #define MIN_VM_THRESHOLD 1
+#define MAX_VM_THRESHOLD_PERCENT 10000
 
 void gs_memory_gc_status(const gs_ref_memory_t *, gs_memory_gc_status_t *);
 void gs_memory_set_gc_status(gs_ref_memory_t *, const gs_memory_gc_status_t *);
 /* Value passed as int64_t, but limited to MAX_VM_THRESHOLD (see set_vm_threshold) */
 void gs_memory_set_vm_threshold(gs_ref_memory_t * mem, int64_t val);
 void gs_memory_set_vm_reclaim(gs_ref_memory_t * mem, bool enabled);
+void gs_memory_set_vm_threshold_percent(gs_ref_memory_t * mem, int percent);
 
 /* ------ Initialization ------ */
 
@@ -29,11 +29,15 @@
 #include "spprint.h"
 #include "stream.h"
 
+typedef struct calc_program_s calc_program_t;
+
 typedef struct gs_function_PtCr_s {
     gs_function_head_t head;
     gs_function_PtCr_params_t params;
     /* Define a bogus DataSource for get_function_info. */
     gs_data_source_t data_source;
+    /* Compiled form of params.ops, or 0 if it couldn't be compiled. */
+    calc_program_t *prog;
 } gs_function_PtCr_t;
 
 /* GC descriptor */
@@ -102,9 +106,9 @@ typedef enum {
 
 } gs_PtCr_typed_opcode_t;
 
-/* Evaluate a PostScript Calculator function. */
+/* Interpret a PostScript Calculator function. */
 static int
-fn_PtCr_evaluate(const gs_function_t *pfn_common, const float *in, float *out)
+fn_PtCr_interpret(const gs_function_t *pfn_common, const float *in, float *out)
 {
     const gs_function_PtCr_t *pfn = (const gs_function_PtCr_t *)pfn_common;
     calc_value_t vstack_buf[2 + MAX_VSTACK + 1];
@@ -576,6 +580,1058 @@ fn_PtCr_evaluate(const gs_function_t *pfn_common, const float *in, float *out)
     return 0;
 }
 
+/* ---------------- Compiled evaluation ---------------- */
+
+/*
+ * Most calculator functions (in particular the tint transforms generated
+ * for DeviceN and Separation spaces) are straight-line code, possibly with
+ * a few if/ifelse constructs.  For these, the type and position of every
+ * stack entry are known when the function is created, so we translate the
+ * operator string into a register-based program: each stack slot is bound
+ * at compile time either to a register or to a constant.  Stack operators
+ * then cost nothing at run time, constant sub-expressions are folded, and
+ * the per-operator type dispatch and stack checks disappear.
+ *
+ * Anything that we can't analyse statically (repeat, stack operators with
+ * computed operands, integer arithmetic that may overflow into reals,
+ * operations that would fail on constant operands, ...) leaves the
+ * function uncompiled, and the interpreter above is used instead.  In
+ * particular the interpreter remains responsible for reporting all errors
+ * other than those that depend on the input values.
+ */
+
+#define MAX_CALC_REGS 512
+#define MAX_CALC_INSNS 4096
+
+/* Return value from the compiler meaning "use the interpreter". */
+#define CALC_NOT_COMPILABLE 1
+
+typedef union calc_reg_s {
+    int i;			/* also used for Boolean */
+    float f;
+} calc_reg_t;
+
+typedef enum {
+
+        /* Data movement */
+
+    CALC_loadk, CALC_mov, CALC_int_to_float,
+
+        /* Unary operators */
+
+    CALC_abs, CALC_ceiling, CALC_cos, CALC_cvi, CALC_floor, CALC_ln,
+    CALC_log, CALC_neg, CALC_not, CALC_round, CALC_sin, CALC_sqrt,
+    CALC_truncate,
+
+        /* Binary operators */
+
+    CALC_add, CALC_and, CALC_atan, CALC_bitshift, CALC_div, CALC_exp,
+    CALC_idiv, CALC_mod, CALC_mul, CALC_or, CALC_sub, CALC_xor,
+    CALC_eq_int, CALC_ge_int, CALC_gt_int, CALC_le_int, CALC_lt_int,
+    CALC_ne_int,
+    CALC_eq, CALC_ge, CALC_gt, CALC_le, CALC_lt, CALC_ne,
+
+        /* Control (k.i is the offset of the target instruction) */
+
+    CALC_jump_false, CALC_jump
+
+} calc_opcode_t;
+
+typedef struct calc_insn_s {
+    short op;			/* calc_opcode_t */
+    short d, a, b;		/* destination and operand registers */
+    calc_reg_t k;		/* constant or jump offset */
+} calc_insn_t;
+
+typedef struct calc_output_s {
+    short reg;			/* < 0 if the output is a constant */
+    short is_int;
+    float value;		/* the constant, if reg < 0 */
+} calc_output_t;
+
+/*
+ * For functions with a single input we also tabulate the function at the
+ * 256 values that 8-bit image samples decode to with the default Decode
+ * array (see decode_sample in gximage.h).  The table is only used when the
+ * input is exactly equal to one of these values, so the results are
+ * identical to those of a full evaluation.
+ */
+#define CALC_TABLE_SIZE 256
+#define CALC_TABLE_MAX_OUTPUTS 8
+
+/*
+ * The program is a single byte object: this header, then the
+ * instructions, the outputs, and (optionally) the sample table and its
+ * validity flags.
+ */
+struct calc_program_s {
+    uint num_insns;
+    uint num_outputs;
+    uint has_table;
+};
+#define calc_program_insns(prog)\
+  ((calc_insn_t *)((prog) + 1))
+#define calc_program_outputs(prog)\
+  ((calc_output_t *)(calc_program_insns(prog) + (prog)->num_insns))
+#define calc_program_table(prog)\
+  ((float *)(calc_program_outputs(prog) + (prog)->num_outputs))
+#define calc_program_table_valid(prog)\
+  ((byte *)(calc_program_table(prog) + CALC_TABLE_SIZE * (prog)->num_outputs))
+
+/* Execute a single non-control instruction. */
+static inline int
+calc_exec(const calc_insn_t *ip, calc_reg_t *regs)
+{
+    calc_reg_t *d = &regs[ip->d];
+    const calc_reg_t *a = &regs[ip->a];
+    const calc_reg_t *b = &regs[ip->b];
+    int n;
+
+    switch ((calc_opcode_t)ip->op) {
+    case CALC_loadk:
+        *d = ip->k;
+        break;
+    case CALC_mov:
+        *d = *a;
+        break;
+    case CALC_int_to_float:
+        d->f = (float)(double)a->i;
+        break;
+    case CALC_abs:
+        d->f = fabs(a->f);
+        break;
+    case CALC_ceiling:
+        d->f = ceil(a->f);
+        break;
+    case CALC_cos:
+        d->f = gs_cos_degrees(a->f);
+        break;
+    case CALC_cvi:
+        d->i = (int)a->f;
+        break;
+    case CALC_floor:
+        d->f = floor(a->f);
+        break;
+    case CALC_ln:
+        d->f = log(a->f);
+        break;
+    case CALC_log:
+        d->f = log10(a->f);
+        break;
+    case CALC_neg:
+        d->f = -a->f;
+        break;
+    case CALC_not:
+        d->i = ~a->i;
+        break;
+    case CALC_round:
+        d->f = floor(a->f + 0.5);
+        break;
+    case CALC_sin:
+        d->f = gs_sin_degrees(a->f);
+        break;
+    case CALC_sqrt:
+        d->f = sqrt(a->f);
+        break;
+    case CALC_truncate:
+        d->f = (a->f < 0 ? ceil(a->f) : floor(a->f));
+        break;
+    case CALC_add:
+        d->f = a->f + b->f;
+        break;
+    case CALC_and:
+        d->i = a->i & b->i;
+        break;
+    case CALC_atan: {
+        double result;
+        int code = gs_atan2_degrees(a->f, b->f, &result);
+
+        if (code < 0)
+            return code;
+        d->f = result;
+        break;
+    }
+    case CALC_bitshift:
+#define MAX_SHIFT (ARCH_SIZEOF_INT * 8 - 1)
+        if (b->i < -MAX_SHIFT || b->i > MAX_SHIFT)
+            d->i = 0;
+#undef MAX_SHIFT
+        else if ((n = b->i) < 0)
+            d->i = ((uint)(a->i)) >> -n;
+        else
+            d->i = a->i << n;
+        break;
+    case CALC_div:
+        if (b->f == 0)
+            return_error(gs_error_undefinedresult);
+        d->f = a->f / b->f;
+        break;
+    case CALC_exp:
+        d->f = pow(a->f, b->f);
+        break;
+    case CALC_idiv:
+        if (b->i == 0)
+            return_error(gs_error_undefinedresult);
+        if (a->i == min_int && b->i == -1)  /* anomalous boundary case, fail */
+            return_error(gs_error_rangecheck);
+        d->i = a->i / b->i;
+        break;
+    case CALC_mod:
+        if (b->i == 0)
+            return_error(gs_error_undefinedresult);
+        d->i = a->i % b->i;
+        break;
+    case CALC_mul:
+        d->f = a->f * b->f;
+        break;
+    case CALC_or:
+        d->i = a->i | b->i;
+        break;
+    case CALC_sub:
+        d->f = a->f - b->f;
+        break;
+    case CALC_xor:
+        d->i = a->i ^ b->i;
+        break;
+    case CALC_eq_int:
+        d->i = a->i == b->i;
+        break;
+    case CALC_ge_int:
+        d->i = a->i >= b->i;
+        break;
+    case CALC_gt_int:
+        d->i = a->i > b->i;
+        break;
+    case CALC_le_int:
+        d->i = a->i <= b->i;
+        break;
+    case CALC_lt_int:
+        d->i = a->i < b->i;
+        break;
+    case CALC_ne_int:
+        d->i = a->i != b->i;
+        break;
+    case CALC_eq:
+        d->i = a->f == b->f;
+        break;
+    case CALC_ge:
+        d->i = a->f >= b->f;
+        break;
+    case CALC_gt:
+        d->i = a->f > b->f;
+        break;
+    case CALC_le:
+        d->i = a->f <= b->f;
+        break;
+    case CALC_lt:
+        d->i = a->f < b->f;
+        break;
+    case CALC_ne:
+        d->i = a->f != b->f;
+        break;
+    default:			/* jumps are handled by the caller */
+        return_error(gs_error_unregistered);
+    }
+    return 0;
+}
+
+/* Run a compiled program. */
+static int
+calc_run(const calc_program_t *prog, int m, const float *in, float *out)
+{
+    calc_reg_t regs[MAX_CALC_REGS];
+    const calc_insn_t *ip = calc_program_insns(prog);
+    const calc_insn_t *end = ip + prog->num_insns;
+    const calc_output_t *po = calc_program_outputs(prog);
+    int i, code;
+
+    for (i = 0; i < m; ++i)
+        regs[i].f = in[i];
+    while (ip < end) {
+        switch (ip->op) {
+        case CALC_jump_false:
+            if (regs[ip->a].i) {
+                ++ip;
+                continue;
+            }
+            /* falls through */
+        case CALC_jump:
+            ip += ip->k.i;
+            continue;
+        default:
+            code = calc_exec(ip, regs);
+            if (code < 0)
+                return code;
+            ++ip;
+        }
+    }
+    for (i = 0; i < prog->num_outputs; ++i, ++po)
+        out[i] = (po->reg < 0 ? po->value :
+                  po->is_int ? (float)regs[po->reg].i : regs[po->reg].f);
+    return 0;
+}
+
+/* Describe the compile-time contents of a stack slot. */
+typedef struct calc_slot_s {
+    calc_value_type_t type;
+    bool known;			/* the value is the constant k */
+    calc_reg_t k;
+    int reg;			/* if !known, the register holding the value */
+} calc_slot_t;
+
+typedef struct calc_compiler_s {
+    gs_memory_t *memory;	/* for temporary allocations */
+    calc_slot_t *stack;		/* [MAX_VSTACK] */
+    int depth;
+    calc_insn_t *insns;		/* [MAX_CALC_INSNS] */
+    int num_insns;
+    int num_regs;
+} calc_compiler_t;
+
+static int
+calc_emit(calc_compiler_t *pcc, calc_opcode_t op, int d, int a, int b,
+          calc_reg_t k)
+{
+    calc_insn_t *ip;
+
+    if (pcc->num_insns == MAX_CALC_INSNS)
+        return CALC_NOT_COMPILABLE;
+    ip = &pcc->insns[pcc->num_insns++];
+    ip->op = (short)op;
+    ip->d = (short)d;
+    ip->a = (short)a;
+    ip->b = (short)b;
+    ip->k = k;
+    return 0;
+}
+
+static int
+calc_new_reg(calc_compiler_t *pcc)
+{
+    return (pcc->num_regs < MAX_CALC_REGS ? pcc->num_regs++ : -1);
+}
+
+/* Emit code to copy the value of a slot into a register. */
+static int
+calc_emit_move(calc_compiler_t *pcc, int d, const calc_slot_t *ps)
+{
+    static const calc_reg_t zero = {0};
+
+    if (ps->known)
+        return calc_emit(pcc, CALC_loadk, d, 0, 0, ps->k);
+    return calc_emit(pcc, CALC_mov, d, ps->reg, 0, zero);
+}
+
+/* Make sure a slot's value is in a register. */
+static int
+calc_materialize(calc_compiler_t *pcc, calc_slot_t *ps)
+{
+    int r, code;
+
+    if (!ps->known)
+        return 0;
+    if ((r = calc_new_reg(pcc)) < 0)
+        return CALC_NOT_COMPILABLE;
+    code = calc_emit_move(pcc, r, ps);
+    if (code != 0)
+        return code;
+    ps->known = false;
+    ps->reg = r;
+    return 0;
+}
+
+/*
+ * Apply an operator to 1 or 2 slots, replacing the first with the result.
+ * If all the operands are constants, fold the operation.
+ */
+static int
+calc_apply(calc_compiler_t *pcc, calc_opcode_t op, calc_slot_t *pa,
+           const calc_slot_t *pb, calc_value_type_t rtype)
+{
+    static const calc_reg_t zero = {0};
+    calc_insn_t insn;
+    int r, code;
+
+    if (pa->known && (pb == NULL || pb->known)) {
+        calc_reg_t regs[3];
+
+        regs[0] = pa->k;
+        regs[1] = (pb ? pb->k : zero);
+        insn.op = (short)op;
+        insn.d = 2, insn.a = 0, insn.b = 1;
+        if (calc_exec(&insn, regs) < 0)
+            return CALC_NOT_COMPILABLE;	/* let the interpreter fail */
+        pa->k = regs[2];
+    } else {
+        calc_slot_t b;
+
+        if (pb) {
+            b = *pb;
+            if ((code = calc_materialize(pcc, &b)) != 0)
+                return code;
+        }
+        if ((code = calc_materialize(pcc, pa)) != 0)
+            return code;
+        if ((r = calc_new_reg(pcc)) < 0)
+            return CALC_NOT_COMPILABLE;
+        code = calc_emit(pcc, op, r, pa->reg, (pb ? b.reg : 0), zero);
+        if (code != 0)
+            return code;
+        pa->reg = r;
+    }
+    pa->type = rtype;
+    return 0;
+}
+
+/* Convert an int slot to a float. */
+static int
+calc_to_float(calc_compiler_t *pcc, calc_slot_t *ps)
+{
+    if (ps->type != CVT_INT)
+        return 0;
+    return calc_apply(pcc, CALC_int_to_float, ps, NULL, CVT_FLOAT);
+}
+
+/*
+ * Integer arithmetic may silently overflow into reals, so we only handle
+ * it for constant operands, exactly as the interpreter does.
+ */
+static int
+calc_fold_int(gs_PtCr_opcode_t op, calc_slot_t *pa, const calc_slot_t *pb)
+{
+    int int1 = pa->k.i, int2 = (pb ? pb->k.i : 0);
+
+    if (!pa->known || (pb != NULL && !pb->known))
+        return CALC_NOT_COMPILABLE;
+    switch (op) {
+    case PtCr_add:
+        if ((int1 ^ int2) >= 0 && ((int1 + int2) ^ int1) < 0)
+            goto real;
+        pa->k.i = int1 + int2;
+        return 0;
+    case PtCr_sub:
+        if ((int1 ^ int2) < 0 && ((int1 - int2) ^ int1) >= 0)
+            goto real;
+        pa->k.i = int1 - int2;
+        return 0;
+    case PtCr_mul: {
+        double prod = (double)int1 * int2;
+
+        if (prod < min_int || prod > max_int) {
+            pa->k.f = prod;
+            pa->type = CVT_FLOAT;
+        } else
+            pa->k.i = (int)prod;
+        return 0;
+    }
+    case PtCr_abs:
+        if (int1 >= 0)
+            return 0;
+        /* fall through */
+    case PtCr_neg:
+        if (int1 == min_int) {
+            pa->k.f = (double)int1;
+            pa->type = CVT_FLOAT;
+        } else
+            pa->k.i = -int1;
+        return 0;
+    default:
+        return CALC_NOT_COMPILABLE;
+    }
+ real:
+    pa->k.f = (op == PtCr_add ? (double)int1 + int2 : (double)int1 - int2);
+    pa->type = CVT_FLOAT;
+    return 0;
+}
+
+static bool
+calc_is_numeric(const calc_slot_t *ps)
+{
+    return ps->type == CVT_INT || ps->type == CVT_FLOAT;
+}
+
+/*
+ * Check whether an if body ends with an else, skipping over nested
+ * if bodies so that we don't mistake their else for ours.
+ */
+static bool
+calc_body_has_else(const byte *p, uint size, uint *pelse_size)
+{
+    const byte *end = p + size;
+
+    while (p < end)
+        switch (*p++) {
+        case PtCr_byte:
+            ++p; break;
+        case PtCr_int:
+            p += sizeof(int); break;
+        case PtCr_float:
+            p += sizeof(float); break;
+        case PtCr_if:
+            p += 2 + (p[0] << 8) + p[1]; break;
+        case PtCr_else:
+            if (p + 2 == end) {
+                *pelse_size = (p[0] << 8) + p[1];
+                return true;
+            }
+            /* falls through */
+        case PtCr_repeat:
+            p += 2; break;
+        default:
+            break;
+        }
+    return false;
+}
+
+static int calc_compile_ops(calc_compiler_t *pcc, const byte *p,
+                            const byte *end);
+
+/*
+ * Compile an if or ifelse.  The condition has already been popped.
+ * Code layout (relative jumps, so the else part can be moved):
+ *      jump_false cond, L1
+ *      <then part>  <then moves>  jump L2
+ *  L1: <else part>  <else moves>
+ *  L2:
+ * where the moves bring the stack slots that differ between the two
+ * branches into common registers.
+ */
+static int
+calc_compile_if(calc_compiler_t *pcc, const calc_slot_t *pcond,
+                const byte *body, uint size, const byte *end,
+                const byte **pnext)
+{
+    static const calc_reg_t zero = {0};
+    uint else_size = 0;
+    bool has_else = calc_body_has_else(body, size, &else_size);
+    const byte *then_end = body + size - (has_else ? 3 : 0);
+    const byte *else_end = body + size + else_size;
+    calc_slot_t *saved = NULL;
+    bool moved[MAX_VSTACK];
+    int depth = pcc->depth, then_depth;
+    int jf_pos, then_end_pos, else_pos, num_then_moves = 0;
+    int i, code;
+
+    if (body + size > end || else_end > end)
+        return CALC_NOT_COMPILABLE;
+    *pnext = else_end;
+    if (pcond->known) {
+        if (pcond->k.i)
+            return calc_compile_ops(pcc, body, then_end);
+        return calc_compile_ops(pcc, body + size, else_end);
+    }
+    saved = (calc_slot_t *)gs_alloc_byte_array(pcc->memory, 2 * MAX_VSTACK,
+                                               sizeof(calc_slot_t),
+                                               "calc_compile_if");
+    if (saved == NULL)
+        return_error(gs_error_VMerror);
+    memcpy(saved, pcc->stack, depth * sizeof(calc_slot_t));
+    jf_pos = pcc->num_insns;
+    code = calc_emit(pcc, CALC_jump_false, 0, pcond->reg, 0, zero);
+    if (code != 0)
+        goto out;
+    code = calc_compile_ops(pcc, body, then_end);
+    if (code != 0)
+        goto out;
+    /* Save the state at the end of the then part in saved[MAX_VSTACK...]. */
+    then_depth = pcc->depth;
+    memcpy(saved + MAX_VSTACK, pcc->stack, then_depth * sizeof(calc_slot_t));
+    then_end_pos = pcc->num_insns;
+    memcpy(pcc->stack, saved, depth * sizeof(calc_slot_t));
+    pcc->depth = depth;
+    code = calc_compile_ops(pcc, body + size, else_end);
+    if (code != 0)
+        goto out;
+    if (pcc->depth != then_depth) {
+        code = CALC_NOT_COMPILABLE;
+        goto out;
+    }
+    /* Emit the else moves, and count the then moves. */
+    for (i = 0; i < then_depth; ++i) {
+        calc_slot_t *pt = &saved[MAX_VSTACK + i];
+        calc_slot_t *pe = &pcc->stack[i];
+        int r;
+
+        if (pt->type != pe->type) {
+            code = CALC_NOT_COMPILABLE;
+            goto out;
+        }
+        moved[i] = !(pt->known ? pe->known && pt->k.i == pe->k.i :
+                     !pe->known && pt->reg == pe->reg);
+        if (!moved[i])
+            continue;
+        if ((r = calc_new_reg(pcc)) < 0) {
+            code = CALC_NOT_COMPILABLE;
+            goto out;
+        }
+        code = calc_emit_move(pcc, r, pe);
+        if (code != 0)
+            goto out;
+        pe->known = false;
+        pe->reg = r;
+        ++num_then_moves;
+    }
+    /* Make room for the then moves and the jump. */
+    {
+        bool need_jump = pcc->num_insns > then_end_pos;
+        int num_added = num_then_moves + (need_jump ? 1 : 0);
+        int num_else = pcc->num_insns - then_end_pos;
+        calc_insn_t *ip;
+
+        if (pcc->num_insns + num_added > MAX_CALC_INSNS) {
+            code = CALC_NOT_COMPILABLE;
+            goto out;
+        }
+        memmove(&pcc->insns[then_end_pos + num_added],
+                &pcc->insns[then_end_pos], num_else * sizeof(calc_insn_t));
+        pcc->num_insns = then_end_pos;
+        for (i = 0; i < then_depth; ++i)
+            if (moved[i]) {
+                code = calc_emit_move(pcc, pcc->stack[i].reg,
+                                      &saved[MAX_VSTACK + i]);
+                if (code != 0)
+                    goto out;
+            }
+        else_pos = then_end_pos + num_added;
+        if (need_jump) {
+            calc_reg_t k;
+
+            k.i = num_else + 1;
+            code = calc_emit(pcc, CALC_jump, 0, 0, 0, k);
+            if (code != 0)
+                goto out;
+        }
+        pcc->num_insns = else_pos + num_else;
+        ip = &pcc->insns[jf_pos];
+        ip->k.i = else_pos - jf_pos;
+    }
+ out:
+    gs_free_object(pcc->memory, saved, "calc_compile_if");
+    return code;
+}
+
+/* Compile a sequence of operators. */
+static int
+calc_compile_ops(calc_compiler_t *pcc, const byte *p, const byte *end)
+{
+    calc_slot_t *stack = pcc->stack;
+    int code = 0;
+
+#define NEED(n) if (pcc->depth < (n)) return CALC_NOT_COMPILABLE
+#define TOP (&stack[pcc->depth - 1])
+#define NEXT (&stack[pcc->depth - 2])
+#define PUSH(t, member, v)\
+  BEGIN\
+    if (pcc->depth == MAX_VSTACK)\
+        return CALC_NOT_COMPILABLE;\
+    stack[pcc->depth].type = (t);\
+    stack[pcc->depth].known = true;\
+    stack[pcc->depth].k.member = (v);\
+    pcc->depth++;\
+  END
+
+    while (p < end) {
+        gs_PtCr_opcode_t op = (gs_PtCr_opcode_t)*p++;
+        calc_slot_t *pa, *pb;
+        int i, n;
+
+        switch (op) {
+
+            /* Unary numeric operators */
+
+        case PtCr_abs:
+        case PtCr_neg:
+            NEED(1);
+            pa = TOP;
+            if (pa->type == CVT_INT)
+                code = calc_fold_int(op, pa, NULL);
+            else if (pa->type == CVT_FLOAT)
+                code = calc_apply(pcc, (op == PtCr_abs ? CALC_abs : CALC_neg),
+                                  pa, NULL, CVT_FLOAT);
+            else
+                return CALC_NOT_COMPILABLE;
+            break;
+        case PtCr_ceiling:
+        case PtCr_floor:
+        case PtCr_round:
+        case PtCr_truncate:
+        case PtCr_cvi:
+            NEED(1);
+            pa = TOP;
+            if (pa->type == CVT_INT)
+                break;
+            if (pa->type != CVT_FLOAT)
+                return CALC_NOT_COMPILABLE;
+            code = calc_apply(pcc,
+                              (op == PtCr_ceiling ? CALC_ceiling :
+                               op == PtCr_floor ? CALC_floor :
+                               op == PtCr_round ? CALC_round :
+                               op == PtCr_truncate ? CALC_truncate : CALC_cvi),
+                              pa, NULL, (op == PtCr_cvi ? CVT_INT : CVT_FLOAT));
+            break;
+        case PtCr_cvr:
+            NEED(1);
+            if (!calc_is_numeric(TOP))
+                return CALC_NOT_COMPILABLE;
+            code = calc_to_float(pcc, TOP);
+            break;
+        case PtCr_cos:
+        case PtCr_sin:
+        case PtCr_sqrt:
+        case PtCr_ln:
+        case PtCr_log:
+            NEED(1);
+            pa = TOP;
+            if (!calc_is_numeric(pa))
+                return CALC_NOT_COMPILABLE;
+            if ((code = calc_to_float(pcc, pa)) != 0)
+                return code;
+            code = calc_apply(pcc,
+                              (op == PtCr_cos ? CALC_cos :
+                               op == PtCr_sin ? CALC_sin :
+                               op == PtCr_sqrt ? CALC_sqrt :
+                               op == PtCr_ln ? CALC_ln : CALC_log),
+                              pa, NULL, CVT_FLOAT);
+            break;
+        case PtCr_not:
+            NEED(1);
+            pa = TOP;
+            if (pa->type != CVT_INT && pa->type != CVT_BOOL)
+                return CALC_NOT_COMPILABLE;
+            code = calc_apply(pcc, CALC_not, pa, NULL, pa->type);
+            break;
+
+            /* Binary numeric operators */
+
+        case PtCr_add:
+        case PtCr_sub:
+        case PtCr_mul:
+            NEED(2);
+            pa = NEXT, pb = TOP;
+            if (!calc_is_numeric(pa) || !calc_is_numeric(pb))
+                return CALC_NOT_COMPILABLE;
+            if (pa->type == CVT_INT && pb->type == CVT_INT)
+                code = calc_fold_int(op, pa, pb);
+            else if ((code = calc_to_float(pcc, pa)) == 0 &&
+                     (code = calc_to_float(pcc, pb)) == 0)
+                code = calc_apply(pcc,
+                                  (op == PtCr_add ? CALC_add :
+                                   op == PtCr_sub ? CALC_sub : CALC_mul),
+                                  pa, pb, CVT_FLOAT);
+            pcc->depth--;
+            break;
+        case PtCr_div:
+        case PtCr_exp:
+        case PtCr_atan:
+            NEED(2);
+            pa = NEXT, pb = TOP;
+            if (!calc_is_numeric(pa) || !calc_is_numeric(pb))
+                return CALC_NOT_COMPILABLE;
+            if ((code = calc_to_float(pcc, pa)) != 0 ||
+                (code = calc_to_float(pcc, pb)) != 0)
+                return code;
+            code = calc_apply(pcc,
+                              (op == PtCr_div ? CALC_div :
+                               op == PtCr_exp ? CALC_exp : CALC_atan),
+                              pa, pb, CVT_FLOAT);
+            pcc->depth--;
+            break;
+        case PtCr_and:
+        case PtCr_or:
+        case PtCr_xor:
+            NEED(2);
+            pa = NEXT, pb = TOP;
+            if ((pa->type != CVT_INT && pa->type != CVT_BOOL) ||
+                (pb->type != CVT_INT && pb->type != CVT_BOOL))
+                return CALC_NOT_COMPILABLE;
+            code = calc_apply(pcc,
+                              (op == PtCr_and ? CALC_and :
+                               op == PtCr_or ? CALC_or : CALC_xor),
+                              pa, pb, pa->type);
+            pcc->depth--;
+            break;
+        case PtCr_bitshift:
+        case PtCr_idiv:
+        case PtCr_mod:
+            NEED(2);
+            pa = NEXT, pb = TOP;
+            if (pa->type != CVT_INT || pb->type != CVT_INT)
+                return CALC_NOT_COMPILABLE;
+            code = calc_apply(pcc,
+                              (op == PtCr_bitshift ? CALC_bitshift :
+                               op == PtCr_idiv ? CALC_idiv : CALC_mod),
+                              pa, pb, CVT_INT);
+            pcc->depth--;
+            break;
+
+            /* Comparison operators */
+
+        case PtCr_eq:
+        case PtCr_ne:
+        case PtCr_ge:
+        case PtCr_gt:
+        case PtCr_le:
+        case PtCr_lt: {
+            static const calc_opcode_t int_ops[] = {
+                CALC_eq_int, CALC_ge_int, CALC_gt_int, CALC_le_int,
+                CALC_lt_int, CALC_ne_int
+            };
+            static const calc_opcode_t float_ops[] = {
+                CALC_eq, CALC_ge, CALC_gt, CALC_le, CALC_lt, CALC_ne
+            };
+            int index = op - PtCr_eq;
+
+            NEED(2);
+            pa = NEXT, pb = TOP;
+            if (pa->type == CVT_BOOL && pb->type == CVT_BOOL &&
+                (op == PtCr_eq || op == PtCr_ne))
+                code = calc_apply(pcc, int_ops[index], pa, pb, CVT_BOOL);
+            else if (!calc_is_numeric(pa) || !calc_is_numeric(pb))
+                return CALC_NOT_COMPILABLE;
+            else if (pa->type == CVT_INT && pb->type == CVT_INT)
+                code = calc_apply(pcc, int_ops[index], pa, pb, CVT_BOOL);
+            else if ((code = calc_to_float(pcc, pa)) == 0 &&
+                     (code = calc_to_float(pcc, pb)) == 0)
+                code = calc_apply(pcc, float_ops[index], pa, pb, CVT_BOOL);
+            pcc->depth--;
+            break;
+        }
+
+            /* Stack operators: these only rearrange the slots. */
+
+        case PtCr_copy:
+            NEED(1);
+            if (TOP->type != CVT_INT || !TOP->known)
+                return CALC_NOT_COMPILABLE;
+            i = TOP->k.i;
+            n = --pcc->depth;
+            if (i < 0 || i > n || n + i > MAX_VSTACK)
+                return CALC_NOT_COMPILABLE;
+            memcpy(&stack[n], &stack[n - i], i * sizeof(*stack));
+            pcc->depth += i;
+            break;
+        case PtCr_dup:
+            NEED(1);
+            if (pcc->depth == MAX_VSTACK)
+                return CALC_NOT_COMPILABLE;
+            stack[pcc->depth] = *TOP;
+            pcc->depth++;
+            break;
+        case PtCr_exch: {
+            calc_slot_t temp;
+
+            NEED(2);
+            temp = *TOP, *TOP = *NEXT, *NEXT = temp;
+            break;
+        }
+        case PtCr_index:
+            NEED(1);
+            if (TOP->type != CVT_INT || !TOP->known)
+                return CALC_NOT_COMPILABLE;
+            i = TOP->k.i;
+            if (i < 0 || i >= pcc->depth - 1)
+                return CALC_NOT_COMPILABLE;
+            *TOP = stack[pcc->depth - 2 - i];
+            break;
+        case PtCr_pop:
+            NEED(1);
+            pcc->depth--;
+            break;
+        case PtCr_roll: {
+            calc_slot_t temp;
+            calc_slot_t *base;
+
+            NEED(2);
+            if (NEXT->type != CVT_INT || !NEXT->known ||
+                TOP->type != CVT_INT || !TOP->known)
+                return CALC_NOT_COMPILABLE;
+            n = NEXT->k.i;
+            i = TOP->k.i;
+            pcc->depth -= 2;
+            if (n < 0 || n > pcc->depth)
+                return CALC_NOT_COMPILABLE;
+            if (n == 0)
+                break;
+            base = &stack[pcc->depth - n];
+            for (i %= n; i > 0; i--) {
+                temp = base[n - 1];
+                memmove(base + 1, base, (n - 1) * sizeof(*stack));
+                base[0] = temp;
+            }
+            for (; i < 0; i++) {
+                temp = base[0];
+                memmove(base, base + 1, (n - 1) * sizeof(*stack));
+                base[n - 1] = temp;
+            }
+            break;
+        }
+
+            /* Constants */
+
+        case PtCr_byte:
+            PUSH(CVT_INT, i, *p++);
+            break;
+        case PtCr_int:
+            memcpy(&i, p, sizeof(int));
+            p += sizeof(int);
+            PUSH(CVT_INT, i, i);
+            break;
+        case PtCr_float: {
+            float f;
+
+            memcpy(&f, p, sizeof(float));
+            p += sizeof(float);
+            PUSH(CVT_FLOAT, f, f);
+            break;
+        }
+        case PtCr_true:
+            PUSH(CVT_BOOL, i, true);
+            break;
+        case PtCr_false:
+            PUSH(CVT_BOOL, i, false);
+            break;
+
+            /* Special */
+
+        case PtCr_if: {
+            calc_slot_t cond;
+            uint size = (p[0] << 8) + p[1];
+
+            NEED(1);
+            cond = *TOP;
+            if (cond.type != CVT_BOOL)
+                return CALC_NOT_COMPILABLE;
+            pcc->depth--;
+            code = calc_compile_if(pcc, &cond, p + 2, size, end, &p);
+            break;
+        }
+        default:		/* else, return, repeat, repeat_end */
+            return CALC_NOT_COMPILABLE;
+        }
+        if (code != 0)
+            return code;
+    }
+    return 0;
+
+#undef NEED
+#undef TOP
+#undef NEXT
+#undef PUSH
+}
+
+/*
+ * Try to compile a function, setting pfn->prog.  If the function can't be
+ * compiled, prog is left 0 and we return 0.
+ */
+static int
+calc_compile(gs_function_PtCr_t *pfn, gs_memory_t *mem)
+{
+    calc_compiler_t cc;
+    int m = pfn->params.m, n = pfn->params.n;
+    int code, extra, i;
+
+    pfn->prog = NULL;
+    cc.memory = mem->non_gc_memory;
+    cc.stack = (calc_slot_t *)
+        gs_alloc_byte_array(cc.memory, MAX_VSTACK, sizeof(calc_slot_t),
+                            "calc_compile(stack)");
+    cc.insns = (calc_insn_t *)
+        gs_alloc_byte_array(cc.memory, MAX_CALC_INSNS, sizeof(calc_insn_t),
+                            "calc_compile(insns)");
+    if (cc.stack == NULL || cc.insns == NULL) {
+        code = gs_note_error(gs_error_VMerror);
+        goto out;
+    }
+    for (i = 0; i < m; ++i) {
+        cc.stack[i].type = CVT_FLOAT;
+        cc.stack[i].known = false;
+        cc.stack[i].reg = i;
+    }
+    cc.depth = m;
+    cc.num_insns = 0;
+    cc.num_regs = m;
+    code = calc_compile_ops(&cc, pfn->params.ops.data,
+                            pfn->params.ops.data + pfn->params.ops.size - 1);
+    /* Following Acrobat, take the outputs from the top of the stack. */
+    extra = cc.depth - n;
+    if (code == 0 && extra < 0)
+        code = CALC_NOT_COMPILABLE;
+    for (i = 0; code == 0 && i < n; ++i)
+        if (!calc_is_numeric(&cc.stack[extra + i]))
+            code = CALC_NOT_COMPILABLE;
+    if (code == 0) {
+        bool has_table = m == 1 && n <= CALC_TABLE_MAX_OUTPUTS;
+        uint size = sizeof(calc_program_t) +
+            cc.num_insns * sizeof(calc_insn_t) + n * sizeof(calc_output_t) +
+            (has_table ? CALC_TABLE_SIZE * (n * sizeof(float) + 1) : 0);
+        calc_program_t *prog =
+            (calc_program_t *)gs_alloc_bytes(mem, size, "calc_compile");
+        calc_output_t *po;
+
+        if (prog == NULL) {
+            code = gs_note_error(gs_error_VMerror);
+            goto out;
+        }
+        prog->num_insns = cc.num_insns;
+        prog->num_outputs = n;
+        prog->has_table = false;
+        memcpy(calc_program_insns(prog), cc.insns,
+               cc.num_insns * sizeof(calc_insn_t));
+        po = calc_program_outputs(prog);
+        for (i = 0; i < n; ++i, ++po) {
+            const calc_slot_t *ps = &cc.stack[extra + i];
+
+            po->is_int = ps->type == CVT_INT;
+            if (ps->known) {
+                po->reg = -1;
+                po->value = (po->is_int ? (float)ps->k.i : ps->k.f);
+            } else {
+                po->reg = ps->reg;
+                po->value = 0;
+            }
+        }
+        if (has_table) {
+            float *values = calc_program_table(prog);
+            byte *valid = calc_program_table_valid(prog);
+
+            for (i = 0; i < CALC_TABLE_SIZE; ++i) {
+                float in = i * (1.0f / 255.0f);
+
+                valid[i] = calc_run(prog, 1, &in, values + i * n) >= 0;
+            }
+            prog->has_table = true;
+        }
+        pfn->prog = prog;
+    }
+    if (code > 0)
+        code = 0;
+ out:
+    gs_free_object(cc.memory, cc.insns, "calc_compile(insns)");
+    gs_free_object(cc.memory, cc.stack, "calc_compile(stack)");
+    return code;
+}
+
+/* Evaluate a PostScript Calculator function. */
+static int
+fn_PtCr_evaluate(const gs_function_t *pfn_common, const float *in, float *out)
+{
+    const gs_function_PtCr_t *pfn = (const gs_function_PtCr_t *)pfn_common;
+    const calc_program_t *prog = pfn->prog;
+
+    if (prog == NULL)
+        return fn_PtCr_interpret(pfn_common, in, out);
+    if (prog->has_table && in[0] >= 0 && in[0] <= 1) {
+        int i = (int)(in[0] * 255 + 0.5);
+
+        if (i * (1.0f / 255.0f) == in[0] && calc_program_table_valid(prog)[i]) {
+            memcpy(out, calc_program_table(prog) + i * prog->num_outputs,
+                   prog->num_outputs * sizeof(float));
+            return 0;
+        }
+    }
+    return calc_run(prog, pfn->params.m, in, out);
+}
+
 /* Test whether a PostScript Calculator function is monotonic. */
 static int
 fn_PtCr_is_monotonic(const gs_function_t * pfn_common,
@@ -758,6 +1814,7 @@ fn_PtCr_make_scaled(const gs_function_PtCr_t *pfn, gs_function_PtCr_t **ppsfn,
     psfn->params.ops.data = ops;
     psfn->params.ops.size = opsize;
     psfn->data_source = pfn->data_source;
+    psfn->prog = NULL;
     code = fn_common_scale((gs_function_t *)psfn, (const gs_function_t *)pfn,
                            pranges, mem);
     if (code < 0) {
@@ -792,6 +1849,11 @@ fn_PtCr_make_scaled(const gs_function_PtCr_t *pfn, gs_function_PtCr_t **ppsfn,
     psfn->params.ops.data =
         gs_resize_string(mem, ops, opsize, psfn->params.ops.size,
                          "fn_PtCr_make_scaled");
+    code = calc_compile(psfn, mem);
+    if (code < 0) {
+        gs_function_free((gs_function_t *)psfn, true, mem);
+        return code;
+    }
     *ppsfn = psfn;
     return 0;
 }
@@ -806,6 +1868,17 @@ gs_function_PtCr_free_params(gs_function_PtCr_params_t * params, gs_memory_t * m
     fn_common_free_params((gs_function_params_t *) params, mem);
 }
 
+/* Free a PostScript Calculator function. */
+static void
+fn_PtCr_free(gs_function_t * pfn_common, bool free_params, gs_memory_t * mem)
+{
+    gs_function_PtCr_t *pfn = (gs_function_PtCr_t *)pfn_common;
+
+    gs_free_object(mem, pfn->prog, "fn_PtCr_free");
+    pfn->prog = NULL;
+    fn_common_free(pfn_common, free_params, mem);
+}
+
 /* Serialize. */
 static int
 gs_function_PtCr_serialize(const gs_function_t * pfn, stream *s)
@@ -836,7 +1909,7 @@ gs_function_PtCr_init(gs_function_t ** ppfn,
             fn_common_get_params,
             (fn_make_scaled_proc_t) fn_PtCr_make_scaled,
             (fn_free_params_proc_t) gs_function_PtCr_free_params,
-            fn_common_free,
+            fn_PtCr_free,
             (fn_serialize_proc_t) gs_function_PtCr_serialize,
         }
     };
@@ -886,6 +1959,7 @@ gs_function_PtCr_init(gs_function_t ** ppfn,
         if (pfn == 0)
             return_error(gs_error_VMerror);
         pfn->params = *params;
+        pfn->prog = NULL;
         /*
          * We claim to have a DataSource, in order to write the function
          * definition in symbolic form for embedding in PDF files.
@@ -894,6 +1968,11 @@ gs_function_PtCr_init(gs_function_t ** ppfn,
         data_source_init_string2(&pfn->data_source, NULL, 0);
         pfn->data_source.access = calc_access;
         pfn->head = function_PtCr_head;
+        code = calc_compile(pfn, mem);
+        if (code < 0) {
+            gs_free_object(mem, pfn, "gs_function_PtCr_init");
+            return code;
+        }
         *ppfn = (gs_function_t *) pfn;
     }
     return 0;
@@ -69,9 +69,9 @@ typedef struct gs_function_PtCr_params_s {
 
 /****** NEEDS TO INCLUDE data_source ******/
 #define private_st_function_PtCr()	/* in gsfunc4.c */\
-  gs_private_st_suffix_add_strings1(st_function_PtCr, gs_function_PtCr_t,\
+  gs_private_st_suffix_add1_string1(st_function_PtCr, gs_function_PtCr_t,\
     "gs_function_PtCr_t", function_PtCr_enum_ptrs, function_PtCr_reloc_ptrs,\
-    st_function, params.ops)
+    st_function, prog, params.ops)
 
 /* ---------------- Procedures ---------------- */
 
@@ -34,7 +34,9 @@
  */
 
 #undef BLOCK_SMOOTHING_SUPPORTED
-#undef IDCT_SCALING_SUPPORTED
+/* IDCT_SCALING_SUPPORTED is kept, DCTDecode uses it to decode images
+ * which are heavily downscaled on output at a reduced size.
+ */
 #undef UPSAMPLE_SCALING_SUPPORTED
 #undef UPSAMPLE_MERGING_SUPPORTED
 #undef QUANT_1PASS_SUPPORTED
@@ -45,6 +45,7 @@
 #include "string_.h" /* memset */
 #include "gp.h"
 #include "gpmisc.h"
+#include "gpreadahead.h"
 #include "gsicc_manage.h"
 #include "gserrors.h"
 #include "gscdefs.h"            /* for gs_lib_device_list */
@@ -337,6 +338,9 @@ int gs_lib_ctx_init(gs_lib_ctx_t *ctx, gs_memory_t *mem)
         pio->core->gs_next_id = 5; /* Cloned contexts share the state */
         /* Set scanconverter to 1 (default) */
         pio->core->scanconverter = GS_SCANCONVERTER_DEFAULT;
+        /* Off by default, see gslibctx.h */
+        pio->core->mmap_files = 0;
+        pio->core->readahead_size = GS_READAHEAD_SIZE_DEFAULT;
         /* Initialise the underlying CMS. */
         pio->core->cms_context = gscms_create(mem);
         if (pio->core->cms_context == NULL) {
@@ -489,6 +493,20 @@ int gs_lib_ctx_get_act_on_uel( const gs_memory_t *mem )
     return mem->gs_lib_ctx->core->act_on_uel;
 }
 
+int gs_lib_ctx_get_mmap_files( const gs_memory_t *mem )
+{
+    if (mem == NULL || mem->gs_lib_ctx == NULL)
+        return 0;
+    return mem->gs_lib_ctx->core->mmap_files;
+}
+
+uint gs_lib_ctx_get_readahead_size( const gs_memory_t *mem )
+{
+    if (mem == NULL || mem->gs_lib_ctx == NULL)
+        return 0;
+    return mem->gs_lib_ctx->core->readahead_size;
+}
+
 /* Provide a single point for all "C" stdout and stderr.
  */
 
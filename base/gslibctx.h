@@ -122,6 +122,16 @@ typedef struct {
     int CPSI_mode;
     int scanconverter;
     int act_on_uel;
+    /* True if read-only regular files may be accessed through a memory
+     * mapping rather than buffered reads (see file_init_stream).  This
+     * is off unless --mmap is given: if a mapped file is truncated while
+     * it is being read, or a page of it can't be read (a failing disk,
+     * a removed device), the process gets SIGBUS (or an access violation
+     * on Windows) instead of an ioerror. */
+    int mmap_files;
+    /* Amount of data (in bytes) read ahead on a separate thread for
+     * pipes and large unmapped files; 0 disables read-ahead. */
+    uint readahead_size;
 
     int path_control_active;
     gs_path_control_set_t permit_reading;
@@ -218,6 +228,10 @@ gs_lib_ctx_t *gs_lib_ctx_get_interp_instance( const gs_memory_t *mem );
 void *gs_lib_ctx_get_cms_context( const gs_memory_t *mem );
 int gs_lib_ctx_get_act_on_uel( const gs_memory_t *mem );
 
+int gs_lib_ctx_get_mmap_files( const gs_memory_t *mem );
+
+uint gs_lib_ctx_get_readahead_size( const gs_memory_t *mem );
+
 int gs_lib_ctx_register_callout(gs_memory_t *mem, gs_callout_fn, void *arg);
 void gs_lib_ctx_deregister_callout(gs_memory_t *mem, gs_callout_fn, void *arg);
 int gs_lib_ctx_callout(gs_memory_t *mem, const char *dev_name,
@@ -163,6 +163,45 @@ fail:
 
 static int image_skip_color_icc_tpr(gx_image_enum *penum, gx_device *dev);
 
+/*
+ * Size the cache of remapped colors used by image_render_color_DeviceN.
+ * The cache itself is allocated by image_alloc_devn_clues when it is
+ * first needed.
+ */
+static void
+image_init_devn_clues(gx_image_enum *penum)
+{
+    int64_t pixels = (int64_t)penum->Width * penum->Height;
+    uint size = 1;
+
+    if (penum->spp > IMAGE_DEVN_CACHE_MAX_SPP || penum->devn_clues != NULL)
+        return;
+    while (size < IMAGE_DEVN_CACHE_SIZE && size < pixels)
+        size <<= 1;
+    penum->devn_clues_size = size;
+    penum->devn_clues_missed = false;
+}
+
+/* Allocate the color cache.  If we can't, we just do without it. */
+static gx_image_devn_clue *
+image_alloc_devn_clues(gx_image_enum *penum)
+{
+    gx_image_devn_clue *clues = (gx_image_devn_clue *)
+        gs_alloc_byte_array(penum->memory, penum->devn_clues_size,
+                            sizeof(gx_image_devn_clue),
+                            "image_alloc_devn_clues");
+    uint i;
+
+    if (clues == NULL) {
+        penum->devn_clues_size = 0;
+        return NULL;
+    }
+    for (i = 0; i < penum->devn_clues_size; i++)
+        clues[i].dev_color.type = gx_dc_type_none;
+    penum->devn_clues = clues;
+    return clues;
+}
+
 int
 gs_image_class_4_color(gx_image_enum * penum, irender_proc_t *render_fn)
 {
@@ -216,6 +255,7 @@ gs_image_class_4_color(gx_image_enum * penum, irender_proc_t *render_fn)
        the color spaces for CUPs */
     if ( (gs_color_space_get_index(penum->pcs) == gs_color_space_index_DeviceN &&
         penum->pcs->cmm_icc_profile_data == NULL) || penum->use_mask_color) {
+         image_init_devn_clues(penum);
          *render_fn = &image_render_color_DeviceN;
          return 0;
     }
@@ -271,6 +311,7 @@ gs_image_class_4_color(gx_image_enum * penum, irender_proc_t *render_fn)
         }
     }
     if (!gx_device_uses_std_cmap_procs(penum->dev, penum->pgs)) {
+        image_init_devn_clues(penum);
         *render_fn = &image_render_color_DeviceN;
         return code;
     }
@@ -440,6 +481,50 @@ decode_row(const gx_image_enum *penum, const byte *psrc, int spp, byte *pdes,
     }
 }
 
+/*
+ * Find room for a row of size bytes of color converted data in
+ * penum->icc_row_buf, aligned to 32 bytes for SSE/AVX with 32 bytes of
+ * overrun.  Rows are converted through the ICC link one at a time, so
+ * return 1 (and the data) if the buffer already holds the conversion of
+ * the w bytes at psrc, which is common for images with repeated rows.
+ */
+static int
+image_icc_row_get(gx_image_enum *penum, const byte *psrc, uint w, uint size,
+                  byte **psrc_cm)
+{
+    uint buf_size = w + size + 64 + 32;
+    uint offset;
+
+    if (penum->icc_row_src_size == w &&
+        memcmp(penum->icc_row_buf, psrc, w) == 0) {
+        /* Recompute the alignment, since the GC may have moved the */
+        /* buffer, and move the converted data to match if needed. */
+        offset = w + ((32 - (intptr_t)(penum->icc_row_buf + w)) & 31);
+        if (offset != penum->icc_row_offset) {
+            memmove(penum->icc_row_buf + offset,
+                    penum->icc_row_buf + penum->icc_row_offset, size);
+            penum->icc_row_offset = offset;
+        }
+        *psrc_cm = penum->icc_row_buf + offset;
+        return 1;
+    }
+    penum->icc_row_src_size = 0;
+    if (buf_size > penum->icc_row_buf_size) {
+        gs_free_object(penum->memory, penum->icc_row_buf, "image_icc_row_get");
+        penum->icc_row_buf = gs_alloc_bytes(penum->memory, buf_size,
+                                            "image_icc_row_get");
+        if (penum->icc_row_buf == NULL) {
+            penum->icc_row_buf_size = 0;
+            return_error(gs_error_VMerror);
+        }
+        penum->icc_row_buf_size = buf_size;
+    }
+    /* Recompute the alignment every time, since the GC may move the buffer. */
+    penum->icc_row_offset = w + ((32 - (intptr_t)(penum->icc_row_buf + w)) & 31);
+    *psrc_cm = penum->icc_row_buf + penum->icc_row_offset;
+    return 0;
+}
+
 /* Common code shared amongst the thresholding and non thresholding color image
    renderers */
 static int
@@ -492,12 +577,18 @@ image_color_icc_prep(gx_image_enum *penum_orig, const byte *psrc, uint w,
 
         if (pspan)
             *pspan = span;
-        /* Put the buffer on a 32 byte memory alignment for SSE/AVX for every
-         * line. Also extra space for 32 byte overrun. */
-        *psrc_cm_start = gs_alloc_bytes(pgs->memory,  span * spp_cm + 64,
-                                        "image_color_icc_prep");
-        *psrc_cm = *psrc_cm_start + ((32 - (intptr_t)(*psrc_cm_start)) & 31);
+        /* The converted row lives in penum->icc_row_buf, which is kept for
+           the life of the image, so the caller has nothing to free. */
+        code = image_icc_row_get(penum_orig, psrc, w, span * spp_cm, psrc_cm);
+        if (code < 0)
+            return code;
+        *psrc_cm_start = NULL;
         *bufend = *psrc_cm +  span * spp_cm;
+        if (code == 1) {
+            /* Same source data as the previous row, already converted. */
+            *spp_cm_out = spp_cm;
+            return 0;
+        }
         if (penum->icc_link->is_identity) {
             if (!force_planar) {
                 /* decode only. no CM.  This is slow but does not happen that often */
@@ -585,6 +676,8 @@ image_color_icc_prep(gx_image_enum *penum_orig, const byte *psrc, uint w,
                     return code;
             }
         }
+        memcpy(penum_orig->icc_row_buf, psrc, w);
+        penum_orig->icc_row_src_size = w;
     }
     *spp_cm_out = spp_cm;
     return 0;
@@ -1099,9 +1192,20 @@ image_render_color_icc_tpr(gx_image_enum *penum_orig, const byte *buffer, int da
     return code;
 }
 
+/* Hash the source samples of a pixel for penum->devn_clues. */
+static inline uint
+image_devn_clue_hash(const color_samples *ps, uint size)
+{
+    bits32 h = ps->all[0] * 0x9e3779b1 ^ ps->all[1] * 0x85ebca6b;
+
+    return (h ^ (h >> 16)) & (size - 1);
+}
+
 /* Render a color image for deviceN source color with no ICC profile.  This
    is also used if the image has any masking (type4 image) since we will not
-   be blasting through quickly */
+   be blasting through quickly.  Since every distinct pixel value has to be
+   remapped (possibly through a tint transform and an ICC link), we keep a
+   cache of the resulting device colors for the whole image. */
 static int
 image_render_color_DeviceN(gx_image_enum *penum_orig, const byte *buffer, int data_x,
                    uint w, int h, gx_device * dev)
@@ -1137,6 +1241,8 @@ image_render_color_DeviceN(gx_image_enum *penum_orig, const byte *buffer, int da
     bits32 mask = penum->mask_color.mask;
     bits32 test = penum->mask_color.test;
     bool lab_case = false;
+    gx_image_devn_clue *clues = penum->devn_clues;
+    gx_image_devn_clue *pclue;
 
     if (device_encodes_tags(dev)) {
         devc1.tag = (dev->graphics_type_tag & ~GS_DEVICE_ENCODES_TAGS);
@@ -1208,6 +1314,23 @@ image_render_color_DeviceN(gx_image_enum *penum_orig, const byte *buffer, int da
             color_set_null(pdevc_next);
             goto mapped;
         }
+        pclue = NULL;
+        if (clues == NULL && penum->devn_clues_size != 0) {
+            /* A single remapped color needs no cache: that is the run. */
+            if (penum_orig->devn_clues_missed)
+                clues = image_alloc_devn_clues(penum_orig);
+            penum_orig->devn_clues_missed = true;
+        }
+        if (clues != NULL) {
+            pclue = &clues[image_devn_clue_hash(&next, penum->devn_clues_size)];
+            if ((pclue->dev_color.type == gx_dc_type_pure ||
+                 pclue->dev_color.type == gx_dc_type_devn) &&
+                pclue->key[0] == next.all[0] && pclue->key[1] == next.all[1]) {
+                *pdevc_next = pclue->dev_color;
+                mcode = 0;
+                goto mapped;
+            }
+        }
         /* Data is already properly set up for ICC use of LAB */
         if (lab_case)
             for (i = 0; i < spp; ++i)
@@ -1229,6 +1352,13 @@ image_render_color_DeviceN(gx_image_enum *penum_orig, const byte *buffer, int da
         else
             mcode = gx_remap_ICC_with_link(&cc, pcs, pdevc_next, pgs, dev,
                                            gs_color_select_source, penum->icc_link);
+        /* Colors that contain no pointers can be reused for the same samples. */
+        if (pclue != NULL && mcode >= 0 &&
+            (gx_dc_is_pure(pdevc_next) || gx_dc_is_devn(pdevc_next))) {
+            pclue->dev_color = *pdevc_next;
+            pclue->key[0] = next.all[0];
+            pclue->key[1] = next.all[1];
+        }
 
 mapped:	if (mcode < 0)
             goto fill;
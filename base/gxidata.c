@@ -531,6 +531,12 @@ gx_image1_end_image(gx_image_enum_common_t * info, bool draw_last)
     if (penum->clues != NULL) {
         gs_free_object(mem,penum->clues, "image clues");
     }
+    if (penum->devn_clues != NULL) {
+        gs_free_object(mem, penum->devn_clues, "image devn clues");
+    }
+    if (penum->icc_row_buf != NULL) {
+        gs_free_object(mem, penum->icc_row_buf, "image icc row");
+    }
 
     /* decrement this ref that was incremented in gx_image_enum_begin() */
     rc_decrement_only(penum->pcs, "pcs");
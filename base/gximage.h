@@ -146,6 +146,23 @@ typedef struct gx_image_clue_s {
     bits32 key;
 } gx_image_clue;
 
+/*
+ * Define an entry in the cache of device colors used for multi-component
+ * images that have to be remapped pixel by pixel (for example DeviceN images
+ * whose colors go through a tint transform).  The table index is a hash of
+ * the key, which is the concatenation of the (at most 8) source pixel
+ * components.  Only pure and DeviceN colors, which contain no pointers,
+ * are cached.  The table is sized from the image, up to
+ * IMAGE_DEVN_CACHE_SIZE entries, and only allocated once a second distinct
+ * color has to be remapped.
+ */
+#define IMAGE_DEVN_CACHE_SIZE 1024	/* must be a power of 2 */
+#define IMAGE_DEVN_CACHE_MAX_SPP 8
+typedef struct gx_image_devn_clue_s {
+    gx_device_color dev_color;
+    bits32 key[2];
+} gx_image_devn_clue;
+
 typedef struct gx_image_color_cache_s {
     bool *is_transparent;
     byte *device_contone;
@@ -283,6 +300,15 @@ struct gx_image_enum_s {
     gx_device_color *icolor1;
     gsicc_link_t *icc_link; /* ICC link to avoid recreation with every line */
     gx_image_color_cache_t *color_cache;  /* A cache that is con-tone values */
+    gx_image_devn_clue *devn_clues;  /* Remapped colors for image_render_color_DeviceN */
+    uint devn_clues_size;	/* entries in devn_clues, 0 = don't cache */
+    bool devn_clues_missed;	/* a color has been remapped without devn_clues */
+    /* Row buffer reused by image_color_icc_prep.  It holds a copy of the */
+    /* last source row followed, at icc_row_offset, by its converted data. */
+    byte *icc_row_buf;
+    uint icc_row_buf_size;
+    uint icc_row_src_size;  /* 0 if icc_row_buf holds no valid row */
+    uint icc_row_offset;
     byte *ht_buffer;            /* A buffer to contain halftoned data */
     int ht_stride;
     int ht_offset_bits;     /* An offset adjustement to allow aligned copies */
@@ -305,8 +331,8 @@ struct gx_image_enum_s {
   m(0,pgs) m(1,pcs) m(2,dev) m(3,buffer) m(4,line)\
   m(5,clip_dev) m(6,rop_dev) m(7,scaler) m(8,icc_link)\
   m(9,color_cache) m(10,ht_buffer) m(11,thresh_buffer) \
-  m(12,clues)
-#define gx_image_enum_num_ptrs 13
+  m(12,clues) m(13,devn_clues) m(14,icc_row_buf)
+#define gx_image_enum_num_ptrs 15
 #define private_st_gx_image_enum() /* in gsimage.c */\
   gs_private_st_composite(st_gx_image_enum, gx_image_enum, "gx_image_enum",\
     image_enum_enum_ptrs, image_enum_reloc_ptrs)
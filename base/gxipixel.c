@@ -288,6 +288,12 @@ gx_image_enum_begin(gx_device * dev, const gs_gstate * pgs,
     int force_interpolation = 0;
 
     penum->clues = NULL;
+    penum->devn_clues = NULL;
+    penum->devn_clues_size = 0;
+    penum->devn_clues_missed = false;
+    penum->icc_row_buf = NULL;
+    penum->icc_row_buf_size = 0;
+    penum->icc_row_src_size = 0;
     penum->icc_setup.has_transfer = false;
     penum->icc_setup.is_lab = false;
     penum->icc_setup.must_halftone = false;
@@ -1058,6 +1064,7 @@ gx_image_enum_begin(gx_device * dev, const gs_gstate * pgs,
 fail:
     gs_free_object(mem, buffer, "image buffer");
     gs_free_object(mem, penum->clues, "gx_image_enum_begin");
+    gs_free_object(mem, penum->devn_clues, "gx_image_enum_begin");
     if (penum->clip_dev != NULL) {
         rc_decrement(penum->clip_dev, "error in gx_begin_image1");
         penum->clip_dev = NULL;
@@ -100,6 +100,7 @@ gstypes_h=$(GLSRC)gstypes.h
 srdline_h=$(GLSRC)srdline.h
 gpgetenv_h=$(GLSRC)gpgetenv.h
 gpmisc_h=$(GLSRC)gpmisc.h
+gpreadahead_h=$(GLSRC)gpreadahead.h
 gp_h=$(GLSRC)gp.h
 globals_h=$(GLSRC)globals.h
 gpcheck_h=$(GLSRC)gpcheck.h
@@ -360,12 +361,12 @@ $(AUX)gsmisc.$(OBJ) : $(GLSRC)gsmisc.c $(AK) $(gx_h) $(gpmisc_h) $(gserrors_h)\
  $(gdbflags_h) $(LIB_MAK) $(MAKEDIRS)
 	$(GLCCAUX) $(C_) $(AUXO_)gsmisc.$(OBJ) $(GLSRC)gsmisc.c
 
-$(GLOBJ)gslibctx_1.$(OBJ) : $(GLSRC)gslibctx.c  $(AK) $(gp_h) $(gpmisc_h) \
+$(GLOBJ)gslibctx_1.$(OBJ) : $(GLSRC)gslibctx.c  $(AK) $(gp_h) $(gpmisc_h) $(gpreadahead_h) \
   $(gsmemory_h) $(gslibctx_h) $(stdio__h) $(string__h) $(gsicc_manage_h) \
   $(gserrors_h) $(gscdefs_h) $(gsstruct_h) $(globals_h)
 	$(GLCC) $(D_)WITH_CAL$(_D) $(I_)$(CALSRCDIR)$(_I) $(GLO_)gslibctx_1.$(OBJ) $(C_) $(GLSRC)gslibctx.c
 
-$(GLOBJ)gslibctx_0.$(OBJ) : $(GLSRC)gslibctx.c  $(AK) $(gp_h) $(gpmisc_h) $(gsmemory_h)\
+$(GLOBJ)gslibctx_0.$(OBJ) : $(GLSRC)gslibctx.c  $(AK) $(gp_h) $(gpmisc_h) $(gpreadahead_h) $(gsmemory_h)\
   $(gslibctx_h) $(stdio__h) $(string__h) $(gsicc_manage_h) $(gserrors_h)\
   $(gscdefs_h) $(gsstruct_h)
 	$(GLCC) $(GLO_)gslibctx_0.$(OBJ) $(C_) $(GLSRC)gslibctx.c
@@ -373,7 +374,7 @@ $(GLOBJ)gslibctx_0.$(OBJ) : $(GLSRC)gslibctx.c  $(AK) $(gp_h) $(gpmisc_h) $(gsme
 $(GLOBJ)gslibctx.$(OBJ) : $(GLOBJ)gslibctx_$(WITH_CAL).$(OBJ)  $(AK) $(gp_h)
 	$(CP_) $(GLOBJ)gslibctx_$(WITH_CAL).$(OBJ) $(GLOBJ)gslibctx.$(OBJ)
 
-$(AUX)gslibctx.$(OBJ) : $(GLSRC)gslibctx.c  $(AK) $(gp_h) $(gsmemory_h)\
+$(AUX)gslibctx.$(OBJ) : $(GLSRC)gslibctx.c  $(AK) $(gp_h) $(gpreadahead_h) $(gsmemory_h)\
   $(gslibctx_h) $(stdio__h) $(string__h) $(gsicc_manage_h) $(gserrors_h)\
   $(gscdefs_h) $(gsstruct_h)
 	$(GLCCAUX) $(C_) $(AUXO_)gslibctx.$(OBJ) $(GLSRC)gslibctx.c
@@ -1545,16 +1546,21 @@ $(GLOBJ)gp_strdl.$(OBJ) : $(GLSRC)gp_strdl.c $(AK) $(std_h) $(gp_h)\
 # probably use them eventually.
 
 sfile_=$(GLOBJ)sfx$(FILE_IMPLEMENTATION).$(OBJ) $(GLOBJ)sfxcommon.$(OBJ)\
- $(GLOBJ)stream.$(OBJ)
+ $(GLOBJ)gpreadahead.$(OBJ) $(GLOBJ)stream.$(OBJ)
 
 $(GLD)sfile.dev : $(LIB_MAK) $(ECHOGS_XE) $(sfile_) $(LIB_MAK) $(MAKEDIRS)
 	$(SETMOD) $(GLD)sfile $(sfile_)
 
 $(GLOBJ)sfxcommon.$(OBJ) : $(GLSRC)sfxcommon.c $(AK) $(stdio__h)\
- $(memory__h) $(unistd__h) $(gsmemory_h) $(gp_h) $(stream_h)\
- $(gserrors_h) $(assert__h) $(LIB_MAK) $(MAKEDIRS)
+ $(memory__h) $(unistd__h) $(gsmemory_h) $(gdebug_h) $(gp_h) $(gpreadahead_h)\
+ $(stream_h) $(gserrors_h) $(gslibctx_h) $(assert__h) $(LIB_MAK) $(MAKEDIRS)
 	$(GLCC) $(GLO_)sfxcommon.$(OBJ) $(C_) $(GLSRC)sfxcommon.c
 
+$(GLOBJ)gpreadahead.$(OBJ) : $(GLSRC)gpreadahead.c $(AK) $(stdio__h)\
+ $(memory__h) $(gx_h) $(gp_h) $(gpsync_h) $(gxsync_h) $(gpreadahead_h)\
+ $(LIB_MAK) $(MAKEDIRS)
+	$(GLCC) $(GLO_)gpreadahead.$(OBJ) $(C_) $(GLSRC)gpreadahead.c
+
 $(GLOBJ)sfxstdio.$(OBJ) : $(GLSRC)sfxstdio.c $(AK) $(stdio__h)\
  $(memory__h) $(unistd__h) $(gdebug_h) $(gpcheck_h) $(stream_h) $(strimpl_h)\
  $(gp_h) $(gserrors_h) $(gsmemory_h) $(LIB_MAK) $(MAKEDIRS)
@@ -1912,7 +1918,7 @@ pngp_=$(GLOBJ)spngp.$(OBJ)
 $(GLD)pngp.dev : $(LIB_MAK) $(ECHOGS_XE) $(pngp_) $(LIB_MAK) $(MAKEDIRS)
 	$(SETMOD) $(GLD)pngp $(pngp_)
 
-$(GLOBJ)spngp.$(OBJ) : $(GLSRC)spngp.c $(AK) $(memory__h)\
+$(GLOBJ)spngp.$(OBJ) : $(GLSRC)spngp.c $(AK) $(memory__h) $(stdint__h)\
  $(spngpx_h) $(strimpl_h) $(LIB_MAK) $(MAKEDIRS)
 	$(GLCC) $(GLO_)spngp.$(OBJ) $(C_) $(GLSRC)spngp.c
 
@@ -3706,13 +3712,13 @@ $(GLOBJ)gp_dosfe.$(OBJ) : $(GLSRC)gp_dosfe.c $(AK)\
 $(GLOBJ)gp_unifs.$(OBJ) : $(GLSRC)gp_unifs.c $(AK)\
  $(memory__h) $(string__h) $(stdio__h) $(unistd__h) \
  $(gx_h) $(gp_h) $(gpmisc_h) $(gsstruct_h) $(gsutil_h) \
- $(stat__h) $(dirent__h) $(LIB_MAK) $(MAKEDIRS)
+ $(stat__h) $(dirent__h) $(errno__h) $(LIB_MAK) $(MAKEDIRS)
 	$(GLCC) $(GLO_)gp_unifs.$(OBJ) $(C_) $(GLSRC)gp_unifs.c
 
 $(AUX)gp_unifs.$(OBJ) : $(GLSRC)gp_unifs.c $(AK)\
  $(memory__h) $(string__h) $(stdio__h) $(unistd__h) \
  $(gx_h) $(gp_h) $(gpmisc_h) $(gsstruct_h) $(gsutil_h) \
- $(stat__h) $(dirent__h) $(LIB_MAK) $(MAKEDIRS)
+ $(stat__h) $(dirent__h) $(errno__h) $(LIB_MAK) $(MAKEDIRS)
 	$(GLCCAUX) $(AUXO_)gp_unifs.$(OBJ) $(C_) $(GLSRC)gp_unifs.c
 
 # Unix(-like) file name syntax, *not* used by Desqview/X.
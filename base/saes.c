@@ -136,8 +136,20 @@ s_aes_process(stream_state * ss, stream_cursor_read * pr,
         pr->ptr += 16;
     }
 
-    /* decrypt available blocks */
+    /* decrypt available blocks, all but a final one directly into the
+       output buffer */
     while (pr->ptr + 16 <= limit) {
+      long count = (limit - pr->ptr) & ~15;
+
+      if (last && pr->ptr + count == pr->limit)
+        count -= 16;
+      if (count > 0) {
+        aes_crypt_cbc(state->ctx, AES_DECRYPT, count, state->iv,
+                                  pr->ptr + 1, pw->ptr + 1);
+        pr->ptr += count;
+        pw->ptr += count;
+        continue;
+      }
       aes_crypt_cbc(state->ctx, AES_DECRYPT, 16, state->iv,
                                 pr->ptr + 1, temp);
       pr->ptr += 16;
@@ -99,6 +99,7 @@ typedef struct jpeg_decompress_data_s {
     bool faked_eoi;		/* true when fill_input_buffer inserted EOI */
     byte *scanline_buffer;	/* buffer for oversize scanline, or NULL */
     uint bytes_in_scanline;	/* # of bytes remaining to output from same */
+    int scanline_repeat;	/* # of further copies of same to output */
     int PassThrough;                    /* 0 or 1 */
     bool StartedPassThrough;            /* Don't signal multiple starts for the same decode */
     DCTD_PassThrough((*PassThroughfn)); /* We don't want the stream code or
@@ -123,6 +124,8 @@ typedef struct stream_DCT_state_s {
     float QFactor;
     int ColorTransform;		/* -1 if not specified */
     bool NoMarker;		/* DCTEncode only */
+    int Reduce;			/* DCTDecode only: decode at 1/2^Reduce */
+                                /* scale (0-3) and replicate the samples */
     gs_memory_t *jpeg_memory;	/* heap for library allocations */
     /* This is a pointer to immovable storage. */
     union _jd {
@@ -106,6 +106,7 @@ s_DCTD_init(stream_state * st)
     ss->data.decompress->skip = 0;
     ss->data.decompress->input_eod = false;
     ss->data.decompress->faked_eoi = false;
+    ss->data.decompress->scanline_repeat = 0;
     ss->phase = 0;
     return 0;
 }
@@ -171,6 +172,44 @@ update_jpeg_header_height(JOCTET *d, size_t len, int height)
     }
 }
 
+/*
+ * When decoding at a reduced scale, expand the scanline just decoded (which
+ * follows the full size scanline in scanline_buffer) back up to the full
+ * width, and work out how many times it has to be repeated to make up the
+ * full height. Returns false if the scanline lies outside the image.
+ */
+static bool
+dctd_expand_scanline(stream_DCT_state *ss)
+{
+    jpeg_decompress_data *jddp = ss->data.decompress;
+    int ncomps = jddp->dinfo.output_components;
+    uint out_width = jddp->dinfo.output_width;
+    uint width = jddp->dinfo.image_width;
+    uint height = jddp->dinfo.image_height;
+    uint first = (jddp->dinfo.output_scanline - 1) << ss->Reduce;
+    uint last, x, sx;
+    byte *src = jddp->scanline_buffer + ss->scan_line_size;
+    byte *dst = jddp->scanline_buffer;
+    int c;
+
+    if (first >= height)
+        return false;
+    if (jddp->dinfo.output_scanline == jddp->dinfo.output_height)
+        last = height;
+    else
+        last = min(first + (1 << ss->Reduce), height);
+
+    for (x = 0; x < width; x++) {
+        sx = x >> ss->Reduce;
+        if (sx >= out_width)
+            sx = out_width - 1;
+        for (c = 0; c < ncomps; c++)
+            *dst++ = src[sx * ncomps + c];
+    }
+    jddp->scanline_repeat = last - first - 1;
+    return true;
+}
+
 /* Process a buffer */
 static int
 s_DCTD_process(stream_state * st, stream_cursor_read * pr,
@@ -268,6 +307,16 @@ s_DCTD_process(stream_state * st, stream_cursor_read * pr,
             if (jddp->dinfo.saw_Adobe_marker)
                 ss->ColorTransform = jddp->dinfo.Adobe_transform;
 
+            /* Let the IDCT produce a smaller image if we've been asked to,
+             * the samples are replicated back up to the full size below. */
+            if (ss->Reduce > 0 && !jddp->PassThrough && jddp->dinfo.image_height != 0) {
+                if (ss->Reduce > 3)
+                    ss->Reduce = 3;
+                jddp->dinfo.scale_num = DCTSIZE >> ss->Reduce;
+                jddp->dinfo.scale_denom = DCTSIZE;
+            } else
+                ss->Reduce = 0;
+
             switch (jddp->dinfo.num_components) {
             case 3:
                 jddp->dinfo.jpeg_color_space =
@@ -294,13 +343,28 @@ s_DCTD_process(stream_state * st, stream_cursor_read * pr,
                     (jddp->PassThroughfn)(jddp->device, Buf, pr->ptr - (Buf - 1));
                 return 0;
             }
+            /* The library may not support IDCT scaling */
+            if (jddp->dinfo.output_width == jddp->dinfo.image_width)
+                ss->Reduce = 0;
             ss->scan_line_size =
-                jddp->dinfo.output_width * jddp->dinfo.output_components;
+                (ss->Reduce > 0 ? jddp->dinfo.image_width : jddp->dinfo.output_width) *
+                jddp->dinfo.output_components;
             if_debug4m('w', ss->memory, "[wdd]width=%u, components=%d, scan_line_size=%u, min_out_size=%u\n",
                        jddp->dinfo.output_width,
                        jddp->dinfo.output_components,
                        ss->scan_line_size, jddp->templat.min_out_size);
-            if (ss->scan_line_size > (uint) jddp->templat.min_out_size) {
+            if (ss->Reduce > 0) {
+                /* Full size scanline, followed by the reduced one */
+                jddp->scanline_buffer =
+                    gs_alloc_bytes_immovable(gs_memory_stable(jddp->memory),
+                                             ss->scan_line_size +
+                                             jddp->dinfo.output_width * jddp->dinfo.output_components,
+                                         "s_DCTD_process(scanline_buffer)");
+                if (jddp->scanline_buffer == NULL) {
+                    code = ERRC;
+                    goto error_out;
+                }
+            } else if (ss->scan_line_size > (uint) jddp->templat.min_out_size) {
                 /* Create a spare buffer for oversize scanline */
                 jddp->scanline_buffer =
                     gs_alloc_bytes_immovable(gs_memory_stable(jddp->memory),
@@ -338,7 +402,8 @@ s_DCTD_process(stream_state * st, stream_cursor_read * pr,
                 if ((jddp->bytes_in_scanline != 0) || /* no room for complete scan */
                     ((jddp->bytes_in_scanline == 0) && (tomove > 0) && /* 1 scancopy completed */
                      (avail < tomove) && /* still room for 1 more scan */
-                     (jddp->dinfo.output_height > jddp->dinfo.output_scanline))) /* more scans to do */
+                     (jddp->dinfo.output_height > jddp->dinfo.output_scanline ||
+                      jddp->scanline_repeat > 0))) /* more scans to do */
                 {
                      if (jddp->PassThrough && jddp->PassThroughfn) {
                         (jddp->PassThroughfn)(jddp->device, Buf, pr->ptr - (Buf - 1));
@@ -346,12 +411,20 @@ s_DCTD_process(stream_state * st, stream_cursor_read * pr,
                     return 1;	/* need more room */
                 }
             }
+            if (jddp->scanline_repeat > 0) {
+                /* Replicating a reduced scale scanline */
+                jddp->scanline_repeat--;
+                jddp->bytes_in_scanline = ss->scan_line_size;
+                goto dumpbuffer;
+            }
             /* while not done with image, decode 1 scan, otherwise fall into phase 4 */
             while (jddp->dinfo.output_height > jddp->dinfo.output_scanline) {
                 int read;
                 byte *samples;
 
-                if (jddp->scanline_buffer != NULL)
+                if (ss->Reduce > 0)
+                    samples = jddp->scanline_buffer + ss->scan_line_size;
+                else if (jddp->scanline_buffer != NULL)
                     samples = jddp->scanline_buffer;
                 else {
                     if ((uint) (pw->limit - pw->ptr) < ss->scan_line_size) {
@@ -397,6 +470,8 @@ s_DCTD_process(stream_state * st, stream_cursor_read * pr,
                     }
                     return 0;	/* need more data */
                 }
+                if (ss->Reduce > 0 && !dctd_expand_scanline(ss))
+                    continue;
                 if (jddp->scanline_buffer != NULL) {
                     jddp->bytes_in_scanline = ss->scan_line_size;
                     goto dumpbuffer;
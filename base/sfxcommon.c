@@ -20,8 +20,11 @@
 #include "memory_.h"
 #include "unistd_.h"
 #include "gsmemory.h"
+#include "gdebug.h"
 #include "gp.h"
+#include "gpreadahead.h"
 #include "gserrors.h"
+#include "gslibctx.h"
 #include "stream.h"
 #include "assert_.h"
 
@@ -140,6 +143,142 @@ file_close_file(stream * s)
     return 0;
 }
 
+/* ------ Memory mapped file reading ------ */
+
+/*
+ * A regular file opened read-only can be read through a mapping of the
+ * whole file, which then serves directly as the stream buffer: nothing is
+ * copied into a private buffer, and seeking just moves the read pointer.
+ * As with string streams, the process procedure only ever reports EOF.
+ * The mapping belongs to the gp_file, which stays open as s->file until
+ * the stream is closed.
+ *
+ * The buffer size of a stream is a uint; on 32 bit systems we also limit
+ * the size further so as not to exhaust the address space.
+ */
+#define MMAP_FILE_MAX_SIZE\
+  (sizeof(void *) > 4 ? (size_t)max_uint : (size_t)0x10000000)
+
+static int
+s_mmap_read_process(stream_state * st, stream_cursor_read * ignore_pr,
+                    stream_cursor_write * pw, bool last)
+{
+    return EOFC;
+}
+
+static int
+s_mmap_available(stream *s, gs_offset_t *pl)
+{
+    *pl = sbufavailable(s);
+    if (*pl == 0)
+        *pl = -1;		/* EOF */
+    return 0;
+}
+
+static int
+s_mmap_read_seek(stream *s, gs_offset_t pos)
+{
+    if (pos < 0 || pos > s->bsize)
+        return ERRC;
+    s->cursor.r.ptr = s->cbuf + pos - 1;
+    /* stream_compact may have emptied the buffer at EOF, see */
+    /* s_string_read_seek. */
+    s->cursor.r.limit = s->cbuf + s->bsize - 1;
+    s->position = 0;
+    return 0;
+}
+
+/* The whole file is in the buffer, so there is nothing to discard. */
+static void
+s_mmap_read_reset(stream *s)
+{
+}
+
+static int
+s_mmap_read_flush(stream *s)
+{
+    s->cursor.r.ptr = s->cursor.r.limit = s->cbuf + s->bsize - 1;
+    s->position = 0;
+    return 0;
+}
+
+static int
+s_mmap_read_close(stream *s)
+{
+    gp_file *file = s->file;
+
+    /* The buffer is the mapping: don't let file_close_file free it. */
+    s->cbuf = 0;
+    if (file != 0) {
+        s->file = 0;
+        return (gp_fclose(file) ? ERRC : 0);
+    }
+    return 0;
+}
+
+/*
+ * Set up a stream for reading a file through a memory mapping.  Return 0
+ * if successful, in which case the buffer allocated by the caller has been
+ * freed, or 1 if the file can't be mapped and should be read normally.
+ */
+static int
+sread_mmap_file(stream *s, gp_file *file, byte *buffer)
+{
+    static const stream_procs p = {
+        s_mmap_available, s_mmap_read_seek, s_mmap_read_reset,
+        s_mmap_read_flush, s_mmap_read_close, s_mmap_read_process,
+        NULL
+    };
+    const void *data;
+    size_t size;
+
+    if (!gs_lib_ctx_get_mmap_files(s->memory) || gp_ftell(file) != 0)
+        return 1;
+    data = gp_fmmap(file, MMAP_FILE_MAX_SIZE, &size);
+    if (data == NULL)
+        return 1;
+    gs_free_object(s->memory, buffer, "sread_mmap_file(buffer)");
+    s_std_init(s, (byte *)data, (uint)size, &p, s_mode_read + s_mode_seek);
+    s->foreign = 1;
+    s->end_status = EOFC;
+    s->cursor.r.limit = s->cursor.w.limit;
+    if_debug2m('s', s->memory, "[s]mmap file="PRI_INTPTR", size=%u\n",
+               (intptr_t)file, (uint)size);
+    s->file = file;
+    s->file_modes = s->modes;
+    s->file_offset = 0;
+    s->file_limit = S_FILE_LIMIT_MAX;
+    return 0;
+}
+
+/*
+ * Confine a memory mapped stream to a subfile, by narrowing the buffer.
+ * Return 1 if the stream isn't memory mapped, so that the caller can
+ * handle it as a normal file stream.
+ */
+int
+sread_mmap_subfile(stream *s, gs_offset_t start, gs_offset_t length)
+{
+    gs_offset_t pos;
+
+    if (s->procs.process != s_mmap_read_process)
+        return 1;
+    if (s->file == 0 || s->file_offset != 0 ||
+        s->file_limit != S_FILE_LIMIT_MAX ||
+        start < 0 || start > s->bsize || length < 0)
+        return ERRC;
+    if (length > s->bsize - start)
+        length = s->bsize - start;
+    pos = stell(s) - start;
+    if (pos < 0 || pos > length)
+        pos = 0;
+    s->cbuf += start;
+    s->bsize = s->cbsize = (uint)length;
+    s->file_offset = start;
+    s->file_limit = length;
+    return s_mmap_read_seek(s, pos);
+}
+
 /*
  * Set up a file stream on an OS file.  The caller has allocated the
  * stream and buffer.
@@ -159,6 +298,20 @@ file_init_stream(stream *s, gp_file *file, const char *fmode, byte *buffer,
             int char_buffered = gp_file_is_char_buffered(file);
             if (char_buffered < 0)
                 return char_buffered;
+            /* Map regular files that are only being read. If */
+            /* asked to, read other files and pipes ahead. */
+            if (!char_buffered && fmode[1] != '+') {
+                uint readahead = gs_lib_ctx_get_readahead_size(s->memory);
+
+                if (sread_mmap_file(s, file, buffer) == 0)
+                    break;
+                if (readahead != 0) {
+                    gp_file *rafile = gp_file_readahead_open(file, readahead);
+
+                    if (rafile != NULL)
+                        file = rafile;
+                }
+            }
             sread_file(s, file, buffer, char_buffered ? 1 : buffer_size);
         }
         break;
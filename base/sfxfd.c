@@ -140,6 +140,10 @@ sread_fileno(register stream * s, gp_file * file, byte * buf, uint len)
 int
 sread_subfile(stream *s, gs_offset_t start, gs_offset_t length)
 {
+    int code = sread_mmap_subfile(s, start, length);
+
+    if (code <= 0)
+        return code;
     if (s->file == 0 || s->modes != s_mode_read + s_mode_seek ||
         s->file_offset != 0 || s->file_limit != S_FILE_LIMIT_MAX ||
         ((s->position < start || s->position > start + length) &&
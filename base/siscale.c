@@ -24,6 +24,10 @@
 #include "siscale.h"
 #include "gxfrac.h"
 
+#ifdef HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
 /*
  *    Image scaling code is based on public domain code from
  *      Graphics Gems III (pp. 414-424), Academic Press, 1992.
@@ -478,6 +482,118 @@ zoom_x2(byte * gs_restrict tmp, const void /*PixelIn */ * gs_restrict src,
     }
 }
 
+#ifdef HAVE_SSE2
+/*
+ * SSE2 version of the vertical filter, used for all the output depths.
+ * Each weight w is split as w = hi * 2^15 + lo with 0 <= lo < 2^15, so
+ * that _mm_madd_epi16 can form the exact 32 bit products of pairs of
+ * rows, and the sums are the same as those of the scalar code.  Only
+ * handles up to ZOOM_Y_SSE2_MAX_N contributing rows (upscaling always
+ * uses 4 or 5); returns 0 if the row was not processed.
+ */
+#define ZOOM_Y_SSE2_MAX_N 8
+static int
+zoom_y_sse2(void /*PixelOut */ * gs_restrict dst,
+            const byte * gs_restrict tmp, int skip, int WidthOut, int Stride,
+            int Colors, const CLIST * gs_restrict contrib,
+            const CONTRIB * gs_restrict items, int sizeofPixelOut, int MaxValueOut)
+{
+    int kn = Stride * Colors;
+    int width = WidthOut * Colors;
+    int cn = contrib->n;
+    int npairs = (cn + 1) >> 1;
+    const CONTRIB *gs_restrict cbp = items + contrib->index;
+    const byte *rows[ZOOM_Y_SSE2_MAX_N + 1];
+    __m128i wlo[ZOOM_Y_SSE2_MAX_N / 2], whi[ZOOM_Y_SSE2_MAX_N / 2];
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi32(CONTRIB_ROUND);
+    const __m128i maxv = _mm_set1_epi32(MaxValueOut);
+    const __m128i bias32 = _mm_set1_epi32(0x8000);
+    const __m128i bias16 = _mm_set1_epi16(-0x8000);
+    int i, x;
+
+#ifdef DEBUG
+    if (gs_debug_c('W'))
+        return 0;
+#endif
+    if (cn < 2 || cn > ZOOM_Y_SSE2_MAX_N)
+        return 0;
+    for (i = 0; i < cn; i++)
+        if (cbp[i].weight >= (1 << 30) || cbp[i].weight < -(1 << 30))
+            return 0;
+
+    skip *= Colors;
+    tmp += contrib->first_pixel + skip;
+    for (i = 0; i < cn; i++)
+        rows[i] = tmp + i * kn;
+    rows[cn] = NULL;
+    for (i = 0; i < npairs; i++) {
+        int w0 = cbp[2 * i].weight;
+        int w1 = (2 * i + 1 < cn ? cbp[2 * i + 1].weight : 0);
+
+        wlo[i] = _mm_set1_epi32(((w1 & 0x7fff) << 16) | (w0 & 0x7fff));
+        whi[i] = _mm_set1_epi32((int)(((unsigned int)(w1 >> 15) << 16) |
+                                      ((w0 >> 15) & 0xffff)));
+    }
+
+    for (x = 0; x + 8 <= width; x += 8) {
+        __m128i lo0 = zero, lo1 = zero, hi0 = zero, hi1 = zero;
+        __m128i s0, s1;
+
+        for (i = 0; i < npairs; i++) {
+            __m128i ra = _mm_unpacklo_epi8(
+                _mm_loadl_epi64((const __m128i *)(rows[2 * i] + x)), zero);
+            __m128i rb = (rows[2 * i + 1] == NULL ? zero :
+                _mm_unpacklo_epi8(
+                  _mm_loadl_epi64((const __m128i *)(rows[2 * i + 1] + x)), zero));
+            __m128i p0 = _mm_unpacklo_epi16(ra, rb);
+            __m128i p1 = _mm_unpackhi_epi16(ra, rb);
+
+            lo0 = _mm_add_epi32(lo0, _mm_madd_epi16(p0, wlo[i]));
+            lo1 = _mm_add_epi32(lo1, _mm_madd_epi16(p1, wlo[i]));
+            hi0 = _mm_add_epi32(hi0, _mm_madd_epi16(p0, whi[i]));
+            hi1 = _mm_add_epi32(hi1, _mm_madd_epi16(p1, whi[i]));
+        }
+        s0 = _mm_add_epi32(_mm_add_epi32(_mm_slli_epi32(hi0, 15), lo0), round);
+        s1 = _mm_add_epi32(_mm_add_epi32(_mm_slli_epi32(hi1, 15), lo1), round);
+        s0 = _mm_srai_epi32(s0, CONTRIB_SHIFT);
+        s1 = _mm_srai_epi32(s1, CONTRIB_SHIFT);
+        if (sizeofPixelOut == 1) {
+            /* Saturating packs clamp to 0..255 just as CLAMP does. */
+            s0 = _mm_packs_epi32(s0, s1);
+            _mm_storel_epi64((__m128i *)((byte *)dst + skip + x),
+                             _mm_packus_epi16(s0, s0));
+        } else {
+            __m128i m;
+
+            /* CLAMP(pixel, 0, MaxValueOut), then pack as unsigned 16 bit. */
+            s0 = _mm_and_si128(s0, _mm_cmpgt_epi32(s0, zero));
+            s1 = _mm_and_si128(s1, _mm_cmpgt_epi32(s1, zero));
+            m = _mm_cmpgt_epi32(s0, maxv);
+            s0 = _mm_or_si128(_mm_and_si128(m, maxv), _mm_andnot_si128(m, s0));
+            m = _mm_cmpgt_epi32(s1, maxv);
+            s1 = _mm_or_si128(_mm_and_si128(m, maxv), _mm_andnot_si128(m, s1));
+            s0 = _mm_packs_epi32(_mm_sub_epi32(s0, bias32), _mm_sub_epi32(s1, bias32));
+            _mm_storeu_si128((__m128i *)((bits16 *)dst + skip + x),
+                             _mm_sub_epi16(s0, bias16));
+        }
+    }
+    for (; x < width; x++) {
+        int weight = 0;
+        int pixel;
+
+        for (i = 0; i < cn; i++)
+            weight += rows[i][x] * cbp[i].weight;
+        pixel = (weight + CONTRIB_ROUND)>>CONTRIB_SHIFT;
+        if (sizeofPixelOut == 1)
+            ((byte *)dst)[skip + x] = (byte)CLAMP(pixel, 0, 0xff);
+        else
+            ((bits16 *)dst)[skip + x] = (bits16)CLAMP(pixel, 0, MaxValueOut);
+    }
+    return 1;
+}
+#endif
+
 /*
  * Apply filter to zoom vertically from tmp to dst.
  * This is simpler because we can treat all columns identically
@@ -591,6 +707,11 @@ static void zoom_y1(void /*PixelOut */ * gs_restrict dst,
                  const byte * gs_restrict tmp, int skip, int WidthOut, int Stride,
                  int Colors, const CLIST * gs_restrict contrib, const CONTRIB * gs_restrict items)
 {
+#ifdef HAVE_SSE2
+    if (zoom_y_sse2(dst, tmp, skip, WidthOut, Stride, Colors, contrib, items,
+                    1, 0xff))
+        return;
+#endif
     switch(contrib->n) {
         case 4:
             zoom_y1_4(dst, tmp, skip, WidthOut, Stride, Colors, contrib, items);
@@ -712,6 +833,11 @@ zoom_y2(void /*PixelOut */ * gs_restrict dst,
        const byte * gs_restrict tmp, int skip, int WidthOut, int Stride,
        int Colors, const CLIST * gs_restrict contrib, const CONTRIB * gs_restrict items)
 {
+#ifdef HAVE_SSE2
+    if (zoom_y_sse2(dst, tmp, skip, WidthOut, Stride, Colors, contrib, items,
+                    2, 0xffff))
+        return;
+#endif
     switch (contrib->n) {
         case 4:
             zoom_y2_4(dst, tmp, skip, WidthOut, Stride, Colors, contrib, items);
@@ -834,6 +960,11 @@ zoom_y2_frac(void /*PixelOut */ * gs_restrict dst,
              const byte * gs_restrict tmp, int skip, int WidthOut, int Stride,
             int Colors, const CLIST * gs_restrict contrib, const CONTRIB * gs_restrict items)
 {
+#ifdef HAVE_SSE2
+    if (zoom_y_sse2(dst, tmp, skip, WidthOut, Stride, Colors, contrib, items,
+                    2, frac_1))
+        return;
+#endif
     switch (contrib->n) {
         case 4:
             zoom_y2_frac_4(dst, tmp, skip, WidthOut, Stride, Colors, contrib, items);
@@ -312,28 +312,38 @@ s_opjd_set_codec_format(stream_state * ss, OPJ_CODEC_FORMAT format)
     return 0;
 }
 
+/* The conversion constants are exact decimals, so integer arithmetic scaled
+ * by their denominators gives the same results as the double precision
+ * formulae (truncation and flooring only differ for negative values, which
+ * are clamped to 0 anyway).
+ */
+static inline int
+floor_div(int a, int b)
+{
+    return (a >= 0 ? a / b : -((b - 1 - a) / b));
+}
+
 static void
 ycc_to_rgb_8(unsigned char *row, unsigned long row_size)
 {
-    unsigned char y;
-    signed char u, v;
+    int y, u, v;
     int r,g,b;
     do
     {
         y = row[0];
         u = row[1] - 128;
         v = row[2] - 128;
-        r = (int)((double)y + 1.402 * v);
+        r = y + floor_div(1402 * v, 1000);
         if (r < 0)
             r = 0;
         if (r > 255)
             r = 255;
-        g = (int)((double)y - 0.34413 * u - 0.71414 * v);
+        g = y + floor_div(-34413 * u - 71414 * v, 100000);
         if (g < 0)
             g = 0;
         if (g > 255)
             g = 255;
-        b = (int)((double)y + 1.772 * u);
+        b = y + floor_div(1772 * u, 1000);
         if (b < 0)
             b = 0;
         if (b > 255)
@@ -385,9 +395,53 @@ ycc_to_rgb_16(unsigned char *row, unsigned long row_size)
     while (row_size);
 }
 
+/* Work out how many resolution levels we can really drop (if any were
+ * requested). Palette indices can't be averaged, and the replication in
+ * process_one_trunk only handles whole bytes per sample.
+ */
+static int set_reduce_factor(stream_jpxd_state * const state)
+{
+    opj_codestream_info_v2_t *info;
+    int compno, reduce = state->reduce;
+
+    if (reduce <= 0)
+        return 0;
+    if (state->colorspace == gs_jpx_cs_indexed)
+        return 0;
+    for (compno = 0; compno < state->image->numcomps; compno++)
+    {
+        int prec = state->image->comps[compno].prec;
+
+        if (prec != 8 && prec != 12 && prec != 16)
+            return 0;
+    }
+
+    info = opj_get_cstr_info(state->codec);
+    if (info == NULL)
+        return 0;
+    if (info->m_default_tile_info.tccp_info != NULL)
+    {
+        for (compno = 0; compno < info->nbcomps; compno++)
+        {
+            int numres = info->m_default_tile_info.tccp_info[compno].numresolutions;
+
+            if (reduce > numres - 1)
+                reduce = numres - 1;
+        }
+    }
+    else
+        reduce = 0;
+    opj_destroy_cstr_info(&info);
+
+    if (reduce > 0 && !opj_set_decoded_resolution_factor(state->codec, reduce))
+        reduce = 0;
+    return reduce;
+}
+
 static int decode_image(stream_jpxd_state * const state)
 {
     int numprimcomp = 0, alpha_comp = -1, compno, rowbytes;
+    int full_width = 0, full_height = 0;
 
     /* read header */
     if (!opj_read_header(state->stream, state->codec, &(state->image)))
@@ -396,6 +450,18 @@ static int decode_image(stream_jpxd_state * const state)
     	return ERRC;
     }
 
+    /* The header gives the full size, decoding at a reduced resolution
+     * shrinks the components, but we still return full size data.
+     */
+    for(compno = 0; compno < state->image->numcomps; compno++)
+    {
+        if (full_width < state->image->comps[compno].w)
+            full_width = state->image->comps[compno].w;
+        if (full_height < state->image->comps[compno].h)
+            full_height = state->image->comps[compno].h;
+    }
+    state->reduce = set_reduce_factor(state);
+
     /* decode the stream and fill the image structure */
     if (!opj_decode(state->codec, state->stream, state->image))
     {
@@ -423,6 +489,11 @@ static int decode_image(stream_jpxd_state * const state)
                 state->image->comps[compno].dy != state->image->comps[0].dy)
             state->samescale = false;
     }
+    if (state->reduce > 0)
+    {
+        state->width = full_width;
+        state->height = full_height;
+    }
 
     /* find alpha component and regular colour component by channel definition */
     for (compno = 0; compno < state->image->numcomps; compno++)
@@ -557,6 +628,38 @@ static int process_one_trunk(stream_jpxd_state * const state, stream_cursor_writ
                 /* return 0xff for all */
                 memset(row, 0xff, row_size);
             }
+            else if (state->reduce > 0)
+            {
+                /* Reduced resolution, replicate the samples up to the
+                   full size. bpp is 8 or 16 here. */
+                int ncomps = state->alpha ? 1 : img_numcomps;
+
+                for (compno = 0; compno < ncomps; compno++)
+                {
+                    opj_image_comp_t *comp = &state->image->comps[state->alpha ? state->alpha_comp : compno];
+                    unsigned int sy = (y_offset / comp->dy) >> state->reduce;
+
+                    if (sy >= comp->h)
+                        sy = comp->h - 1;
+                    state->pdata[compno] = &comp->data[sy * comp->w];
+                }
+                for (i = 0; i < state->width; i++)
+                {
+                    for (compno = 0; compno < ncomps; compno++)
+                    {
+                        int in_comp = state->alpha ? state->alpha_comp : compno;
+                        opj_image_comp_t *comp = &state->image->comps[in_comp];
+                        unsigned int sx = (i / comp->dx) >> state->reduce;
+                        int v;
+
+                        if (sx >= comp->w)
+                            sx = comp->w - 1;
+                        v = state->pdata[compno][sx] << shift_bit;
+                        for (b=0; b<bytepp1; b++)
+                            *row++ = (v >> (8*(bytepp1-b-1))) + (b==0 ? state->sign_comps[in_comp] : 0);
+                    }
+                }
+            }
             else if (state->samescale)
             {
                 if (state->alpha)
@@ -787,6 +890,7 @@ s_opjd_set_defaults(stream_state * ss) {
 
     state->alpha = false;
     state->colorspace = gs_jpx_cs_rgb;
+    state->reduce = 0;
     state->StartedPassThrough = 0;
     state->PassThrough = 0;
     state->PassThroughfn = NULL;
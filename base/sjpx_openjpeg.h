@@ -56,6 +56,8 @@ typedef struct stream_jpxd_state_s
     opj_image_t *image;
     int width, height, bpp;
     bool samescale;
+    int reduce; /* discard this many resolution levels, replicating the
+                 * decoded samples back up to the full image size */
 
     gs_jpx_cs colorspace;	/* requested output colorspace */
     bool alpha; /* return opacity channel */
@@ -16,9 +16,14 @@
 
 /* PNG pixel prediction filters */
 #include "memory_.h"
+#include "stdint_.h"
 #include "strimpl.h"
 #include "spngpx.h"
 
+#ifdef HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
 /* ------ PNGPredictorEncode/Decode ------ */
 
 private_st_PNGP_state();
@@ -137,6 +142,156 @@ paeth_predictor(int a, int b, int c)
 
     return (pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
 }
+
+#ifdef HAVE_SSE2
+/*
+ * SSE2 versions of the decoding predictors.  Up has no dependency between
+ * bytes, so is done 16 bytes at a time.  The others depend on the pixel
+ * to the left, so are done a pixel at a time, with the pixel's bytes in
+ * parallel (Paeth in 16 bit lanes); this is only done for 3, 4, 6 or 8
+ * bytes per pixel.  The results are the same as those of the scalar code.
+ * Returns the number of bytes processed, which is a multiple of 16 for Up
+ * and of bpp for the others; the caller does the rest.
+ */
+static inline uint32_t
+pngp_load_u32(const byte *p, int n)
+{
+    uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16);
+
+    return (n == 4 ? v | ((uint32_t)p[3] << 24) : v);
+}
+static inline void
+pngp_store_u32(byte *q, uint32_t v, int n)
+{
+    q[0] = (byte)v, q[1] = (byte)(v >> 8), q[2] = (byte)(v >> 16);
+    if (n == 4)
+        q[3] = (byte)(v >> 24);
+}
+static inline __m128i
+pngp_load_pixel(const byte *p, int bpp)
+{
+    __m128i x;
+
+    if (bpp == 8)
+        return _mm_loadl_epi64((const __m128i *)p);
+    x = _mm_cvtsi32_si128((int)pngp_load_u32(p, min(bpp, 4)));
+    if (bpp == 6)
+        x = _mm_insert_epi16(x, p[4] | (p[5] << 8), 2);
+    return x;
+}
+static inline void
+pngp_store_pixel(byte *q, __m128i x, int bpp)
+{
+    if (bpp == 8) {
+        _mm_storel_epi64((__m128i *)q, x);
+        return;
+    }
+    pngp_store_u32(q, (uint32_t)_mm_cvtsi128_si32(x), min(bpp, 4));
+    if (bpp == 6) {
+        int v = _mm_extract_epi16(x, 2);
+
+        q[4] = (byte)v, q[5] = (byte)(v >> 8);
+    }
+}
+static inline __m128i
+pngp_select(__m128i mask, __m128i t, __m128i e)
+{
+    return _mm_or_si128(_mm_and_si128(mask, t), _mm_andnot_si128(mask, e));
+}
+static inline __m128i
+pngp_abs16(__m128i x)
+{
+    return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+/* Called with a constant bpp, so that the loads and stores are inlined. */
+static inline uint
+pngp_decode_pixels_sse2(int case_index, int bpp, byte *q, const byte *dprev,
+                        const byte *p, const byte *upprev, const byte *up,
+                        uint count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi8(1);
+    __m128i a, b, c, x;
+    uint done = 0;
+
+    a = pngp_load_pixel(dprev, bpp);
+    switch (case_index) {
+        case cDecode + cSub:
+            for (; done + bpp <= count; done += bpp) {
+                a = _mm_add_epi8(pngp_load_pixel(p + done, bpp), a);
+                pngp_store_pixel(q + done, a, bpp);
+            }
+            break;
+        case cDecode + cAverage:
+            for (; done + bpp <= count; done += bpp) {
+                b = pngp_load_pixel(up + done, bpp);
+                /* _mm_avg_epu8 rounds up; we need to round down. */
+                x = _mm_sub_epi8(_mm_avg_epu8(a, b),
+                                 _mm_and_si128(_mm_xor_si128(a, b), one));
+                a = _mm_add_epi8(pngp_load_pixel(p + done, bpp), x);
+                pngp_store_pixel(q + done, a, bpp);
+            }
+            break;
+        case cDecode + cPaeth:
+            a = _mm_unpacklo_epi8(a, zero);
+            c = _mm_unpacklo_epi8(pngp_load_pixel(upprev, bpp), zero);
+            for (; done + bpp <= count; done += bpp) {
+                __m128i pa, pb, pc, smallest;
+
+                b = _mm_unpacklo_epi8(pngp_load_pixel(up + done, bpp), zero);
+                /* As in paeth_predictor: pa = |b - c|, pb = |a - c|. */
+                pa = _mm_sub_epi16(b, c);
+                pb = _mm_sub_epi16(a, c);
+                pc = pngp_abs16(_mm_add_epi16(pa, pb));
+                pa = pngp_abs16(pa);
+                pb = pngp_abs16(pb);
+                smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+                x = pngp_select(_mm_cmpeq_epi16(pb, smallest), b, c);
+                x = pngp_select(_mm_cmpeq_epi16(pa, smallest), a, x);
+                x = _mm_add_epi8(pngp_load_pixel(p + done, bpp),
+                                 _mm_packus_epi16(x, zero));
+                pngp_store_pixel(q + done, x, bpp);
+                a = _mm_unpacklo_epi8(x, zero);
+                c = b;
+            }
+            break;
+    }
+    return done;
+}
+static uint
+s_pngp_decode_sse2(int case_index, int bpp, byte *q, const byte *dprev,
+                   const byte *p, const byte *upprev, const byte *up,
+                   uint count)
+{
+    uint done = 0;
+
+    if (case_index == cDecode + cUp) {
+        for (; done + 16 <= count; done += 16) {
+            __m128i x =
+                _mm_add_epi8(_mm_loadu_si128((const __m128i *)(p + done)),
+                             _mm_loadu_si128((const __m128i *)(up + done)));
+
+            _mm_storeu_si128((__m128i *)(q + done), x);
+        }
+        return done;
+    }
+    switch (bpp) {
+        case 3:
+            return pngp_decode_pixels_sse2(case_index, 3, q, dprev, p,
+                                           upprev, up, count);
+        case 4:
+            return pngp_decode_pixels_sse2(case_index, 4, q, dprev, p,
+                                           upprev, up, count);
+        case 6:
+            return pngp_decode_pixels_sse2(case_index, 6, q, dprev, p,
+                                           upprev, up, count);
+        case 8:
+            return pngp_decode_pixels_sse2(case_index, 8, q, dprev, p,
+                                           upprev, up, count);
+    }
+    return 0;
+}
+#endif
 static void
 s_pngp_process(stream_state * st, stream_cursor_write * pw,
                const byte * dprev, stream_cursor_read * pr,
@@ -149,6 +304,15 @@ s_pngp_process(stream_state * st, stream_cursor_write * pw,
     pr->ptr += count;
     pw->ptr += count;
     ss->row_left -= count;
+#ifdef HAVE_SSE2
+    if (ss->case_index > cDecode + cNone) {
+        uint done = s_pngp_decode_sse2(ss->case_index, ss->bpp, q, dprev, p,
+                                       upprev, up, count);
+
+        q += done, dprev += done, p += done;
+        upprev += done, up += done, count -= done;
+    }
+#endif
     switch (ss->case_index) {
         case cEncode + cNone:
         case cDecode + cNone:
@@ -146,10 +146,12 @@ typedef struct gp_file_s gp_file;
 #endif
 
 /* Define ourselves a 'forceinline' we can use to more forcefully
- * tell the compiler to inline something. On all but MSVC this can
- * drop back to inline. */
+ * tell the compiler to inline something. On compilers other than
+ * MSVC and gcc (or compatibles) this can drop back to inline. */
 #ifdef _MSC_VER
 #define forceinline __forceinline
+#elif defined(__GNUC__)
+#define forceinline inline __attribute__((always_inline))
 #else
 #define forceinline inline
 #endif
@@ -397,6 +397,9 @@ int  sappend_file(stream *, gp_file *, byte *, uint);
 
 /* Confine reading to a subfile.  This is primarily for reusable streams. */
 int sread_subfile(stream *s, gs_offset_t start, gs_offset_t length);
+/* The same for memory mapped file streams (sfxcommon.c); */
+/* returns 1 if the stream isn't memory mapped. */
+int sread_mmap_subfile(stream *s, gs_offset_t start, gs_offset_t length);
 
 /* Set the file name of a stream, copying the name. */
 /* Return <0 if the copy could not be allocated. */
@@ -26,10 +26,13 @@
 #include "gdevpdfx.h"
 #include "gdevpdfg.h"		/* only for pdf_reset_graphics */
 #include "gdevpdfo.h"
+#include "strimpl.h"
+#include "szlibx.h"
 #include "smd5.h"
 #include "sarc4.h"
 #include "gscms.h"
 #include "gdevpdtf.h"
+#include "gdevpdtb.h"
 #include "gdevpdtx.h"
 #include "gdevpdtd.h"
 #include "gdevpdti.h"
@@ -127,6 +130,9 @@ ENUM_PTRS_WITH(device_pdfwrite_enum_ptrs, gx_device_pdf *pdev)
  ENUM_PTR(40, gx_device_pdf, pdf_font_dir);
  ENUM_PTR(41, gx_device_pdf, ExtensionMetadata);
  ENUM_PTR(42, gx_device_pdf, PassThroughWriter);
+ ENUM_PTR(43, gx_device_pdf, ObjStm.strm);
+ ENUM_PTR(44, gx_device_pdf, ObjStm.strm_buf);
+ ENUM_PTR(45, gx_device_pdf, ObjStm.save_strm);
 #define e1(i,elt) ENUM_PARAM_STRING_PTR(i + gx_device_pdf_num_ptrs, gx_device_pdf, elt);
 gx_device_pdf_do_param_strings(e1)
 #undef e1
@@ -180,6 +186,9 @@ static RELOC_PTRS_WITH(device_pdfwrite_reloc_ptrs, gx_device_pdf *pdev)
  RELOC_PTR(gx_device_pdf, pdf_font_dir);
  RELOC_PTR(gx_device_pdf, ExtensionMetadata);
  RELOC_PTR(gx_device_pdf, PassThroughWriter);
+ RELOC_PTR(gx_device_pdf, ObjStm.strm);
+ RELOC_PTR(gx_device_pdf, ObjStm.strm_buf);
+ RELOC_PTR(gx_device_pdf, ObjStm.save_strm);
 #define r1(i,elt) RELOC_PARAM_STRING_PTR(gx_device_pdf,elt);
         gx_device_pdf_do_param_strings(r1)
 #undef r1
@@ -192,6 +201,8 @@ static RELOC_PTRS_WITH(device_pdfwrite_reloc_ptrs, gx_device_pdf *pdev)
         for (i = 0; i < NUM_RESOURCE_TYPES; ++i)
             for (j = 0; j < NUM_RESOURCE_CHAINS; ++j)
                 RELOC_PTR(gx_device_pdf, resources[i].chains[j]);
+        pdf_invalidate_resource_indices(pdev);
+        pdf_invalidate_image_hashes(pdev);
         if (pdev->outline_levels) {
             for (i = 0; i <= pdev->outline_depth; ++i) {
                 RELOC_PTR(gx_device_pdf, outline_levels[i].first.action);
@@ -346,6 +357,13 @@ pdf_close_files(gx_device_pdf * pdev, int code)
     code = pdf_close_temp_file(pdev, &pdev->pictures, code);
     code = pdf_close_temp_file(pdev, &pdev->streams, code);
     code = pdf_close_temp_file(pdev, &pdev->asides, code);
+    code = pdf_close_temp_file(pdev, &pdev->ObjStm, code);
+    gs_free_object(pdev->pdf_memory->non_gc_memory, pdev->asides_map,
+                   "pdf_close_files(asides_map)");
+    pdev->asides_map = NULL;
+    pdev->asides_map_count = pdev->asides_map_size = 0;
+    pdf_free_font_compression(pdev);
+    pdf_free_image_hashes(pdev);
     return pdf_close_temp_file(pdev, &pdev->xref, code);
 }
 
@@ -782,9 +800,14 @@ pdf_open(gx_device * dev)
     if ((code = pdf_open_temp_file(pdev, &pdev->xref)) < 0 ||
         (code = pdf_open_temp_stream(pdev, &pdev->asides)) < 0 ||
         (code = pdf_open_temp_stream(pdev, &pdev->streams)) < 0 ||
-        (code = pdf_open_temp_stream(pdev, &pdev->pictures)) < 0
+        (code = pdf_open_temp_stream(pdev, &pdev->pictures)) < 0 ||
+        (pdev->WriteXRefStm &&
+         (code = pdf_open_temp_stream(pdev, &pdev->ObjStm)) < 0)
         )
         goto fail;
+    pdev->ObjStm_id = 0;
+    pdev->NumObjStmObjects = 0;
+    pdev->asides_flushed = 0;
     code = gdev_vector_open_file((gx_device_vector *) pdev, sbuf_size);
     if (code < 0)
         goto fail;
@@ -869,10 +892,13 @@ pdf_open(gx_device * dev)
     {
         int i, j;
 
-        for (i = 0; i < NUM_RESOURCE_TYPES; ++i)
+        for (i = 0; i < NUM_RESOURCE_TYPES; ++i) {
             for (j = 0; j < NUM_RESOURCE_CHAINS; ++j)
                 pdev->resources[i].chains[j] = 0;
+            pdev->resources[i].index = NULL;
+        }
     }
+    pdev->resource_chain_seq = 0;
     pdev->outline_levels = (pdf_outline_level_t *)gs_alloc_bytes(mem, INITIAL_MAX_OUTLINE_DEPTH * sizeof(pdf_outline_level_t), "outline_levels array");
     memset(pdev->outline_levels, 0x00, INITIAL_MAX_OUTLINE_DEPTH * sizeof(pdf_outline_level_t));
     pdev->max_outline_depth = INITIAL_MAX_OUTLINE_DEPTH;
@@ -1016,6 +1042,85 @@ pdf_print_orientation(gx_device_pdf * pdev, pdf_page_t *page)
     }
 }
 
+/*
+ * Copy the asides written so far to the output, and start the asides file
+ * again from the beginning. This is used with StreamPages at the end of
+ * each page, when no object is being written to either file, so that the
+ * resources first used by a page follow its contents in the output instead
+ * of accumulating until the end of the document. Fonts are only written
+ * when the device is closed, so they are still collected there.
+ * The asides file is rewound but not truncated, and the separate file that
+ * holds the data of cos streams (pdev->streams) is not recycled at all,
+ * since streams written later (fonts, pdfmark objects) may still refer to
+ * any part of it.
+ */
+static int
+pdf_flush_asides(gx_device_pdf * pdev)
+{
+    stream *s = pdev->strm;
+    gs_offset_t length;
+    pdf_asides_piece_t *piece;
+    int code;
+
+    sflush(pdev->asides.strm);
+    length = stell(pdev->asides.strm);
+    if (length == 0)
+        return 0;
+    if (pdev->asides_map_count == pdev->asides_map_size) {
+        gs_memory_t *mem = pdev->pdf_memory->non_gc_memory;
+        int size = (pdev->asides_map_size == 0 ? 64 : pdev->asides_map_size * 2);
+        pdf_asides_piece_t *map = (pdf_asides_piece_t *)
+            gs_alloc_bytes(mem, size * sizeof(*map), "pdf_flush_asides");
+
+        if (map == NULL)
+            return_error(gs_error_VMerror);
+        if (pdev->asides_map_count > 0)
+            memcpy(map, pdev->asides_map, pdev->asides_map_count * sizeof(*map));
+        gs_free_object(mem, pdev->asides_map, "pdf_flush_asides");
+        pdev->asides_map = map;
+        pdev->asides_map_size = size;
+    }
+    piece = &pdev->asides_map[pdev->asides_map_count++];
+    piece->asides_pos = pdev->asides_flushed;
+    piece->file_pos = stell(s);
+    if (gp_fseek(pdev->asides.file, 0, SEEK_SET) != 0)
+        return_error(gs_error_ioerror);
+    code = pdf_copy_data(s, pdev->asides.file, length, NULL);
+    if (code < 0)
+        return code;
+    if (sseek(pdev->asides.strm, 0) < 0)
+        return_error(gs_error_ioerror);
+    pdev->asides_flushed += length;
+    return 0;
+}
+
+/*
+ * Map a position in the asides data (including ASIDES_BASE_POSITION) to
+ * a position in the output. Data not yet flushed by pdf_flush_asides is
+ * copied to resource_pos when the device is closed.
+ */
+static gs_offset_t
+pdf_asides_file_pos(const gx_device_pdf * pdev, gs_offset_t pos,
+                    gs_offset_t resource_pos)
+{
+    gs_offset_t off = pos - ASIDES_BASE_POSITION;
+    const pdf_asides_piece_t *map = pdev->asides_map;
+    int lo = 0, hi = pdev->asides_map_count;
+
+    if (off >= pdev->asides_flushed)
+        return resource_pos + off - pdev->asides_flushed;
+    /* Find the last piece that starts at or before off. */
+    while (hi - lo > 1) {
+        int mid = (lo + hi) / 2;
+
+        if (map[mid].asides_pos <= off)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return map[lo].file_pos + off - map[lo].asides_pos;
+}
+
 /* Close the current page. */
 static int
 pdf_close_page(gx_device_pdf * pdev, int num_copies)
@@ -1120,6 +1225,13 @@ pdf_close_page(gx_device_pdf * pdev, int num_copies)
         if(pdf_ferror(pdev))
             return(gs_note_error(gs_error_ioerror));
     }
+    if (pdev->StreamPages && !pdev->ForOPDFRead && pdev->strm != NULL &&
+        pdev->sbstack_depth == 0 &&
+        pdev->strm != pdev->asides.strm && pdev->asides.save_strm == NULL) {
+        code = pdf_flush_asides(pdev);
+        if (code < 0)
+            return code;
+    }
     pdf_reset_page(pdev);
     return (pdf_ferror(pdev) ? gs_note_error(gs_error_ioerror) : 0);
 }
@@ -1157,8 +1269,8 @@ pdf_write_page(gx_device_pdf *pdev, int page_num)
     page_id = pdf_page_id(pdev, page_num);
 
     /* If we have not been given a MediaBox overriding pdfmark, use the current media size. */
+    pdf_open_compressible_obj(pdev, page_id, resourcePage);
     s = pdev->strm;
-    pdf_open_obj(pdev, page_id, resourcePage);
 
     if (v_mediabox == NULL ) {
         mediabox[2] = round_box_coord(page->MediaBox.x);
@@ -1580,7 +1692,7 @@ static int find_end_xref_section (gx_device_pdf *pdev, gp_file *tfile, int64_t s
             if (r != 1)
                 return(gs_note_error(gs_error_ioerror));
             if (pos & ASIDES_BASE_POSITION)
-                pos += resource_pos - ASIDES_BASE_POSITION;
+                pos = pdf_asides_file_pos(pdev, pos, resource_pos);
             pos -= pdev->OPDFRead_procset_length;
             if (pos == 0) {
                 return i;
@@ -1606,7 +1718,7 @@ static int write_xref_section(gx_device_pdf *pdev, gp_file *tfile, int64_t start
             if (r != 1)
                 return(gs_note_error(gs_error_ioerror));
             if (pos & ASIDES_BASE_POSITION)
-                pos += resource_pos - ASIDES_BASE_POSITION;
+                pos = pdf_asides_file_pos(pdev, pos, resource_pos);
             pos -= pdev->OPDFRead_procset_length;
 
             /* check to see we haven't got an offset which is too large to represent
@@ -1633,6 +1745,108 @@ static int write_xref_section(gx_device_pdf *pdev, gp_file *tfile, int64_t start
     return 0;
 }
 
+/* Write one entry of a cross-reference stream, using the widths /W [1 w 2]. */
+static void
+put_xref_stream_entry(stream *s, int type, gs_offset_t field2, int w, int field3)
+{
+    byte entry[1 + 8 + 2];
+    int i;
+
+    entry[0] = (byte)type;
+    for (i = 0; i < w; ++i)
+        entry[1 + i] = (byte)(field2 >> (8 * (w - 1 - i)));
+    entry[1 + w] = (byte)(field3 >> 8);
+    entry[2 + w] = (byte)field3;
+    stream_write(s, entry, w + 3);
+}
+
+/*
+ * Write a cross-reference stream, which replaces both the xref table and
+ * the trailer. The entries are compressed into the (now empty) object
+ * stream temporary file first, so that the stream can have a direct
+ * /Length.
+ */
+static int
+write_xref_stream(gx_device_pdf *pdev, gp_file *tfile, gs_offset_t resource_pos,
+                  long Catalog_id, long Info_id, long Encrypt_id)
+{
+    stream *s = pdev->strm, *cs = pdev->ObjStm.strm;
+    gs_memory_t *mem = pdev->pdf_memory;
+    gs_offset_t xref = pdf_stell(pdev) - pdev->OPDFRead_procset_length;
+    gs_offset_t length, max_field;
+    stream_state *st;
+    long i, Size;
+    int w = 1, code = 0;
+    char str[64];
+
+    pdf_begin_obj(pdev, resourceStream);
+    Size = pdev->next_id;
+    max_field = max(xref, Size);
+    while (w < 8 && (max_field >> (8 * w)) != 0)
+        ++w;
+
+    if (sseek(cs, 0) < 0 || gp_fseek(tfile, 0, SEEK_SET) != 0)
+        return_error(gs_error_ioerror);
+    st = s_alloc_state(mem, s_zlibE_template.stype, "write_xref_stream");
+    if (st == NULL)
+        return_error(gs_error_VMerror);
+    s_zlibE_template.set_defaults(st);
+    if (s_add_filter(&cs, &s_zlibE_template, st, mem) == NULL) {
+        gs_free_object(mem, st, "write_xref_stream");
+        return_error(gs_error_VMerror);
+    }
+    put_xref_stream_entry(cs, 0, 0, w, 65535);
+    for (i = pdev->FirstObjectNumber; i < Size; ++i) {
+        gs_offset_t pos;
+
+        if (gp_fread(&pos, sizeof(pos), 1, tfile) != 1) {
+            code = gs_note_error(gs_error_ioerror);
+            break;
+        }
+        if (pos == 0)
+            put_xref_stream_entry(cs, 0, 0, w, 0);
+        else if (pos & ASIDES_BASE_POSITION)
+            put_xref_stream_entry(cs, 1, pdf_asides_file_pos(pdev, pos, resource_pos) -
+                                  pdev->OPDFRead_procset_length, w, 0);
+        else if (pos & OBJSTM_BASE_POSITION)
+            put_xref_stream_entry(cs, 2, (pos - OBJSTM_BASE_POSITION) >> 16, w,
+                                  (int)(pos & 0xffff));
+        else
+            put_xref_stream_entry(cs, 1, pos - pdev->OPDFRead_procset_length, w, 0);
+    }
+    s_close_filters(&cs, pdev->ObjStm.strm);
+    if (code < 0)
+        return code;
+    sflush(cs);
+    length = stell(cs);
+
+    pprintld1(s, "<</Type/XRef/Size %ld", Size);
+    if (pdev->FirstObjectNumber != 1)
+        pprintld2(s, "/Index[0 1 %ld %ld]", pdev->FirstObjectNumber,
+                  Size - pdev->FirstObjectNumber);
+    pprintd1(s, "/W[1 %d 2]", w);
+    pprintld2(s, "/Root %ld 0 R/Info %ld 0 R\n", Catalog_id, Info_id);
+    if (!pdev->OmitID) {
+        stream_puts(s, "/ID [");
+        psdf_write_string(s, pdev->fileID, sizeof(pdev->fileID), 0);
+        psdf_write_string(s, pdev->fileID, sizeof(pdev->fileID), 0);
+        stream_puts(s, "]\n");
+    }
+    if (pdev->OwnerPassword.size > 0)
+        pprintld1(s, "/Encrypt %ld 0 R", Encrypt_id);
+    pprintld1(s, "/Filter/FlateDecode/Length %ld>>\nstream\n", (long)length);
+    if (gp_fseek(pdev->ObjStm.file, 0, SEEK_SET) != 0)
+        return_error(gs_error_ioerror);
+    code = pdf_copy_data(s, pdev->ObjStm.file, length, NULL);
+    if (code < 0)
+        return code;
+    stream_puts(s, "\nendstream\n");
+    pdf_end_obj(pdev, resourceStream);
+    gs_snprintf(str, sizeof(str), "startxref\n%"PRId64"\n%%%%EOF\n", xref);
+    stream_puts(s, str);
+    return 0;
+}
+
 static int
 rewrite_object(gx_device_pdf *const pdev, pdf_linearisation_t *linear_params, int object)
 {
@@ -2792,6 +3006,10 @@ pdf_close(gx_device * dev)
     code1 = pdf_finish_resources(pdev, resourceFontDescriptor, pdf_finish_FontDescriptor);
     if (code >= 0)
         code = code1;
+    code1 = pdf_finish_resources(pdev, resourceFontDescriptor, pdf_finish_FontFile);
+    if (code >= 0)
+        code = code1;
+    pdf_free_font_compression(pdev);
     code1 = write_font_resources(pdev, &pdev->resources[resourceCIDFont]);
     if (code >= 0)
         code = code1;
@@ -2825,7 +3043,7 @@ pdf_close(gx_device * dev)
 
     /* Create the Pages tree. */
     if (!(pdev->ForOPDFRead && pdev->ProduceDSC) && pdev->strm != NULL) {
-        pdf_open_obj(pdev, Pages_id, resourcePagesTree);
+        pdf_open_compressible_obj(pdev, Pages_id, resourcePagesTree);
         pdf_record_usage(pdev, Pages_id, resource_usage_part9_structure);
 
         s = pdev->strm;
@@ -2866,7 +3084,8 @@ pdf_close(gx_device * dev)
             code = pdfmark_close_outline(pdev);
             if (code >= 0)
                 code = code1;
-            pdf_open_obj(pdev, pdev->outlines_id, resourceOutline);
+            pdf_open_compressible_obj(pdev, pdev->outlines_id, resourceOutline);
+            s = pdev->strm;
             pprintd1(s, "<< /Type /Outlines /Count %d", pdev->outlines_open);
             pprintld2(s, " /First %ld 0 R /Last %ld 0 R >>\n",
                   pdev->outline_levels[0].first.id,
@@ -2924,7 +3143,7 @@ pdf_close(gx_device * dev)
         if (pdev->articles != 0) {
             pdf_article_t *part;
 
-            Threads_id = pdf_begin_obj(pdev, resourceThread);
+            Threads_id = pdf_open_compressible_obj(pdev, 0L, resourceThread);
             pdf_record_usage(pdev, Threads_id, resource_usage_part9_structure);
             s = pdev->strm;
             stream_puts(s, "[ ");
@@ -2937,7 +3156,7 @@ pdf_close(gx_device * dev)
             stream_puts(s, "]\n");
             pdf_end_obj(pdev, resourceThread);
         }
-        pdf_open_obj(pdev, Catalog_id, resourceCatalog);
+        pdf_open_compressible_obj(pdev, Catalog_id, resourceCatalog);
         pdf_record_usage(pdev, Catalog_id, resource_usage_part1_structure);
 
         s = pdev->strm;
@@ -3017,6 +3236,11 @@ pdf_close(gx_device * dev)
             code = code1;
     }
 
+    /* Write out the last object stream, before the asides are copied. */
+    code1 = pdf_flush_ObjStm(pdev);
+    if (code >= 0)
+        code = code1;
+
     /* Copy the resources into the main file. */
 
     if (pdev->strm != NULL) {
@@ -3134,61 +3358,68 @@ pdf_close(gx_device * dev)
             s = pdev->strm;
         }
 
-        /* Write the cross-reference section. */
-
-        start_section = pdev->FirstObjectNumber;
-        end_section = find_end_xref_section(pdev, tfile, start_section, resource_pos);
-
-        xref = pdf_stell(pdev) - pdev->OPDFRead_procset_length;
-        if (pdev->Linearise)
-            linear_params.xref = xref;
-
-        if (pdev->FirstObjectNumber == 1) {
-            gs_snprintf(str, sizeof(str), "xref\n0 %"PRId64"\n0000000000 65535 f \n",
-                  end_section);
-            stream_puts(s, str);
-        }
-        else {
-            gs_snprintf(str, sizeof(str), "xref\n0 1\n0000000000 65535 f \n%"PRId64" %"PRId64"\n",
-                  start_section,
-                  end_section - start_section);
-            stream_puts(s, str);
-        }
-
-        do {
-            code = write_xref_section(pdev, tfile, start_section, end_section, resource_pos, linear_params.Offsets);
+        if (pdev->ObjStm.strm != NULL) {
+            /* Write a cross-reference stream instead of the table and trailer. */
+            code = write_xref_stream(pdev, tfile, resource_pos, Catalog_id, Info_id, Encrypt_id);
             if (code < 0)
                 goto error_cleanup;
+        } else {
+            /* Write the cross-reference section. */
 
-            if (end_section >= pdev->next_id)
-                break;
-            start_section = end_section + 1;
+            start_section = pdev->FirstObjectNumber;
             end_section = find_end_xref_section(pdev, tfile, start_section, resource_pos);
-            if (end_section < 0)
-                return end_section;
-            gs_snprintf(str, sizeof(str), "%"PRId64" %"PRId64"\n", start_section, end_section - start_section);
-            stream_puts(s, str);
-        } while (1);
-
-        /* Write the trailer. */
-
-        if (!pdev->Linearise) {
-            char xref_str[32];
-            stream_puts(s, "trailer\n");
-            pprintld3(s, "<< /Size %ld /Root %ld 0 R /Info %ld 0 R\n",
-                  pdev->next_id, Catalog_id, Info_id);
-            if (!pdev->OmitID) {
-                stream_puts(s, "/ID [");
-                psdf_write_string(pdev->strm, pdev->fileID, sizeof(pdev->fileID), 0);
-                psdf_write_string(pdev->strm, pdev->fileID, sizeof(pdev->fileID), 0);
-                stream_puts(s, "]\n");
+
+            xref = pdf_stell(pdev) - pdev->OPDFRead_procset_length;
+            if (pdev->Linearise)
+                linear_params.xref = xref;
+
+            if (pdev->FirstObjectNumber == 1) {
+                gs_snprintf(str, sizeof(str), "xref\n0 %"PRId64"\n0000000000 65535 f \n",
+                      end_section);
+                stream_puts(s, str);
             }
-            if (pdev->OwnerPassword.size > 0) {
-                pprintld1(s, "/Encrypt %ld 0 R ", Encrypt_id);
+            else {
+                gs_snprintf(str, sizeof(str), "xref\n0 1\n0000000000 65535 f \n%"PRId64" %"PRId64"\n",
+                      start_section,
+                      end_section - start_section);
+                stream_puts(s, str);
+            }
+
+            do {
+                code = write_xref_section(pdev, tfile, start_section, end_section, resource_pos, linear_params.Offsets);
+                if (code < 0)
+                    goto error_cleanup;
+
+                if (end_section >= pdev->next_id)
+                    break;
+                start_section = end_section + 1;
+                end_section = find_end_xref_section(pdev, tfile, start_section, resource_pos);
+                if (end_section < 0)
+                    return end_section;
+                gs_snprintf(str, sizeof(str), "%"PRId64" %"PRId64"\n", start_section, end_section - start_section);
+                stream_puts(s, str);
+            } while (1);
+
+            /* Write the trailer. */
+
+            if (!pdev->Linearise) {
+                char xref_str[32];
+                stream_puts(s, "trailer\n");
+                pprintld3(s, "<< /Size %ld /Root %ld 0 R /Info %ld 0 R\n",
+                      pdev->next_id, Catalog_id, Info_id);
+                if (!pdev->OmitID) {
+                    stream_puts(s, "/ID [");
+                    psdf_write_string(pdev->strm, pdev->fileID, sizeof(pdev->fileID), 0);
+                    psdf_write_string(pdev->strm, pdev->fileID, sizeof(pdev->fileID), 0);
+                    stream_puts(s, "]\n");
+                }
+                if (pdev->OwnerPassword.size > 0) {
+                    pprintld1(s, "/Encrypt %ld 0 R ", Encrypt_id);
+                }
+                stream_puts(s, ">>\n");
+                gs_snprintf(xref_str, sizeof(xref_str), "startxref\n%"PRId64"\n%%%%EOF\n", xref);
+                stream_puts(s, xref_str);
             }
-            stream_puts(s, ">>\n");
-            gs_snprintf(xref_str, sizeof(xref_str), "startxref\n%"PRId64"\n%%%%EOF\n", xref);
-            stream_puts(s, xref_str);
         }
     }
 
@@ -3497,6 +3728,8 @@ error_cleanup:
     if (code >= 0)
         code = code1;
 
+    pdf_free_resource_indices(pdev);
+
     if (code >= 0) {
         int i, j;
 
@@ -133,6 +133,7 @@ const gx_device_pdf PDF_DEVICE_IDENT =
  {
      {
          {0}}},	/* resources */
+ 0,				/* resource_chain_seq */
  {0},			/* cs_Patterns */
  {0},			/* Identity_ToUnicode_CMaps */
  0,				/* last_resource */
@@ -242,7 +243,18 @@ const gx_device_pdf PDF_DEVICE_IDENT =
  false,                 /* OmitXMP */
  false,                 /* OmitID */
  false,                 /* ModifiesPageSize */
- false                  /* ModifiesPageOrder */
+ false,                 /* ModifiesPageOrder */
+ false,                 /* WriteObjStms */
+ false,                 /* WriteXRefStm */
+ false,                 /* ThreadedImageCompression */
+ false,                 /* StreamPages */
+ 0,                     /* FontCompressionThreads */
+ false,                 /* OptimizeContentStreams */
+ {{0}},                 /* ObjStm */
+ 0,                     /* ObjStm_id */
+ 0,                     /* NumObjStmObjects */
+ {0},                   /* ObjStmIds */
+ {0}                    /* ObjStmOffsets */
 };
 
 #else
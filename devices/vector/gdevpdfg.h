@@ -304,6 +304,13 @@ int pdf_end_abort_image(gx_device_pdf * pdev, pdf_image_writer * piw);
  */
 int pdf_end_write_image(gx_device_pdf * pdev, pdf_image_writer * piw);
 
+/* Free the table of images by the hash of their samples. */
+void pdf_free_image_hashes(gx_device_pdf * pdev);
+
+/* Drop an image's resource from that table, or all of them. */
+void pdf_forget_image_hash(gx_device_pdf * pdev, pdf_resource_t *pres);
+void pdf_invalidate_image_hashes(gx_device_pdf * pdev);
+
 /*
  *  Make alternative stream for image compression choice.
  */
@@ -83,6 +83,8 @@ typedef struct pdf_image_enum_s {
     gs_color_space_index initial_colorspace;
     int JPEG_PassThrough;
     int JPX_PassThrough;
+    bool hash_samples;		/* see pdf_end_write_image */
+    gs_md5_state_t samples_md5;
 } pdf_image_enum;
 gs_private_st_composite(st_pdf_image_enum, pdf_image_enum, "pdf_image_enum",
   pdf_image_enum_enum_ptrs, pdf_image_enum_reloc_ptrs);
@@ -245,6 +247,29 @@ pdf_begin_image_data_decoded(gx_device_pdf *pdev, int num_components, const gs_r
     return pdf_begin_image_data(pdev, &pie->writer, pi, cs_value, i);
 }
 
+/* Set up the image filters, on a worker thread if requested. */
+static int
+pdf_setup_image_filters(gx_device_pdf *pdev, psdf_binary_writer *pbw,
+                        gs_pixel_image_t *pim, const gs_matrix *pctm,
+                        const gs_gstate *pgs, bool lossless, bool in_line,
+                        bool colour_conversion)
+{
+    psdf_image_thread *pt = NULL;
+    int code;
+
+    if (pdev->ThreadedImageCompression && !in_line && pdev->binary_ok &&
+        !pdev->JPEG_PassThrough && !pdev->JPX_PassThrough) {
+        code = psdf_begin_image_thread(pbw, &pt);
+        if (code < 0)
+            return code;
+    }
+    code = new_setup_image_filters((gx_device_psdf *)pdev, pbw, pim, pctm,
+                                   pgs, lossless, in_line, colour_conversion);
+    if (pt != NULL)
+        code = psdf_end_image_thread(pbw, pt, code);
+    return code;
+}
+
 static int
 make_device_color_space(gx_device_pdf *pdev,
                         gs_color_space_index output_cspace_index,
@@ -1548,12 +1573,12 @@ pdf_begin_typed_image(gx_device_pdf *pdev, const gs_gstate * pgs,
             int saved_downsample = pdev->params.ColorImage.DownsampleType;
 
             pdev->params.ColorImage.DownsampleType = ds_Subsample;
-            code = new_setup_image_filters((gx_device_psdf *) pdev,
+            code = pdf_setup_image_filters(pdev,
                                           &pie->writer.binary[0], &image[0].pixel,
                                           pmat, pgs, true, in_line, convert_to_process_colors);
             pdev->params.ColorImage.DownsampleType = saved_downsample;
         } else {
-            code = new_setup_image_filters((gx_device_psdf *) pdev,
+            code = pdf_setup_image_filters(pdev,
                                           &pie->writer.binary[0], &image[0].pixel,
                                           pmat, pgs, true, in_line, convert_to_process_colors);
         }
@@ -1588,7 +1613,7 @@ pdf_begin_typed_image(gx_device_pdf *pdev, const gs_gstate * pgs,
         code = pdf_make_alt_stream(pdev, &pie->writer.binary[1]);
         if (code < 0)
             goto fail_and_fallback;
-        code = new_setup_image_filters((gx_device_psdf *) pdev,
+        code = pdf_setup_image_filters(pdev,
                                   &pie->writer.binary[1], &image[1].pixel,
                                   pmat, pgs, force_lossless, in_line, convert_to_process_colors);
         if (code == gs_error_rangecheck) {
@@ -1667,6 +1692,23 @@ pdf_begin_typed_image(gx_device_pdf *pdev, const gs_gstate * pgs,
         ++pie->writer.alt_writer_count;
     }
 
+    /*
+     * Hash the samples for finding duplicate images if they are written
+     * without being converted; see pdf_end_write_image.
+     */
+    pie->hash_samples = (pdev->DetectDuplicateImages && pie->writer.pres != NULL &&
+                         pnamed == NULL && !convert_to_process_colors &&
+                         !(pdev->params.TransferFunctionInfo == tfi_Apply &&
+                           pdev->transfer_not_identity) &&
+                         !(pic->type->index == 4 && pdev->CompatibilityLevel < 1.3));
+    if (pie->hash_samples) {
+        gs_md5_init(&pie->samples_md5);
+        gs_md5_append(&pie->samples_md5, (const byte *)&pie->width, sizeof(pie->width));
+        gs_md5_append(&pie->samples_md5, (const byte *)&pie->num_planes, sizeof(pie->num_planes));
+        gs_md5_append(&pie->samples_md5, (const byte *)pie->plane_depths,
+                      pie->num_planes * sizeof(pie->plane_depths[0]));
+    }
+
     /* use_fallback = 0, so this will drop through the below labels, doing only the cleanup parts */
     code = 0;
 
@@ -1798,6 +1840,24 @@ pdf_image_plane_data_alt(gx_image_enum_common_t * info,
 #undef ROW_BYTES
 }
 
+/* Add the next rows of an image to the hash of its samples. */
+static void
+pdf_hash_image_samples(pdf_image_enum *pie, const gx_image_plane_t * planes,
+                       int height)
+{
+    int h = min(height, pie->rows_left), y, i;
+
+    for (i = 0; i < pie->num_planes; i++)
+        if (planes[i].data_x != 0) {
+            pie->hash_samples = false;
+            return;
+        }
+    for (y = 0; y < h; y++)
+        for (i = 0; i < pie->num_planes; i++)
+            gs_md5_append(&pie->samples_md5, planes[i].data + planes[i].raster * y,
+                          ((uint)pie->width * pie->plane_depths[i] + 7) >> 3);
+}
+
 static int
 pdf_image_plane_data(gx_image_enum_common_t * info,
                      const gx_image_plane_t * planes, int height,
@@ -1806,6 +1866,8 @@ pdf_image_plane_data(gx_image_enum_common_t * info,
     pdf_image_enum *pie = (pdf_image_enum *) info;
     int i;
 
+    if (pie->hash_samples)
+        pdf_hash_image_samples(pie, planes, height);
     if (pie->JPEG_PassThrough || pie->JPX_PassThrough) {
         pie->rows_left -= height;
         *rows_used = height;
@@ -1929,7 +1991,7 @@ pdf_end_and_do_image(gx_device_pdf *pdev, pdf_image_writer *piw,
             gs_snprintf(buf, sizeof(buf), "%ld 0 R", pdev->image_mask_id);
             code = cos_dict_put_string_copy((cos_dict_t *)piw->pres->object,
                     pdev->image_mask_is_SMask ? "/SMask" : "/Mask", buf);
-            (*(piw->pres->object)).md5_valid = 0;
+            cos_object_changed(piw->pres->object);
             if (code < 0)
                 return code;
         }
@@ -1966,6 +2028,44 @@ pdf_end_and_do_image(gx_device_pdf *pdev, pdf_image_writer *piw,
 }
 
 /* Clean up by releasing the buffers. */
+/*
+ * Check whether the image data was written exactly as it was hashed, i.e.
+ * was neither downsampled nor lossily compressed (other than by passing
+ * the original JPEG data through).
+ */
+static bool
+pdf_image_samples_exact(const pdf_image_enum *pie)
+{
+    const pdf_image_writer *piw = &pie->writer;
+    const cos_value_t *value;
+    char data[256];
+    int i;
+
+    if (pie->JPEG_PassThrough || pie->JPX_PassThrough)
+        return true;
+    value = cos_dict_find(cos_stream_dict(piw->data),
+                          (const byte *)piw->pin->Width, strlen(piw->pin->Width));
+    if (!value || value->contents.chars.size > 255)
+        return false;
+    memcpy(data, value->contents.chars.data, value->contents.chars.size);
+    data[value->contents.chars.size] = 0x00;
+    if (atoi(data) != pie->width)
+        return false;
+    value = cos_dict_find(cos_stream_dict(piw->data),
+                          (const byte *)piw->pin->filter_names.Filter,
+                          strlen(piw->pin->filter_names.Filter));
+    if (value != NULL && value->value_type != COS_VALUE_RESOURCE &&
+        value->value_type != COS_VALUE_OBJECT) {
+        const byte *p = value->contents.chars.data;
+        uint size = value->contents.chars.size;
+
+        for (i = 0; i + 3 <= size; i++)
+            if (!memcmp(p + i, "DCT", 3) || !memcmp(p + i, "JPX", 3))
+                return false;
+    }
+    return true;
+}
+
 static int
 pdf_image_end_image_data(gx_image_enum_common_t * info, bool draw_last,
                          pdf_image_usage_t do_image)
@@ -2009,8 +2109,16 @@ pdf_image_end_image_data(gx_image_enum_common_t * info, bool draw_last,
             if (code < 0)
                 return code;
             code = pdf_end_and_do_image(pdev, &pie->writer, &pie->mat, info->id, USE_AS_PATTERN);
-        } else
+        } else {
+            if (pie->hash_samples && pie->writer.pres != NULL &&
+                pdf_image_samples_exact(pie)) {
+                pdf_x_object_t *pxo = (pdf_x_object_t *)pie->writer.pres;
+
+                gs_md5_finish(&pie->samples_md5, pxo->samples_hash);
+                pxo->samples_hashed = true;
+            }
             code = pdf_end_and_do_image(pdev, &pie->writer, &pie->mat, info->id, do_image);
+        }
         pie->writer.alt_writer_count--; /* For GC. */
     } else {
         code = pdf_end_image_binary(pdev, &pie->writer, data_height);
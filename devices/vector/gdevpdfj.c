@@ -426,8 +426,12 @@ pdf_complete_image_data(gx_device_pdf *pdev, pdf_image_writer *piw, int data_h,
                         int width, int bits_per_pixel)
 {
     if (data_h != piw->height) {
-        if (piw->binary[0].strm->procs.process == s_DCTE_template.process ||
-            piw->binary[0].strm->procs.process == s_PNGPE_template.process ) {
+        stream *s = psdf_image_thread_filters(piw->binary[0].strm);
+
+        if (s == NULL)
+            s = piw->binary[0].strm;
+        if (s->procs.process == s_DCTE_template.process ||
+            s->procs.process == s_PNGPE_template.process ) {
             /* 	Since DCTE and PNGPE can't safely close with incomplete data,
                 we add stub data to complete the stream.
             */
@@ -534,6 +538,199 @@ smask_image_check(gx_device_pdf * pdev, pdf_resource_t *pres0, pdf_resource_t *p
 }
 
 
+/*
+ * pdf_substitute_resource only finds an image whose compressed data is the
+ * same, but identical samples may have been written differently, e.g. when
+ * a copy was a pass-through JPEG. pdf_image_end_image_data records the MD5
+ * hash of the source samples of an image whose data is written exactly, and
+ * here we add the image dictionary apart from the compression, and look for
+ * an earlier image with the same hash. The table maps the hashes to object
+ * ids rather than to resources, so it needs no garbage collector support:
+ * an image which has gone is simply not found. Searching all the XObjects
+ * for the id would make finding duplicates quadratic again, so an entry
+ * also caches the image resource. The cached pointer is cleared when the
+ * image leaves its chain and when the device is relocated, and the image
+ * is then looked up again, first in the chain it was in.
+ */
+typedef struct pdf_image_hash_s {
+    byte hash[16];
+    long id;			/* 0 if the slot is free */
+    pdf_resource_t *pres;	/* the image if known, not GC'd */
+    byte chain;			/* the resource chain the image was in */
+} pdf_image_hash_t;
+
+struct pdf_image_hashes_s {
+    pdf_image_hash_t *table;	/* open addressing */
+    uint size;			/* a power of 2 */
+    uint count;
+};
+
+#define PDF_IMAGE_HASHES_MEM(pdev) ((pdev)->pdf_memory->non_gc_memory)
+
+static pdf_image_hash_t *
+pdf_image_hash_slot(pdf_image_hashes_t *pih, const byte *hash)
+{
+    uint mask = pih->size - 1;
+    uint i = (hash[0] | (hash[1] << 8) | (hash[2] << 16) | ((uint)hash[3] << 24)) & mask;
+
+    while (pih->table[i].id != 0 && memcmp(pih->table[i].hash, hash, 16))
+        i = (i + 1) & mask;
+    return &pih->table[i];
+}
+
+static int
+pdf_image_hashes_grow(gx_device_pdf *pdev, pdf_image_hashes_t *pih)
+{
+    uint size = (pih->size ? pih->size * 2 : 256), old_size = pih->size, i;
+    pdf_image_hash_t *old = pih->table;
+    pdf_image_hash_t *table = (pdf_image_hash_t *)
+        gs_alloc_byte_array(PDF_IMAGE_HASHES_MEM(pdev), size, sizeof(pdf_image_hash_t),
+                            "pdf_image_hashes_grow");
+
+    if (table == NULL)
+        return_error(gs_error_VMerror);
+    memset(table, 0x00, size * sizeof(pdf_image_hash_t));
+    pih->table = table;
+    pih->size = size;
+    for (i = 0; i < old_size; i++)
+        if (old[i].id != 0)
+            *pdf_image_hash_slot(pih, old[i].hash) = old[i];
+    gs_free_object(PDF_IMAGE_HASHES_MEM(pdev), old, "pdf_image_hashes_grow");
+    return 0;
+}
+
+/* Find the image recorded in a table entry. */
+static pdf_resource_t *
+pdf_image_hash_resource(gx_device_pdf *pdev, pdf_image_hash_t *ph)
+{
+    pdf_resource_t *pres = ph->pres;
+
+    if (pres != NULL)
+        return pres;
+    for (pres = pdev->resources[resourceXObject].chains[ph->chain]; pres != 0; pres = pres->next)
+        if (pres->object && pres->object->id == ph->id)
+            break;
+    if (pres == NULL)
+        pres = pdf_find_resource_by_resource_id(pdev, resourceXObject, ph->id);
+    ph->pres = pres;
+    return pres;
+}
+
+/*
+ * Look for an earlier image with the same samples and dictionary as *ppres.
+ * If there is one, set *ppres to it and return 1. Otherwise return 0, and
+ * the caller calls pdf_add_image_hash if it keeps the image.
+ */
+static int
+pdf_find_same_image_samples(gx_device_pdf *pdev, pdf_resource_t **ppres)
+{
+    static const char *const skip[] = {"/Filter", "/DecodeParms", "/Length", NULL};
+    pdf_x_object_t *pxo = (pdf_x_object_t *)*ppres;
+    pdf_image_hashes_t *pih = pdev->image_hashes;
+    pdf_image_hash_t *ph;
+    pdf_resource_t *pres;
+    gs_md5_state_t md5;
+    int code;
+
+    if (!pxo->samples_hashed)
+        return 0;
+    gs_md5_init(&md5);
+    gs_md5_append(&md5, pxo->samples_hash, 16);
+    code = cos_dict_hash_except(cos_stream_dict((cos_stream_t *)pxo->object), &md5,
+                                skip, pdev);
+    if (code < 0)
+        return code;
+    gs_md5_finish(&md5, pxo->samples_hash);
+    if (pih == NULL || pih->size == 0)
+        return 0;
+    ph = pdf_image_hash_slot(pih, pxo->samples_hash);
+    if (ph->id == 0)
+        return 0;
+    pres = pdf_image_hash_resource(pdev, ph);
+    if (pres == NULL || pres == *ppres || !((pdf_x_object_t *)pres)->samples_hashed ||
+        memcmp(((pdf_x_object_t *)pres)->samples_hash, pxo->samples_hash, 16))
+        return 0;
+    code = smask_image_check(pdev, *ppres, pres);
+    if (code <= 0)
+        return code;
+    *ppres = pres;
+    return 1;
+}
+
+/* Record an image kept by pdf_end_write_image. */
+static int
+pdf_add_image_hash(gx_device_pdf *pdev, pdf_resource_t *pres)
+{
+    pdf_x_object_t *pxo = (pdf_x_object_t *)pres;
+    pdf_image_hashes_t *pih = pdev->image_hashes;
+    pdf_image_hash_t *ph;
+    int code;
+
+    if (!pxo->samples_hashed || pres->object->id <= 0)
+        return 0;
+    if (pih == NULL) {
+        pih = (pdf_image_hashes_t *)gs_alloc_bytes(PDF_IMAGE_HASHES_MEM(pdev),
+                        sizeof(pdf_image_hashes_t), "pdf_add_image_hash");
+        if (pih == NULL)
+            return_error(gs_error_VMerror);
+        memset(pih, 0x00, sizeof(pdf_image_hashes_t));
+        pdev->image_hashes = pih;
+    }
+    if ((pih->count + 1) * 2 > pih->size) {
+        code = pdf_image_hashes_grow(pdev, pih);
+        if (code < 0)
+            return code;
+    }
+    ph = pdf_image_hash_slot(pih, pxo->samples_hash);
+    /* This replaces any earlier image with the same hash. */
+    if (ph->id == 0)
+        pih->count++;
+    memcpy(ph->hash, pxo->samples_hash, 16);
+    ph->id = pres->object->id;
+    ph->pres = pres;
+    ph->chain = pres->chain_index;
+    return 0;
+}
+
+/* Forget the cached resource of an image which is leaving its chain. */
+void
+pdf_forget_image_hash(gx_device_pdf *pdev, pdf_resource_t *pres)
+{
+    pdf_x_object_t *pxo = (pdf_x_object_t *)pres;
+    pdf_image_hashes_t *pih = pdev->image_hashes;
+    pdf_image_hash_t *ph;
+
+    if (pih == NULL || pih->size == 0 || !pxo->samples_hashed)
+        return;
+    ph = pdf_image_hash_slot(pih, pxo->samples_hash);
+    if (ph->pres == pres)
+        ph->pres = NULL;
+}
+
+/* Forget all the cached resources, since they may have moved. */
+void
+pdf_invalidate_image_hashes(gx_device_pdf *pdev)
+{
+    pdf_image_hashes_t *pih = pdev->image_hashes;
+    uint i;
+
+    if (pih != NULL)
+        for (i = 0; i < pih->size; i++)
+            pih->table[i].pres = NULL;
+}
+
+void
+pdf_free_image_hashes(gx_device_pdf *pdev)
+{
+    pdf_image_hashes_t *pih = pdev->image_hashes;
+
+    if (pih != NULL) {
+        gs_free_object(PDF_IMAGE_HASHES_MEM(pdev), pih->table, "pdf_free_image_hashes");
+        gs_free_object(PDF_IMAGE_HASHES_MEM(pdev), pih, "pdf_free_image_hashes");
+        pdev->image_hashes = NULL;
+    }
+}
+
 /* Abort an image without writing it.
  * Frees any associated memory.
  */
@@ -592,9 +789,24 @@ pdf_end_write_image(gx_device_pdf * pdev, pdf_image_writer * piw)
                 pdf_x_object_t *pxo = (pdf_x_object_t *)piw->pres;
                 int height = pxo->height, width = pxo->width;
 
-                code = pdf_substitute_resource(pdev, &piw->pres, resourceXObject, smask_image_check, false);
+                code = pdf_find_same_image_samples(pdev, &piw->pres);
                 if (code < 0)
                     return code;
+                if (code > 0) {
+                    code = pdf_cancel_resource(pdev, pres, resourceXObject);
+                    if (code < 0)
+                        return code;
+                    pdf_forget_resource(pdev, pres, resourceXObject);
+                } else {
+                    code = pdf_substitute_resource(pdev, &piw->pres, resourceXObject, smask_image_check, false);
+                    if (code < 0)
+                        return code;
+                    if (piw->pres == pres) {
+                        code = pdf_add_image_hash(pdev, pres);
+                        if (code < 0)
+                            return code;
+                    }
+                }
 
                 /* These values are related to the image matrix and should *not* be
                  * substituted if we found a duplicate image, or the matrix calculation
@@ -615,16 +827,26 @@ pdf_end_write_image(gx_device_pdf * pdev, pdf_image_writer * piw)
             return code;
         return 0;
     } else {			/* in-line image */
-        stream *s = pdev->strm;
+        stream *save_strm = pdev->strm;
+        stream *s;
         uint KeyLength = pdev->KeyLength;
+        int code;
 
+        /* The image data mustn't pass through the content optimiser. */
+        code = pdf_bypass_content_optimizer(pdev);
+        if (code < 0)
+            return code;
+        s = pdev->strm;
         stream_puts(s, "BI\n");
         cos_stream_elements_write(piw->data, pdev);
         stream_puts(s, (pdev->binary_ok ? "ID " : "ID\n"));
         pdev->KeyLength = 0; /* Disable encryption for the inline image. */
         cos_stream_contents_write(piw->data, pdev);
         pdev->KeyLength = KeyLength;
-        pprints1(s, "\nEI%s\n", piw->end_string);
+        /* The optimiser doesn't start its output with white space. */
+        stream_puts(s, (code > 0 ? "\nEI\n" : "\nEI"));
+        pdev->strm = save_strm;
+        pprints1(pdev->strm, "%s\n", piw->end_string);
         COS_FREE(piw->data, "pdf_end_write_image");
         return 1;
     }
@@ -684,8 +906,17 @@ static inline bool much_bigger__DL(long l1, long l2)
 {
     return l1 > 1024*1024 && l2 < l1 / 3;
 }
+static bool
+pdf_image_stream_threaded(stream *s)
+{
+    for (; s != 0; s = s->strm)
+        if (psdf_image_thread_filters(s) != 0)
+            return true;
+    return false;
+}
 static void
-pdf_choose_compression_cos(pdf_image_writer *piw, cos_stream_t *s[2], bool force)
+pdf_choose_compression_cos(pdf_image_writer *piw, cos_stream_t *s[2], bool force,
+                           bool threaded)
 {   /*	Assume s[0] is Flate, s[1] is DCT, s[2] is chooser. */
     long l0, l1;
     int k0, k1;
@@ -693,8 +924,17 @@ pdf_choose_compression_cos(pdf_image_writer *piw, cos_stream_t *s[2], bool force
     l0 = cos_stream_length(s[0]);
     l1 = cos_stream_length(s[1]);
 
+    /*
+     * With image threads the lengths so far depend on how far the threads
+     * have got, so both streams are completed and the choice is made on
+     * their final lengths.
+     */
+    if (threaded && !force)
+        return;
     if ((force && l0 <= l1) || l1 == -1)
         k0 = 1; /* Use Flate if it is not longer. Or if the DCT failed */
+    else if (threaded && much_bigger__DL(l0, l1))
+        k0 = 0;
     else {
         k0 = s_compr_chooser__get_choice(
             (stream_compr_chooser_state *)piw->binary[2].strm->state, force);
@@ -732,6 +972,8 @@ pdf_choose_compression(pdf_image_writer * piw, bool end_binary)
 {
     cos_stream_t *s[2];
     int status;
+    bool threaded = (pdf_image_stream_threaded(piw->binary[0].strm) ||
+                     pdf_image_stream_threaded(piw->binary[1].strm));
 
     s[0] = cos_stream_from_pipeline(piw->binary[0].strm);
     s[1] = cos_stream_from_pipeline(piw->binary[1].strm);
@@ -751,6 +993,6 @@ pdf_choose_compression(pdf_image_writer * piw, bool end_binary)
         if (status < 0)
             s[1]->length = -1;
     }
-    pdf_choose_compression_cos(piw, s, end_binary);
+    pdf_choose_compression_cos(piw, s, end_binary, threaded);
     return 0;
 }
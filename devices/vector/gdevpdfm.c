@@ -1237,7 +1237,7 @@ pdfmark_write_outline(gx_device_pdf * pdev, pdf_outline_node_t * pnode,
     stream *s;
     int code = 0;
 
-    pdf_open_separate(pdev, pnode->id, resourceOutline);
+    pdf_open_compressible_separate(pdev, pnode->id, resourceOutline);
     if (pnode->action != NULL)
         pnode->action->id = pnode->id;
     else {
@@ -1402,7 +1402,7 @@ pdfmark_write_bead(gx_device_pdf * pdev, const pdf_bead_t * pbead)
     stream *s;
     char rstr[MAX_RECT_STRING];
 
-    pdf_open_separate(pdev, pbead->id, resourceArticle);
+    pdf_open_compressible_separate(pdev, pbead->id, resourceArticle);
     s = pdev->strm;
     pprintld3(s, "<</T %ld 0 R/V %ld 0 R/N %ld 0 R",
               pbead->article_id, pbead->prev_id, pbead->next_id);
@@ -1431,7 +1431,7 @@ pdfmark_write_article(gx_device_pdf * pdev, const pdf_article_t * part)
         pdfmark_write_bead(pdev, &art.last);
     }
     pdfmark_write_bead(pdev, &art.first);
-    pdf_open_separate(pdev, art.contents->id, resourceArticle);
+    pdf_open_compressible_separate(pdev, art.contents->id, resourceArticle);
     s = pdev->strm;
     pprintld1(s, "<</F %ld 0 R/I<<", art.first.id);
     cos_dict_elements_write(art.contents, pdev);
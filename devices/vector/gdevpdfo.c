@@ -171,6 +171,7 @@ cos_object_init(cos_object_t *pco, gx_device_pdf *pdev,
         pco->pieces = 0;
         pco->mem = pdev->pdf_memory;
         pco->pres = 0;
+        pco->hash_index = 0;
         pco->is_open = true;
         pco->is_graphics = false;
         pco->written = false;
@@ -215,6 +216,19 @@ cos_free(cos_object_t *pco, client_name_t cname)
     gs_free_object(cos_object_memory(pco), pco, cname);
 }
 
+/*
+ * Note that the contents of a Cos object have changed, so that its hash
+ * must be recomputed. If it is in a resource hash index, the index is now
+ * out of date.
+ */
+void
+cos_object_changed(cos_object_t *pco)
+{
+    pco->md5_valid = false;
+    if (pco->hash_index != NULL)
+        pdf_resource_index_changed(pco->hash_index);
+}
+
 /* Write a cos object on the output. */
 cos_proc_write(cos_write);	/* check prototype */
 int
@@ -231,7 +245,10 @@ cos_write_object(cos_object_t *pco, gx_device_pdf *pdev, pdf_resource_type_t typ
 
     if (pco->id == 0 || pco->written)
         return_error(gs_error_Fatal);
-    pdf_open_separate(pdev, pco->id, type);
+    if (cos_type(pco) == cos_type_stream)
+        pdf_open_separate(pdev, pco->id, type);
+    else
+        pdf_open_compressible_separate(pdev, pco->id, type);
     code = cos_write(pco, pdev, pco->id);
     pdf_end_separate(pdev, type);
     pco->written = true;
@@ -639,7 +656,7 @@ cos_array_put(cos_array_t *pca, long index, const cos_value_t *pvalue)
         if (code < 0)
             cos_uncopy_element_value(&value, mem, true);
     }
-    pca->md5_valid = false;
+    COS_OBJECT_CHANGED(pca);
     return code;
 }
 int
@@ -668,7 +685,7 @@ cos_array_put_no_copy(cos_array_t *pca, long index, const cos_value_t *pvalue)
         *ppcae = pcae;
     }
     pcae->value = *pvalue;
-    pca->md5_valid = false;
+    COS_OBJECT_CHANGED(pca);
     return 0;
 }
 static long
@@ -679,13 +696,13 @@ cos_array_next_index(const cos_array_t *pca)
 int
 cos_array_add(cos_array_t *pca, const cos_value_t *pvalue)
 {
-    pca->md5_valid = false;
+    COS_OBJECT_CHANGED(pca);
     return cos_array_put(pca, cos_array_next_index(pca), pvalue);
 }
 int
 cos_array_add_no_copy(cos_array_t *pca, const cos_value_t *pvalue)
 {
-    pca->md5_valid = false;
+    COS_OBJECT_CHANGED(pca);
     return cos_array_put_no_copy(pca, cos_array_next_index(pca), pvalue);
 }
 int
@@ -742,7 +759,7 @@ cos_array_unadd(cos_array_t *pca, cos_value_t *pvalue)
     *pvalue = pcae->value;
     pca->elements = pcae->next;
     gs_free_object(COS_OBJECT_MEMORY(pca), pcae, "cos_array_unadd");
-    pca->md5_valid = false;
+    COS_OBJECT_CHANGED(pca);
     return 0;
 }
 
@@ -1193,7 +1210,7 @@ cos_write_dict_as_ordered_array(cos_object_t *pco, gx_device_pdf *pdev, pdf_reso
 
     if (pco->id == 0 || pco->written)
         return_error(gs_error_Fatal);
-    pdf_open_separate(pdev, pco->id, type);
+    pdf_open_compressible_separate(pdev, pco->id, type);
 
     s = pdev->strm;
     pcde = d->elements;
@@ -1344,7 +1361,7 @@ cos_dict_put_copy(cos_dict_t *pcd, const byte *key_data, uint key_size,
         *ppcde = pcde;
     }
     pcde->value = value;
-    pcd->md5_valid = false;
+    COS_OBJECT_CHANGED(pcd);
     return 0;
 }
 int
@@ -1467,7 +1484,7 @@ cos_dict_move_all(cos_dict_t *pcdto, cos_dict_t *pcdfrom)
     }
     pcdto->elements = head;
     pcdfrom->elements = 0;
-    pcdto->md5_valid = false;
+    COS_OBJECT_CHANGED(pcdto);
     return 0;
 }
 
@@ -1502,6 +1519,38 @@ int cos_dict_hash(const cos_object_t *pco0, gs_md5_state_t *md5, gs_md5_byte_t *
     return 0;
 }
 
+/* Hash a dictionary as cos_dict_hash does, leaving out some keys. */
+int
+cos_dict_hash_except(const cos_dict_t *pcd, gs_md5_state_t *md5,
+                     const char *const *skip, gx_device_pdf *pdev)
+{
+    cos_dict_element_t *pcde = pcd->elements;
+    gs_md5_byte_t hash[16];
+
+    for (; pcde; pcde = pcde->next) {
+        const char *const *pk;
+        int code;
+
+        for (pk = skip; *pk != NULL; pk++)
+            if (pcde->key.size == strlen(*pk) &&
+                !memcmp(pcde->key.data, *pk, pcde->key.size))
+                break;
+        if (*pk != NULL)
+            continue;
+        gs_md5_append(md5, pcde->key.data, pcde->key.size);
+        if (pcde->value.value_type == COS_VALUE_RESOURCE) {
+            long id = pcde->value.contents.object->id;
+
+            gs_md5_append(md5, (const byte *)&id, sizeof(id));
+        } else {
+            code = cos_value_hash(&pcde->value, md5, hash, pdev);
+            if (code < 0)
+                return code;
+        }
+    }
+    return 0;
+}
+
 /* Compare two dictionaries. */
 int
 cos_dict_equal(const cos_object_t *pco0, const cos_object_t *pco1, gx_device_pdf *pdev)
@@ -2049,6 +2098,8 @@ cos_write_stream_alloc(cos_stream_t *pcs, gx_device_pdf *pdev,
     ss->templat = &cos_write_stream_template;
     ss->pcs = pcs;
     ss->pcs->stream_md5_valid = 0;
+    if (ss->pcs->hash_index != NULL)
+        pdf_resource_index_changed(ss->pcs->hash_index);
     gs_md5_init(&ss->pcs->md5);
     memset(&ss->pcs->hash, 0x00, 16);
     ss->pdev = pdev;
@@ -111,6 +111,7 @@ struct otype_s {\
     cos_stream_piece_t *pieces;\
     gs_memory_t *mem;\
     pdf_resource_t *pres;	/* only for BP/EP XObjects */\
+    pdf_resource_index_t *hash_index; /* not GC'd, see gdevpdfu.c */\
     byte is_open;		/* see above */\
     byte is_graphics;		/* see above */\
     byte written;		/* see above */\
@@ -302,6 +303,9 @@ const cos_array_element_t *
 /* Look up a key in a dictionary. */
 const cos_value_t *cos_dict_find(const cos_dict_t *, const byte *, uint);
 const cos_value_t *cos_dict_find_c_key(const cos_dict_t *, const char *);
+/* Hash a dictionary except for the keys in 'skip', a NULL terminated list. */
+int cos_dict_hash_except(const cos_dict_t *pcd, gs_md5_state_t *md5,
+                         const char *const *skip, gx_device_pdf *pdev);
 /* Process all entries in a dictionary. */
 int cos_dict_forall(const cos_dict_t *pcd, void *client_data,
         int (*proc)(void *client_data, const byte *key_data, uint key_size, const cos_value_t *v));
@@ -346,6 +350,10 @@ int cos_dict_objects_delete(cos_dict_t *);
 int cos_write_object(cos_object_t *pco, gx_device_pdf *pdev, pdf_resource_type_t type);
 #define COS_WRITE_OBJECT(pc, pdev, type) cos_write_object(COS_OBJECT(pc), pdev, type)
 
+/* Note that the contents of a Cos object have changed. */
+void cos_object_changed(cos_object_t *pco);
+#define COS_OBJECT_CHANGED(pc) cos_object_changed(COS_OBJECT(pc))
+
 /* Free a Cos value owned by a Cos object. */
 void cos_value_free(const cos_value_t *, gs_memory_t *, client_name_t);
 
@@ -134,6 +134,12 @@ static const gs_param_item_t pdf_param_items[] = {
     pi("OmitXMP", gs_param_type_bool, OmitXMP),
     pi("ModifiesPageSize", gs_param_type_bool, ModifiesPageSize),
     pi("ModifiesPageOrder", gs_param_type_bool, ModifiesPageOrder),
+    pi("WriteObjStms", gs_param_type_bool, WriteObjStms),
+    pi("WriteXRefStm", gs_param_type_bool, WriteXRefStm),
+    pi("ThreadedImageCompression", gs_param_type_bool, ThreadedImageCompression),
+    pi("StreamPages", gs_param_type_bool, StreamPages),
+    pi("FontCompressionThreads", gs_param_type_int, FontCompressionThreads),
+    pi("OptimizeContentStreams", gs_param_type_bool, OptimizeContentStreams),
 #undef pi
     gs_param_item_end
 };
@@ -308,6 +314,18 @@ gdev_pdf_get_param(gx_device *dev, char *Param, void *list)
         return(param_write_bool(plist, "OmitXMP", &pdev->OmitXMP));
     if (strcmp(Param, "OmitID") == 0)
         return(param_write_bool(plist, "OmitID", &pdev->OmitID));
+    if (strcmp(Param, "WriteObjStms") == 0)
+        return(param_write_bool(plist, "WriteObjStms", &pdev->WriteObjStms));
+    if (strcmp(Param, "WriteXRefStm") == 0)
+        return(param_write_bool(plist, "WriteXRefStm", &pdev->WriteXRefStm));
+    if (strcmp(Param, "ThreadedImageCompression") == 0)
+        return(param_write_bool(plist, "ThreadedImageCompression", &pdev->ThreadedImageCompression));
+    if (strcmp(Param, "StreamPages") == 0)
+        return(param_write_bool(plist, "StreamPages", &pdev->StreamPages));
+    if (strcmp(Param, "FontCompressionThreads") == 0)
+        return(param_write_int(plist, "FontCompressionThreads", &pdev->FontCompressionThreads));
+    if (strcmp(Param, "OptimizeContentStreams") == 0)
+        return(param_write_bool(plist, "OptimizeContentStreams", &pdev->OptimizeContentStreams));
 
     return gdev_psdf_get_param(dev, Param, list);
 }
@@ -883,6 +901,45 @@ gdev_pdf_put_params_impl(gx_device * dev, const gx_device_pdf * save_dev, gs_par
         pdev->Linearise = false;
     }
 
+    /* Object streams can only be found through a cross-reference stream. */
+    if (pdev->WriteObjStms)
+        pdev->WriteXRefStm = true;
+
+    if (pdev->WriteXRefStm && pdev->is_ps2write) {
+        emprintf(pdev->memory, "Can't write object or cross-reference streams in PostScript output, ignoring\n");
+        pdev->WriteObjStms = pdev->WriteXRefStm = false;
+    }
+
+    if (pdev->WriteXRefStm && pdev->CompatibilityLevel < 1.5) {
+        emprintf(pdev->memory, "Object and cross-reference streams require CompatibilityLevel >= 1.5, ignoring\n");
+        pdev->WriteObjStms = pdev->WriteXRefStm = false;
+    }
+
+    if (pdev->WriteXRefStm && pdev->Linearise) {
+        emprintf(pdev->memory, "Can't write object or cross-reference streams when linearising, ignoring\n");
+        pdev->WriteObjStms = pdev->WriteXRefStm = false;
+    }
+
+    if (pdev->WriteXRefStm && pdev->params.ASCII85EncodePages) {
+        emprintf(pdev->memory, "Can't write object or cross-reference streams with ASCII85EncodePages, ignoring\n");
+        pdev->WriteObjStms = pdev->WriteXRefStm = false;
+    }
+
+    if (pdev->WriteObjStms && pdev->OwnerPassword.size != 0) {
+        emprintf(pdev->memory, "Can't write object streams in encrypted PDF, ignoring\n");
+        pdev->WriteObjStms = false;
+    }
+
+    if (pdev->StreamPages && pdev->is_ps2write) {
+        emprintf(pdev->memory, "Can't stream pages in PostScript output, ignoring\n");
+        pdev->StreamPages = false;
+    }
+
+    if (pdev->FontCompressionThreads < 0) {
+        emprintf(pdev->memory, "FontCompressionThreads must not be negative, ignoring\n");
+        pdev->FontCompressionThreads = 0;
+    }
+
     if (pdev->FlattenFonts)
         pdev->PreserveTrMode = false;
     return 0;
@@ -0,0 +1,887 @@
+/* Copyright (C) 2001-2023 Artifex Software, Inc.
+   All Rights Reserved.
+
+   This software is provided AS-IS with no warranty, either express or
+   implied.
+
+   This software is distributed under license and may not be copied,
+   modified or distributed except as expressly authorized under the terms
+   of the license contained in the file LICENSE in this distribution.
+
+   Refer to licensing information at http://www.artifex.com or contact
+   Artifex Software, Inc.,  39 Mesa Street, Suite 108A, San Francisco,
+   CA 94129, USA, for further information.
+*/
+
+
+/* Content stream optimiser for pdfwrite */
+#include "memory_.h"
+#include "string_.h"
+#include "gx.h"
+#include "gserrors.h"
+#include "gdevpdfx.h"
+#include "strimpl.h"
+
+/*
+ * With OptimizeContentStreams, the page contents pass through this filter
+ * on their way to the compression filter. It splits the contents into
+ * operations (operands followed by an operator), and makes some peephole
+ * optimisations which don't change the rendering:
+ *
+ *      - q immediately followed by Q is removed;
+ *      - an operator setting a graphics state parameter (w, J, j, M, d,
+ *        ri, i, the fill and stroke colours, or one of the text state
+ *        parameters) to the value it already has is removed, the values
+ *        being saved and restored by q and Q;
+ *      - a moveto immediately followed by another moveto is removed, and
+ *        consecutive horizontal or vertical linetos in the same direction
+ *        are merged;
+ *      - numbers are written without redundant zeros or signs, and tokens
+ *        are only separated by white space where necessary.
+ *
+ * Numbers are not rounded, so the geometry is unchanged. Anything the
+ * filter doesn't recognise (comments, in-line images, unknown operators,
+ * unbalanced delimiters) makes it copy the rest of the stream unchanged.
+ * pdfwrite writes in-line images around the filter, see
+ * pdf_bypass_content_optimizer.
+ */
+
+/* Graphics state parameters whose values are remembered. */
+typedef enum {
+    OPT_LW, OPT_LC, OPT_LJ, OPT_ML, OPT_DASH, OPT_RI, OPT_FL,
+    OPT_FILL, OPT_STROKE,
+    OPT_TC, OPT_TW, OPT_TZ, OPT_TL, OPT_TF, OPT_TR, OPT_TS,
+    OPT_NUM_PARAMS
+} pdf_opt_param_t;
+
+#define OPT_PARAM_SIZE 48	/* longest operation remembered */
+#define OPT_MAX_DEPTH 32	/* q levels remembered */
+#define OPT_POINT_SIZE 24	/* longest coordinate for merging paths */
+#define OPT_BUF_SIZE 512
+
+typedef struct pdf_opt_value_s {
+    byte size;			/* 0 if unknown */
+    byte data[OPT_PARAM_SIZE];
+} pdf_opt_value_t;
+
+typedef struct pdf_opt_point_s {
+    byte size[2];
+    byte text[2][OPT_POINT_SIZE];
+    double v[2];
+} pdf_opt_point_t;
+
+/* Scanner states */
+enum {
+    OPT_SCAN_NONE,		/* between tokens */
+    OPT_SCAN_REGULAR,		/* number or keyword */
+    OPT_SCAN_NAME,
+    OPT_SCAN_STRING,
+    OPT_SCAN_HEX,
+    OPT_SCAN_LT,		/* after <, hex string or dictionary */
+    OPT_SCAN_GT			/* after >, end of dictionary */
+};
+
+typedef struct stream_PDFOpt_state_s {
+    stream_state_common;
+    gs_memory_t *buf_memory;	/* non-gc, for op and out */
+    /* Scanner */
+    int scan;
+    int string_depth;
+    bool escape;
+    int depth;			/* array and dictionary nesting */
+    bool verbatim;		/* copying the rest of the stream */
+    bool ended;
+    /* The current operation, as it will be written */
+    byte *op;
+    uint op_size, op_alloc;
+    uint token_start;
+    int num_operands;		/* at depth 0 */
+    int num_numbers;		/* at depth 0 */
+    uint operand_start[2];	/* last 2 operands at depth 0 */
+    uint operand_size[2];
+    /* Output not yet written */
+    byte *out;
+    uint out_pos, out_size, out_alloc;
+    /* Operations held back */
+    int pending_q;
+    int pending_path;		/* 0, 'm' or 'l' */
+    pdf_opt_point_t pending_point;
+    bool current_valid;
+    pdf_opt_point_t current_point; /* start of the pending lineto */
+    /* Graphics state parameters, for each q level */
+    int level;
+    int overflow;		/* q levels beyond OPT_MAX_DEPTH */
+    pdf_opt_value_t values[OPT_MAX_DEPTH + 1][OPT_NUM_PARAMS];
+    /* Statistics */
+    int64_t in_count;
+    int64_t out_count;
+    long removed;		/* operators removed */
+} stream_PDFOpt_state;
+
+/* The buffers are in non-garbage-collected memory. */
+gs_private_st_simple(st_PDFOpt_state, stream_PDFOpt_state,
+                     "stream_PDFOpt_state");
+
+/* The operators, and the parameters they set. */
+typedef struct pdf_opt_operator_s {
+    const char *name;
+    int param;			/* -1 if none */
+} pdf_opt_operator_t;
+
+static const pdf_opt_operator_t pdf_opt_operators[] = {
+    {"b", -1}, {"B", -1}, {"b*", -1}, {"B*", -1}, {"BDC", -1}, {"BI", -1},
+    {"BMC", -1}, {"BT", -1}, {"BX", -1}, {"c", -1}, {"cm", -1},
+    {"CS", OPT_STROKE}, {"cs", OPT_FILL}, {"d", OPT_DASH}, {"d0", -1},
+    {"d1", -1}, {"Do", -1}, {"DP", -1}, {"EI", -1}, {"EMC", -1}, {"ET", -1},
+    {"EX", -1}, {"f", -1}, {"F", -1}, {"f*", -1}, {"G", OPT_STROKE},
+    {"g", OPT_FILL}, {"gs", -1}, {"h", -1}, {"i", OPT_FL}, {"ID", -1},
+    {"j", OPT_LJ}, {"J", OPT_LC}, {"K", OPT_STROKE}, {"k", OPT_FILL},
+    {"l", -1}, {"m", -1}, {"M", OPT_ML}, {"MP", -1}, {"n", -1}, {"q", -1},
+    {"Q", -1}, {"re", -1}, {"RG", OPT_STROKE}, {"rg", OPT_FILL},
+    {"ri", OPT_RI}, {"s", -1}, {"S", -1}, {"SC", OPT_STROKE},
+    {"sc", OPT_FILL}, {"SCN", OPT_STROKE}, {"scn", OPT_FILL}, {"sh", -1},
+    {"T*", -1}, {"Tc", OPT_TC}, {"Td", -1}, {"TD", -1}, {"Tf", OPT_TF},
+    {"Tj", -1}, {"TJ", -1}, {"TL", OPT_TL}, {"Tm", -1}, {"Tr", OPT_TR},
+    {"Ts", OPT_TS}, {"Tw", OPT_TW}, {"Tz", OPT_TZ}, {"v", -1}, {"w", OPT_LW},
+    {"W", -1}, {"W*", -1}, {"y", -1}, {"'", -1}, {"\"", -1}
+};
+
+static bool
+opt_is_white(byte c)
+{
+    return c == 0 || c == '\t' || c == '\n' || c == '\f' || c == '\r' ||
+        c == ' ';
+}
+
+static bool
+opt_is_delimiter(byte c)
+{
+    return c == '(' || c == ')' || c == '<' || c == '>' || c == '[' ||
+        c == ']' || c == '{' || c == '}' || c == '/' || c == '%';
+}
+
+static bool
+opt_is_regular(byte c)
+{
+    return !opt_is_white(c) && !opt_is_delimiter(c);
+}
+
+/* Make sure a buffer has room for 'size' more bytes. */
+static int
+opt_reserve(stream_PDFOpt_state *ss, byte **pbuf, uint *palloc, uint used,
+            uint size)
+{
+    uint alloc = *palloc;
+    byte *buf;
+
+    if (size <= alloc - used)
+        return 0;
+    if (alloc == 0)
+        alloc = 256;
+    while (size > alloc - used) {
+        if (alloc > max_uint / 2)
+            return_error(gs_error_limitcheck);
+        alloc *= 2;
+    }
+    buf = gs_alloc_bytes(ss->buf_memory, alloc, "stream_PDFOpt_state(buf)");
+    if (buf == NULL)
+        return_error(gs_error_VMerror);
+    if (used > 0)
+        memcpy(buf, *pbuf, used);
+    gs_free_object(ss->buf_memory, *pbuf, "stream_PDFOpt_state(buf)");
+    *pbuf = buf;
+    *palloc = alloc;
+    return 0;
+}
+
+static int
+opt_put_op(stream_PDFOpt_state *ss, byte c)
+{
+    int code = opt_reserve(ss, &ss->op, &ss->op_alloc, ss->op_size, 1);
+
+    if (code < 0)
+        return code;
+    ss->op[ss->op_size++] = c;
+    return 0;
+}
+
+static int
+opt_write(stream_PDFOpt_state *ss, const byte *data, uint size)
+{
+    int code;
+
+    if (ss->out_pos == ss->out_size)
+        ss->out_pos = ss->out_size = 0;
+    code = opt_reserve(ss, &ss->out, &ss->out_alloc, ss->out_size, size);
+    if (code < 0)
+        return code;
+    memcpy(ss->out + ss->out_size, data, size);
+    ss->out_size += size;
+    return 0;
+}
+
+/* Write an operation, which is in op, followed by a newline. */
+static int
+opt_write_op(stream_PDFOpt_state *ss, const byte *data, uint size)
+{
+    int code = opt_write(ss, data, size);
+
+    return (code < 0 ? code : opt_write(ss, (const byte *)"\n", 1));
+}
+
+/* ------ Graphics state ------ */
+
+static void
+opt_forget(stream_PDFOpt_state *ss, int first, int last)
+{
+    int i;
+
+    for (i = first; i <= last; i++)
+        ss->values[ss->level][i].size = 0;
+}
+
+static int
+opt_flush_q(stream_PDFOpt_state *ss)
+{
+    for (; ss->pending_q > 0; ss->pending_q--) {
+        int code = opt_write_op(ss, (const byte *)"q", 1);
+
+        if (code < 0)
+            return code;
+        if (ss->level < OPT_MAX_DEPTH) {
+            memcpy(ss->values[ss->level + 1], ss->values[ss->level],
+                   sizeof(ss->values[0]));
+            ss->level++;
+        } else
+            ss->overflow++;
+    }
+    return 0;
+}
+
+static void
+opt_restore(stream_PDFOpt_state *ss)
+{
+    if (ss->overflow > 0) {
+        /* We didn't save this level. */
+        ss->overflow--;
+        opt_forget(ss, 0, OPT_NUM_PARAMS - 1);
+    } else if (ss->level > 0)
+        ss->level--;
+    else
+        opt_forget(ss, 0, OPT_NUM_PARAMS - 1);
+}
+
+/* ------ Paths ------ */
+
+static int
+opt_write_point(stream_PDFOpt_state *ss, const pdf_opt_point_t *pt, int op)
+{
+    byte text[2 * OPT_POINT_SIZE + 4];
+    uint size = 0;
+
+    memcpy(text, pt->text[0], pt->size[0]);
+    size += pt->size[0];
+    text[size++] = ' ';
+    memcpy(text + size, pt->text[1], pt->size[1]);
+    size += pt->size[1];
+    text[size++] = ' ';
+    text[size++] = (byte)op;
+    return opt_write_op(ss, text, size);
+}
+
+static int
+opt_flush_path(stream_PDFOpt_state *ss)
+{
+    int code;
+
+    if (ss->pending_path == 0)
+        return 0;
+    code = opt_write_point(ss, &ss->pending_point, ss->pending_path);
+    ss->current_point = ss->pending_point;
+    ss->current_valid = true;
+    ss->pending_path = 0;
+    return code;
+}
+
+static int
+opt_flush(stream_PDFOpt_state *ss)
+{
+    int code = opt_flush_q(ss);
+
+    return (code < 0 ? code : opt_flush_path(ss));
+}
+
+/* Parse a compacted number. */
+static double
+opt_number_value(const byte *p, uint size)
+{
+    double v = 0, scale = 1;
+    bool neg = false, frac = false;
+    uint i;
+
+    for (i = 0; i < size; i++) {
+        if (p[i] == '-')
+            neg = true;
+        else if (p[i] == '.')
+            frac = true;
+        else {
+            v = v * 10 + (p[i] - '0');
+            if (frac)
+                scale *= 10;
+        }
+    }
+    return (neg ? -v : v) / scale;
+}
+
+/* Check whether a lineto continues the pending one in the same direction. */
+static bool
+opt_extends_line(const pdf_opt_point_t *p0, const pdf_opt_point_t *p1,
+                 const pdf_opt_point_t *p2)
+{
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        int j = 1 - i;
+
+        if (p0->size[j] == p1->size[j] && p1->size[j] == p2->size[j] &&
+            !memcmp(p0->text[j], p1->text[j], p0->size[j]) &&
+            !memcmp(p1->text[j], p2->text[j], p1->size[j]))
+            return ((p1->v[i] > p0->v[i] && p2->v[i] > p1->v[i]) ||
+                    (p1->v[i] < p0->v[i] && p2->v[i] < p1->v[i]));
+    }
+    return false;
+}
+
+/* Handle m or l. Return 1 if the operation isn't a simple one. */
+static int
+opt_path(stream_PDFOpt_state *ss, int op)
+{
+    pdf_opt_point_t pt;
+    int i;
+
+    if (ss->num_operands != 2 || ss->num_numbers != 2)
+        return 1;
+    for (i = 0; i < 2; i++) {
+        if (ss->operand_size[i] > OPT_POINT_SIZE)
+            return 1;
+        pt.size[i] = ss->operand_size[i];
+        memcpy(pt.text[i], ss->op + ss->operand_start[i], pt.size[i]);
+        pt.v[i] = opt_number_value(pt.text[i], pt.size[i]);
+    }
+    if (op == 'm') {
+        if (ss->pending_path == 'm')
+            ss->removed++;
+        else {
+            int code = opt_flush(ss);
+
+            if (code < 0)
+                return code;
+        }
+    } else {
+        if (ss->pending_path == 'l' && ss->current_valid &&
+            opt_extends_line(&ss->current_point, &ss->pending_point, &pt))
+            ss->removed++;
+        else {
+            int code = opt_flush(ss);
+
+            if (code < 0)
+                return code;
+        }
+    }
+    ss->pending_path = op;
+    ss->pending_point = pt;
+    return 0;
+}
+
+/* ------ Operations ------ */
+
+static void opt_bail(stream_PDFOpt_state *ss);
+
+/* Process a complete operation. */
+static int
+opt_operation(stream_PDFOpt_state *ss)
+{
+    const byte *name = ss->op + ss->token_start;
+    uint size = ss->op_size - ss->token_start;
+    const pdf_opt_operator_t *po = NULL;
+    int i, code;
+
+    for (i = 0; i < countof(pdf_opt_operators); i++)
+        if (strlen(pdf_opt_operators[i].name) == size &&
+            !memcmp(pdf_opt_operators[i].name, name, size)) {
+            po = &pdf_opt_operators[i];
+            break;
+        }
+    if (po == NULL || !strcmp(po->name, "BI") || !strcmp(po->name, "ID") ||
+        !strcmp(po->name, "EI")) {
+        opt_bail(ss);
+        return 0;
+    }
+    if (size == 1 && (*name == 'm' || *name == 'l')) {
+        code = opt_path(ss, *name);
+        if (code <= 0)
+            return code;
+    } else if (size == 1 && *name == 'q') {
+        ss->pending_q++;
+        return 0;
+    } else if (size == 1 && *name == 'Q' && ss->pending_q > 0) {
+        ss->pending_q--;
+        ss->removed += 2;
+        return 0;
+    } else if (po->param >= 0) {
+        pdf_opt_value_t *pv = &ss->values[ss->level][po->param];
+
+        if (pv->size != 0 && pv->size == ss->op_size &&
+            !memcmp(pv->data, ss->op, pv->size)) {
+            ss->removed++;
+            return 0;
+        }
+    }
+    code = opt_flush(ss);
+    if (code < 0)
+        return code;
+    code = opt_write_op(ss, ss->op, ss->op_size);
+    if (code < 0)
+        return code;
+    ss->current_valid = false;
+    if (po->param >= 0) {
+        pdf_opt_value_t *pv = &ss->values[ss->level][po->param];
+
+        if (ss->op_size <= OPT_PARAM_SIZE) {
+            pv->size = ss->op_size;
+            memcpy(pv->data, ss->op, ss->op_size);
+        } else
+            pv->size = 0;
+    } else if (size == 1 && *name == 'Q')
+        opt_restore(ss);
+    else if (size == 2 && !memcmp(name, "gs", 2)) {
+        /* An ExtGState can set anything but the colours and text state. */
+        opt_forget(ss, OPT_LW, OPT_FL);
+        opt_forget(ss, OPT_TF, OPT_TF);
+    }
+    return 0;
+}
+
+/* Copy the rest of the stream unchanged. */
+static void
+opt_bail(stream_PDFOpt_state *ss)
+{
+    /* Errors are reported when the output is written. */
+    if (opt_flush(ss) >= 0)
+        opt_write(ss, ss->op, ss->op_size);
+    ss->op_size = 0;
+    ss->verbatim = true;
+}
+
+/* ------ Tokens ------ */
+
+/* Rewrite a number without redundant characters. */
+static bool
+opt_compact_number(byte *p, uint *psize)
+{
+    uint size = *psize, i = 0, int_start, int_end, frac_start, frac_end;
+    bool neg = false;
+    uint n = 0;
+
+    if (i < size && (p[i] == '-' || p[i] == '+'))
+        neg = (p[i++] == '-');
+    int_start = i;
+    while (i < size && p[i] >= '0' && p[i] <= '9')
+        i++;
+    int_end = frac_start = frac_end = i;
+    if (i < size && p[i] == '.') {
+        frac_start = ++i;
+        while (i < size && p[i] >= '0' && p[i] <= '9')
+            i++;
+        frac_end = i;
+    }
+    if (i != size || (int_end == int_start && frac_end == frac_start))
+        return false;
+    while (int_start < int_end && p[int_start] == '0')
+        int_start++;
+    while (frac_end > frac_start && p[frac_end - 1] == '0')
+        frac_end--;
+    if (int_start == int_end && frac_start == frac_end) {
+        p[0] = '0';
+        *psize = 1;
+        return true;
+    }
+    if (neg)
+        p[n++] = '-';
+    for (i = int_start; i < int_end; i++)
+        p[n++] = p[i];
+    if (frac_start < frac_end) {
+        p[n++] = '.';
+        for (i = frac_start; i < frac_end; i++)
+            p[n++] = p[i];
+    }
+    *psize = n;
+    return true;
+}
+
+/* Start a token whose first character is c. */
+static int
+opt_begin_token(stream_PDFOpt_state *ss, byte c)
+{
+    int code;
+
+    if (ss->op_size > 0 && opt_is_regular(ss->op[ss->op_size - 1]) &&
+        opt_is_regular(c)) {
+        code = opt_put_op(ss, ' ');
+        if (code < 0)
+            return code;
+    }
+    ss->token_start = ss->op_size;
+    return opt_put_op(ss, c);
+}
+
+/* Count an operand at depth 0. */
+static void
+opt_operand(stream_PDFOpt_state *ss, bool number)
+{
+    if (ss->depth > 0)
+        return;
+    ss->num_operands++;
+    if (number)
+        ss->num_numbers++;
+    ss->operand_start[0] = ss->operand_start[1];
+    ss->operand_size[0] = ss->operand_size[1];
+    ss->operand_start[1] = ss->token_start;
+    ss->operand_size[1] = ss->op_size - ss->token_start;
+}
+
+/* Finish a number or keyword. */
+static int
+opt_end_regular(stream_PDFOpt_state *ss)
+{
+    byte *p = ss->op + ss->token_start;
+    uint size = ss->op_size - ss->token_start;
+    int code;
+
+    if (opt_compact_number(p, &size)) {
+        ss->op_size = ss->token_start + size;
+        opt_operand(ss, true);
+        return 0;
+    }
+    if (ss->depth > 0 ||
+        (size == 4 && (!memcmp(p, "true", 4) || !memcmp(p, "null", 4))) ||
+        (size == 5 && !memcmp(p, "false", 5))) {
+        opt_operand(ss, false);
+        return 0;
+    }
+    code = opt_operation(ss);
+    ss->op_size = 0;
+    ss->num_operands = ss->num_numbers = 0;
+    return code;
+}
+
+/* Process one character of the contents. */
+static int
+opt_char(stream_PDFOpt_state *ss, byte c)
+{
+    int code;
+
+    for (;;) {
+        switch (ss->scan) {
+        case OPT_SCAN_REGULAR:
+        case OPT_SCAN_NAME:
+            if (opt_is_regular(c))
+                return opt_put_op(ss, c);
+            if (ss->scan == OPT_SCAN_NAME) {
+                opt_operand(ss, false);
+                code = 0;
+            } else
+                code = opt_end_regular(ss);
+            ss->scan = OPT_SCAN_NONE;
+            if (code < 0)
+                return code;
+            if (ss->verbatim)
+                return opt_write(ss, &c, 1);
+            continue;
+        case OPT_SCAN_STRING:
+            code = opt_put_op(ss, c);
+            if (ss->escape)
+                ss->escape = false;
+            else if (c == '\\')
+                ss->escape = true;
+            else if (c == '(')
+                ss->string_depth++;
+            else if (c == ')' && --ss->string_depth == 0) {
+                opt_operand(ss, false);
+                ss->scan = OPT_SCAN_NONE;
+            }
+            return code;
+        case OPT_SCAN_HEX:
+            if (opt_is_white(c))
+                return 0;
+            code = opt_put_op(ss, c);
+            if (c == '>') {
+                opt_operand(ss, false);
+                ss->scan = OPT_SCAN_NONE;
+            }
+            return code;
+        case OPT_SCAN_LT:
+            if (c == '<') {
+                code = opt_begin_token(ss, '<');
+                if (code >= 0)
+                    code = opt_put_op(ss, '<');
+                opt_operand(ss, false);
+                ss->depth++;
+                ss->scan = OPT_SCAN_NONE;
+                return code;
+            }
+            code = opt_begin_token(ss, '<');
+            if (code < 0)
+                return code;
+            ss->scan = OPT_SCAN_HEX;
+            continue;
+        case OPT_SCAN_GT:
+            ss->scan = OPT_SCAN_NONE;
+            if (c != '>' || ss->depth == 0) {
+                code = opt_put_op(ss, '>');
+                if (code < 0)
+                    return code;
+                opt_bail(ss);
+                return opt_write(ss, &c, 1);
+            }
+            code = opt_begin_token(ss, '>');
+            ss->depth--;
+            return (code < 0 ? code : opt_put_op(ss, '>'));
+        default:		/* OPT_SCAN_NONE */
+            if (opt_is_white(c))
+                return 0;
+            switch (c) {
+            case '/':
+                ss->scan = OPT_SCAN_NAME;
+                return opt_begin_token(ss, c);
+            case '(':
+                ss->scan = OPT_SCAN_STRING;
+                ss->string_depth = 1;
+                ss->escape = false;
+                return opt_begin_token(ss, c);
+            case '<':
+                ss->scan = OPT_SCAN_LT;
+                return 0;
+            case '>':
+                ss->scan = OPT_SCAN_GT;
+                return 0;
+            case '[':
+                code = opt_begin_token(ss, c);
+                opt_operand(ss, false);
+                ss->depth++;
+                return code;
+            case ']':
+                if (ss->depth == 0)
+                    break;
+                ss->depth--;
+                return opt_begin_token(ss, c);
+            case ')': case '{': case '}': case '%':
+                break;
+            default:
+                ss->scan = OPT_SCAN_REGULAR;
+                return opt_begin_token(ss, c);
+            }
+            opt_bail(ss);
+            return opt_write(ss, &c, 1);
+        }
+    }
+}
+
+/* Write out everything held back. */
+static int
+opt_end(stream_PDFOpt_state *ss)
+{
+    int code = 0;
+
+    switch (ss->scan) {
+    case OPT_SCAN_REGULAR:
+        code = opt_end_regular(ss);
+        break;
+    case OPT_SCAN_LT:
+        code = opt_put_op(ss, '<');
+        break;
+    case OPT_SCAN_GT:
+        code = opt_put_op(ss, '>');
+        break;
+    }
+    ss->scan = OPT_SCAN_NONE;
+    if (code < 0)
+        return code;
+    if (ss->op_size > 0 && !ss->verbatim)
+        opt_bail(ss);
+    return opt_flush(ss);
+}
+
+/* ------ Stream procedures ------ */
+
+static int
+s_PDFOpt_init(stream_state *st)
+{
+    stream_PDFOpt_state *const ss = (stream_PDFOpt_state *)st;
+
+    ss->buf_memory = st->memory->non_gc_memory;
+    ss->scan = OPT_SCAN_NONE;
+    ss->string_depth = ss->depth = 0;
+    ss->escape = ss->verbatim = ss->ended = false;
+    ss->op = ss->out = NULL;
+    ss->op_size = ss->op_alloc = ss->token_start = 0;
+    ss->num_operands = ss->num_numbers = 0;
+    ss->out_pos = ss->out_size = ss->out_alloc = 0;
+    ss->pending_q = ss->pending_path = 0;
+    ss->current_valid = false;
+    ss->level = ss->overflow = 0;
+    opt_forget(ss, 0, OPT_NUM_PARAMS - 1);
+    ss->in_count = ss->out_count = 0;
+    ss->removed = 0;
+    return 0;
+}
+
+static int
+s_PDFOpt_process(stream_state *st, stream_cursor_read *pr,
+                 stream_cursor_write *pw, bool last)
+{
+    stream_PDFOpt_state *const ss = (stream_PDFOpt_state *)st;
+
+    for (;;) {
+        if (ss->out_pos < ss->out_size) {
+            uint count = min(ss->out_size - ss->out_pos,
+                             (uint)(pw->limit - pw->ptr));
+
+            memcpy(pw->ptr + 1, ss->out + ss->out_pos, count);
+            pw->ptr += count;
+            ss->out_pos += count;
+            ss->out_count += count;
+            if (ss->out_pos < ss->out_size)
+                return 1;
+        }
+        if (pr->ptr < pr->limit) {
+            if (ss->verbatim) {
+                uint count = min((uint)(pr->limit - pr->ptr),
+                                 (uint)(pw->limit - pw->ptr));
+
+                memcpy(pw->ptr + 1, pr->ptr + 1, count);
+                pr->ptr += count;
+                pw->ptr += count;
+                ss->in_count += count;
+                ss->out_count += count;
+                if (pr->ptr < pr->limit)
+                    return 1;
+            } else {
+                ss->in_count++;
+                if (opt_char(ss, *++(pr->ptr)) < 0)
+                    return ERRC;
+            }
+            continue;
+        }
+        if (!last || ss->ended)
+            return 0;
+        ss->ended = true;
+        if (opt_end(ss) < 0)
+            return ERRC;
+    }
+}
+
+static void
+s_PDFOpt_release(stream_state *st)
+{
+    stream_PDFOpt_state *const ss = (stream_PDFOpt_state *)st;
+
+    gs_free_object(ss->buf_memory, ss->op, "stream_PDFOpt_state(buf)");
+    gs_free_object(ss->buf_memory, ss->out, "stream_PDFOpt_state(buf)");
+    ss->op = ss->out = NULL;
+}
+
+static const stream_template s_PDFOpt_template = {
+    &st_PDFOpt_state, s_PDFOpt_init, s_PDFOpt_process, 1, 1,
+    s_PDFOpt_release
+};
+
+/* ------ Public ------ */
+
+static bool
+pdf_is_content_optimizer(const stream *s)
+{
+    return s != NULL && s->state != NULL &&
+        s->state->templat == &s_PDFOpt_template;
+}
+
+/* Add the content optimiser on top of pdev->strm. */
+int
+pdf_begin_content_optimizer(gx_device_pdf *pdev)
+{
+    gs_memory_t *mem = pdev->pdf_memory;
+    stream *s = s_alloc(mem, "PDF optimiser stream");
+    byte *buf = gs_alloc_bytes(mem, OPT_BUF_SIZE, "PDF optimiser buffer");
+    stream_PDFOpt_state *ss = (stream_PDFOpt_state *)
+        s_alloc_state(mem, &st_PDFOpt_state, "PDF optimiser state");
+    int code;
+
+    if (s == NULL || buf == NULL || ss == NULL) {
+        gs_free_object(mem, ss, "PDF optimiser state");
+        gs_free_object(mem, buf, "PDF optimiser buffer");
+        gs_free_object(mem, s, "PDF optimiser stream");
+        return_error(gs_error_VMerror);
+    }
+    ss->templat = &s_PDFOpt_template;
+    code = s_init_filter(s, (stream_state *)ss, buf, OPT_BUF_SIZE, pdev->strm);
+    if (code < 0)
+        return_error(gs_error_VMerror);
+    pdev->strm = s;
+    return 0;
+}
+
+/*
+ * If pdev->strm is the content optimiser, write out everything it holds,
+ * and make pdev->strm the stream below it, so that the caller can write
+ * data which mustn't be parsed. The caller restores pdev->strm. Return 1
+ * if pdev->strm was changed.
+ */
+int
+pdf_bypass_content_optimizer(gx_device_pdf *pdev)
+{
+    stream *s = pdev->strm;
+    stream_PDFOpt_state *ss;
+
+    if (!pdf_is_content_optimizer(s))
+        return 0;
+    ss = (stream_PDFOpt_state *)s->state;
+    if (sflush(s) < 0)
+        return_error(gs_error_ioerror);
+    if (!ss->verbatim) {
+        int code = opt_end(ss);
+
+        if (code < 0)
+            return code;
+        ss->current_valid = false;
+    }
+    if (sflush(s) < 0)
+        return_error(gs_error_ioerror);
+    pdev->strm = s->strm;
+    return 1;
+}
+
+/*
+ * If pdev->strm is the content optimiser, write out everything it holds,
+ * and report the statistics for the page if required. Return 1 if it was
+ * the optimiser, which the caller then closes.
+ */
+int
+pdf_end_content_optimizer(gx_device_pdf *pdev)
+{
+    stream *s = pdev->strm;
+    stream_PDFOpt_state *ss;
+    int status;
+
+    if (!pdf_is_content_optimizer(s))
+        return 0;
+    ss = (stream_PDFOpt_state *)s->state;
+    status = s_process_write_buf(s, true);
+    if (status < 0 && status != EOFC)
+        return_error(gs_error_ioerror);
+    if (pdev->PrintStatistics)
+        dmprintf4(pdev->pdf_memory,
+                  "Page %d contents: %"PRId64" bytes optimised to %"PRId64", %ld operators removed.\n",
+                  pdev->next_page + 1, ss->in_count, ss->out_count,
+                  ss->removed);
+    return 1;
+}
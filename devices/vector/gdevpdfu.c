@@ -693,7 +693,7 @@ pdf_stell(gx_device_pdf * pdev)
     gs_offset_t pos = stell(s);
 
     if (s == pdev->asides.strm)
-        pos += ASIDES_BASE_POSITION;
+        pos += ASIDES_BASE_POSITION + pdev->asides_flushed;
     return pos;
 }
 
@@ -910,10 +910,149 @@ pdf_begin_obj(gx_device_pdf * pdev, pdf_resource_type_t type)
     return pdf_open_obj(pdev, 0L, type);
 }
 
+/* ------ Object streams ------ */
+
+/*
+ * Check whether the next object can go into the current object stream.
+ * We don't start one while another object is being written to the asides
+ * file or to the object stream itself: nested objects are written out
+ * normally, and a full object stream is flushed to the asides file when
+ * the next object is started, which must not be in the middle of another
+ * object there.
+ */
+static bool
+pdf_can_use_ObjStm(const gx_device_pdf * pdev)
+{
+    return pdev->WriteObjStms && pdev->ObjStm.strm != NULL &&
+        pdev->strm != NULL && pdev->strm != pdev->ObjStm.strm &&
+        pdev->strm != pdev->asides.strm && pdev->asides.save_strm == NULL;
+}
+
+/* Begin an object in the current object stream, starting one if needed. */
+static long
+pdf_open_ObjStm_obj(gx_device_pdf * pdev, long id)
+{
+    gp_file *tfile = pdev->xref.file;
+    gs_offset_t pos;
+    int code;
+
+    if (pdev->NumObjStmObjects == MAX_OBJSTM_OBJECTS) {
+        code = pdf_flush_ObjStm(pdev);
+        if (code < 0)
+            return code;
+    }
+    if (pdev->ObjStm_id == 0)
+        pdev->ObjStm_id = pdf_obj_forward_ref(pdev);
+    pos = OBJSTM_POSITION(pdev->ObjStm_id, pdev->NumObjStmObjects);
+    if (id <= 0) {
+        id = pdf_next_id(pdev);
+        gp_fwrite(&pos, sizeof(pos), 1, tfile);
+    } else {
+        int64_t tpos = gp_ftell(tfile);
+
+        if (gp_fseek(tfile, ((int64_t)(id - pdev->FirstObjectNumber)) * sizeof(pos),
+              SEEK_SET) != 0)
+	        return_error(gs_error_ioerror);
+        gp_fwrite(&pos, sizeof(pos), 1, tfile);
+        if (gp_fseek(tfile, tpos, SEEK_SET) != 0)
+	        return_error(gs_error_ioerror);
+    }
+    pdev->ObjStmIds[pdev->NumObjStmObjects] = id;
+    pdev->ObjStmOffsets[pdev->NumObjStmObjects] = stell(pdev->ObjStm.strm);
+    pdev->ObjStm.save_strm = pdev->strm;
+    pdev->strm = pdev->ObjStm.strm;
+    return id;
+}
+
+/* Begin an object which may be written into an object stream. */
+long
+pdf_open_compressible_obj(gx_device_pdf * pdev, long id, pdf_resource_type_t type)
+{
+    if (!pdf_can_use_ObjStm(pdev))
+        return pdf_open_obj(pdev, id, type);
+    return pdf_open_ObjStm_obj(pdev, id);
+}
+long
+pdf_open_compressible_separate(gx_device_pdf * pdev, long id, pdf_resource_type_t type)
+{
+    int code;
+
+    if (!pdf_can_use_ObjStm(pdev))
+        return pdf_open_separate(pdev, id, type);
+    code = pdfwrite_pdf_open_document(pdev);
+    if (code < 0)
+        return code;
+    return pdf_open_ObjStm_obj(pdev, id);
+}
+
+/* Write out the current object stream, if any. */
+int
+pdf_flush_ObjStm(gx_device_pdf * pdev)
+{
+    stream *save = pdev->strm, *s;
+    gs_offset_t body_size, start, length;
+    uint head_size = 0;
+    byte *head;
+    long length_id;
+    int i, n = pdev->NumObjStmObjects, code;
+
+    if (pdev->ObjStm_id == 0)
+        return 0;
+    /* Each entry is "id offset ", two numbers of at most 20 digits. */
+    head = gs_alloc_bytes(pdev->pdf_memory, n * 42 + 1, "pdf_flush_ObjStm");
+    if (head == NULL)
+        return_error(gs_error_VMerror);
+    for (i = 0; i < n; ++i)
+        head_size += gs_snprintf((char *)head + head_size, 43, "%ld %"PRId64" ",
+                                 pdev->ObjStmIds[i], (int64_t)pdev->ObjStmOffsets[i]);
+    sflush(pdev->ObjStm.strm);
+    body_size = stell(pdev->ObjStm.strm);
+
+    pdev->strm = pdev->asides.strm;
+    pdf_open_obj(pdev, pdev->ObjStm_id, resourceStream);
+    length_id = pdf_obj_ref(pdev);
+    s = pdev->strm;
+    pprintd2(s, "<</Type/ObjStm/N %d/First %d", n, head_size);
+    pprintld1(s, "/Length %ld 0 R", length_id);
+    pprints1(s, "/Filter/%s>>\nstream\n", compression_filter_name);
+    start = stell(s);
+    code = encode(&s, &compression_filter_template, pdev->pdf_memory);
+    if (code >= 0) {
+        stream_write(s, head, head_size);
+        if (gp_fseek(pdev->ObjStm.file, 0, SEEK_SET) != 0)
+            code = gs_note_error(gs_error_ioerror);
+        else
+            code = pdf_copy_data(s, pdev->ObjStm.file, body_size, NULL);
+        s_close_filters(&s, pdev->strm);
+    }
+    length = stell(pdev->strm) - start;
+    stream_puts(pdev->strm, "\nendstream\n");
+    pdf_end_obj(pdev, resourceStream);
+    pdf_open_obj(pdev, length_id, resourceLength);
+    pprintld1(pdev->strm, "%ld\n", (long)length);
+    pdf_end_obj(pdev, resourceLength);
+    pdev->strm = save;
+    gs_free_object(pdev->pdf_memory, head, "pdf_flush_ObjStm");
+
+    if (sseek(pdev->ObjStm.strm, 0) < 0 && code >= 0)
+        code = gs_note_error(gs_error_ioerror);
+    pdev->ObjStm_id = 0;
+    pdev->NumObjStmObjects = 0;
+    return code;
+}
+
 /* End an object. */
 int
 pdf_end_obj(gx_device_pdf * pdev, pdf_resource_type_t type)
 {
+    if (pdev->ObjStm.strm != NULL && pdev->strm == pdev->ObjStm.strm) {
+        /* Objects in an object stream have no 'obj' or 'endobj'. */
+        stream_putc(pdev->strm, '\n');
+        pdev->NumObjStmObjects++;
+        pdev->strm = pdev->ObjStm.save_strm;
+        pdev->ObjStm.save_strm = 0;
+        return 0;
+    }
     stream_puts(pdev->strm, "endobj\n");
     if (pdev->ForOPDFRead && pdev->ProduceDSC) {
         switch(type) {
@@ -1087,6 +1226,12 @@ none_to_stream(gx_device_pdf * pdev)
             }
             pdev->strm = s = es;
         }
+        if (pdev->OptimizeContentStreams) {
+            code = pdf_begin_content_optimizer(pdev);
+            if (code < 0)
+                return code;
+            s = pdev->strm;
+        }
     }
     /*
      * Scale the coordinate system.  Use an extra level of q/Q for the
@@ -1171,8 +1316,12 @@ stream_to_none(gx_device_pdf * pdev)
             if (code < 0)
                 return code;
         }
+        code = pdf_end_content_optimizer(pdev);
+        if (code < 0)
+            return code;
         target = pdev->strm;
-
+        if (code > 0)
+            target = target->strm;
         if (pdev->compression_at_page_start == pdf_compress_Flate)
             target = target->strm;
         if (!pdev->binary_ok)
@@ -1228,6 +1377,350 @@ pdf_close_contents(gx_device_pdf * pdev, bool last)
     return pdf_open_contents(pdev, PDF_IN_NONE);
 }
 
+/* ------ Resource hash index ------ */
+
+/*
+ * pdf_find_same_resource has to compare a new resource with every resource
+ * of the same type, which is quadratic in the number of resources when a job
+ * produces many thousands of images or ExtGStates. Since the Cos 'equal'
+ * procedures compare MD5 hashes of the objects, we keep for each resource
+ * type an index of the resources keyed by (part of) that hash, and only
+ * compare the resources with the same key.
+ *
+ * A resource is added to the index as 'pending' when it is allocated, since
+ * its object isn't complete then, and pending resources are compared by
+ * every search. It is moved into the hash table when it is itself the
+ * subject of a search, i.e. once it is complete. The candidates are
+ * compared in the same order as the chains are searched, using the
+ * chain_index and chain_seq of each resource, so that we find the same
+ * resource as the linear search.
+ *
+ * A hashed resource is only found under the key of its object's hash when
+ * it was indexed, so the object points back to the index (hash_index) and
+ * cos_object_changed marks the index as stale when the object is changed.
+ * When the index is rebuilt, a resource whose object is no longer hashed,
+ * or whose hash has changed, goes back to being pending.
+ *
+ * The index points to garbage collected resources but is not itself
+ * garbage collected. The device's relocation procedure marks it as stale,
+ * and it is then rebuilt from the resource chains on the next search.
+ */
+typedef enum {
+    pdf_resource_unindexed = 0,
+    pdf_resource_pending,
+    pdf_resource_hashed
+} pdf_resource_hash_state_t;
+
+struct pdf_resource_index_s {
+    bool stale;                 /* pointers invalid, rebuild from the chains */
+    pdf_resource_t **pending;   /* resources not hashed yet */
+    uint num_pending;
+    uint max_pending;
+    pdf_resource_t **table;     /* hashed resources, open addressing on hash_key */
+    uint table_size;            /* a power of 2, or 0 */
+    uint count;
+    /* Statistics for PrintStatistics */
+    long searches;
+    long matches;
+    long compared;
+};
+
+#define PDF_RESOURCE_INDEX_MEM(pdev) ((pdev)->pdf_memory->non_gc_memory)
+
+/* Get the hash key of a Cos object, if its hashes are valid. */
+static bool
+pdf_resource_object_key(const cos_object_t *pco, uint *pkey)
+{
+    const byte *h = pco->hash;
+    uint key;
+
+    if (!pco->md5_valid)
+        return false;
+    key = h[0] | (h[1] << 8) | (h[2] << 16) | ((uint)h[3] << 24);
+    if (cos_type(pco) == cos_type_stream) {
+        h = pco->stream_hash;
+        if (!pco->stream_md5_valid)
+            return false;
+        key ^= h[0] | (h[1] << 8) | (h[2] << 16) | ((uint)h[3] << 24);
+    } else if (cos_type(pco) != cos_type_dict && cos_type(pco) != cos_type_array)
+        return false;
+    *pkey = key;
+    return true;
+}
+
+/* Note that an object in the index has changed, see cos_object_changed. */
+void
+pdf_resource_index_changed(pdf_resource_index_t *pri)
+{
+    pri->stale = true;
+}
+
+/* Take a resource out of the index. */
+static void
+pdf_resource_unindex(pdf_resource_t *pres)
+{
+    if (pres->object != NULL)
+        pres->object->hash_index = NULL;
+    pres->hash_state = pdf_resource_unindexed;
+}
+
+static int
+pdf_resource_index_add_pending(gx_device_pdf *pdev, pdf_resource_index_t *pri,
+                               pdf_resource_t *pres)
+{
+    if (pri->num_pending == pri->max_pending) {
+        uint max = (pri->max_pending ? pri->max_pending * 2 : 16);
+        pdf_resource_t **pending = (pdf_resource_t **)
+            gs_alloc_byte_array(PDF_RESOURCE_INDEX_MEM(pdev), max, sizeof(pdf_resource_t *),
+                                "pdf_resource_index_add_pending");
+
+        if (pending == NULL)
+            return_error(gs_error_VMerror);
+        if (pri->num_pending)
+            memcpy(pending, pri->pending, pri->num_pending * sizeof(pdf_resource_t *));
+        gs_free_object(PDF_RESOURCE_INDEX_MEM(pdev), pri->pending, "pdf_resource_index_add_pending");
+        pri->pending = pending;
+        pri->max_pending = max;
+    }
+    pri->pending[pri->num_pending++] = pres;
+    pres->hash_state = pdf_resource_pending;
+    return 0;
+}
+
+static void
+pdf_resource_index_remove_pending(pdf_resource_index_t *pri, pdf_resource_t *pres)
+{
+    uint i;
+
+    for (i = 0; i < pri->num_pending; i++)
+        if (pri->pending[i] == pres) {
+            pri->pending[i] = pri->pending[--pri->num_pending];
+            break;
+        }
+    pdf_resource_unindex(pres);
+}
+
+static void
+pdf_resource_index_place(pdf_resource_index_t *pri, pdf_resource_t *pres)
+{
+    uint mask = pri->table_size - 1;
+    uint i = pres->hash_key & mask;
+
+    while (pri->table[i] != NULL)
+        i = (i + 1) & mask;
+    pri->table[i] = pres;
+}
+
+static int
+pdf_resource_index_insert(gx_device_pdf *pdev, pdf_resource_index_t *pri,
+                          pdf_resource_t *pres, uint key)
+{
+    if ((pri->count + 1) * 2 > pri->table_size) {
+        uint size = (pri->table_size ? pri->table_size * 2 : 64), i;
+        pdf_resource_t **old = pri->table;
+        uint old_size = pri->table_size;
+        pdf_resource_t **table = (pdf_resource_t **)
+            gs_alloc_byte_array(PDF_RESOURCE_INDEX_MEM(pdev), size, sizeof(pdf_resource_t *),
+                                "pdf_resource_index_insert");
+
+        if (table == NULL)
+            return_error(gs_error_VMerror);
+        memset(table, 0x00, size * sizeof(pdf_resource_t *));
+        pri->table = table;
+        pri->table_size = size;
+        for (i = 0; i < old_size; i++)
+            if (old[i] != NULL)
+                pdf_resource_index_place(pri, old[i]);
+        gs_free_object(PDF_RESOURCE_INDEX_MEM(pdev), old, "pdf_resource_index_insert");
+    }
+    pres->hash_key = key;
+    pres->hash_state = pdf_resource_hashed;
+    if (pres->object != NULL)
+        pres->object->hash_index = pri;
+    pdf_resource_index_place(pri, pres);
+    pri->count++;
+    return 0;
+}
+
+static void
+pdf_resource_index_unhash(pdf_resource_index_t *pri, pdf_resource_t *pres)
+{
+    uint mask = pri->table_size - 1;
+    uint i = pres->hash_key & mask, j, k;
+
+    while (pri->table[i] != pres) {
+        if (pri->table[i] == NULL)
+            return;
+        i = (i + 1) & mask;
+    }
+    /* Shift back any later entries of the probe sequence into the gap. */
+    for (j = i;;) {
+        j = (j + 1) & mask;
+        if (pri->table[j] == NULL)
+            break;
+        k = pri->table[j]->hash_key & mask;
+        if ((i <= j ? (i < k && k <= j) : (i < k || k <= j)))
+            continue;
+        pri->table[i] = pri->table[j];
+        i = j;
+    }
+    pri->table[i] = NULL;
+    pri->count--;
+    pdf_resource_unindex(pres);
+}
+
+/*
+ * Update the index after a resource's object has been hashed. Only the
+ * subject of a search is moved into the table: other resources may still
+ * be under construction, so they stay pending (and are compared on every
+ * search, as before) until they are looked up themselves.
+ */
+static int
+pdf_resource_index_update(gx_device_pdf *pdev, pdf_resource_index_t *pri,
+                          pdf_resource_t *pres, bool searched)
+{
+    uint key;
+
+    /* Only resources in the chains are indexed. */
+    if (pres->hash_state == pdf_resource_unindexed)
+        return 0;
+    if (pres->object == NULL || !pdf_resource_object_key(pres->object, &key))
+        key = 0, searched = false;
+    if (pres->hash_state == pdf_resource_hashed) {
+        if (pres->hash_key == key)
+            return 0;
+        /* The object has changed since it was hashed. */
+        pdf_resource_index_unhash(pri, pres);
+        if (!searched)
+            return pdf_resource_index_add_pending(pdev, pri, pres);
+    } else if (!searched)
+        return 0;
+    else
+        pdf_resource_index_remove_pending(pri, pres);
+    return pdf_resource_index_insert(pdev, pri, pres, key);
+}
+
+/* Get the index for a resource type, (re)building it if necessary. */
+static pdf_resource_index_t *
+pdf_get_resource_index(gx_device_pdf *pdev, pdf_resource_type_t rtype)
+{
+    pdf_resource_index_t *pri = pdev->resources[rtype].index;
+    pdf_resource_t *pres;
+    int64_t seq;
+    uint key;
+    int i, code = 0;
+
+    if (pri != NULL && !pri->stale)
+        return pri;
+    if (pri == NULL) {
+        pri = (pdf_resource_index_t *)gs_alloc_bytes(PDF_RESOURCE_INDEX_MEM(pdev),
+                        sizeof(pdf_resource_index_t), "pdf_get_resource_index");
+        if (pri == NULL)
+            return NULL;
+        memset(pri, 0x00, sizeof(pdf_resource_index_t));
+        pdev->resources[rtype].index = pri;
+    }
+    pri->num_pending = 0;
+    pri->count = 0;
+    if (pri->table_size)
+        memset(pri->table, 0x00, pri->table_size * sizeof(pdf_resource_t *));
+    /* Renumber the chains in order; new resources go at the front, so
+     * they get sequence numbers below all of these. */
+    seq = pdev->resource_chain_seq;
+    for (i = 0; i < NUM_RESOURCE_CHAINS && code >= 0; i++) {
+        for (pres = pdev->resources[rtype].chains[i]; pres != 0 && code >= 0; pres = pres->next) {
+            pres->chain_index = i;
+            pres->chain_seq = ++seq;
+            if (pres->hash_state == pdf_resource_hashed && pres->object != NULL &&
+                pdf_resource_object_key(pres->object, &key) && key == pres->hash_key)
+                code = pdf_resource_index_insert(pdev, pri, pres, key);
+            else {
+                /* Not hashed yet, or its object has changed since. */
+                pdf_resource_unindex(pres);
+                code = pdf_resource_index_add_pending(pdev, pri, pres);
+            }
+        }
+    }
+    if (code < 0) {
+        pri->stale = true;
+        return NULL;
+    }
+    pri->stale = false;
+    return pri;
+}
+
+/* Note a new resource at the front of a chain. */
+static void
+pdf_resource_index_add(gx_device_pdf *pdev, pdf_resource_t **plist, pdf_resource_t *pres)
+{
+    int i;
+
+    pres->chain_seq = --pdev->resource_chain_seq;
+    pres->chain_index = 0;
+    pres->hash_state = pdf_resource_unindexed;
+    for (i = 0; i < NUM_RESOURCE_TYPES; i++) {
+        pdf_resource_list_t *prl = &pdev->resources[i];
+
+        if (plist >= prl->chains && plist < prl->chains + NUM_RESOURCE_CHAINS) {
+            pres->chain_index = plist - prl->chains;
+            if (prl->index != NULL && !prl->index->stale &&
+                pdf_resource_index_add_pending(pdev, prl->index, pres) < 0)
+                prl->index->stale = true;
+            break;
+        }
+    }
+}
+
+/*
+ * Remove a resource which is being taken out of its chain, from the index
+ * and, for an image, from the table of image hashes.
+ */
+static void
+pdf_resource_index_remove(gx_device_pdf *pdev, pdf_resource_type_t rtype, pdf_resource_t *pres)
+{
+    pdf_resource_index_t *pri = pdev->resources[rtype].index;
+
+    if (rtype == resourceXObject)
+        pdf_forget_image_hash(pdev, pres);
+    if (pri == NULL || pri->stale)
+        pdf_resource_unindex(pres);
+    else if (pres->hash_state == pdf_resource_hashed)
+        pdf_resource_index_unhash(pri, pres);
+    else if (pres->hash_state == pdf_resource_pending)
+        pdf_resource_index_remove_pending(pri, pres);
+}
+
+void
+pdf_invalidate_resource_indices(gx_device_pdf * pdev)
+{
+    int i;
+
+    for (i = 0; i < NUM_RESOURCE_TYPES; i++)
+        if (pdev->resources[i].index != NULL)
+            pdev->resources[i].index->stale = true;
+}
+
+void
+pdf_free_resource_indices(gx_device_pdf * pdev)
+{
+    int i;
+
+    for (i = 0; i < NUM_RESOURCE_TYPES; i++) {
+        pdf_resource_index_t *pri = pdev->resources[i].index;
+
+        if (pri != NULL) {
+            gs_free_object(PDF_RESOURCE_INDEX_MEM(pdev), pri->pending, "pdf_free_resource_indices");
+            gs_free_object(PDF_RESOURCE_INDEX_MEM(pdev), pri->table, "pdf_free_resource_indices");
+            gs_free_object(PDF_RESOURCE_INDEX_MEM(pdev), pri, "pdf_free_resource_indices");
+            pdev->resources[i].index = NULL;
+        }
+    }
+}
+
+#define PDF_RESOURCE_BEFORE(a, b)\
+  ((a)->chain_index < (b)->chain_index ||\
+   ((a)->chain_index == (b)->chain_index && (a)->chain_seq < (b)->chain_seq))
+
 /* ------ Resources et al ------ */
 
 /* Define the allocator descriptors for the resource types. */
@@ -1295,6 +1788,7 @@ pdf_forget_resource(gx_device_pdf * pdev, pdf_resource_t *pres1, pdf_resource_ty
         for (; (pres = *pprev) != 0; pprev = &pres->next)
             if (pres == pres1) {
                 *pprev = pres->next;
+                pdf_resource_index_remove(pdev, rtype, pres);
                 if (pres->object) {
                     COS_RELEASE(pres->object, "pdf_forget_resource");
                     gs_free_object(pdev->pdf_memory, pres->object, "pdf_forget_resource");
@@ -1365,6 +1859,7 @@ pdf_find_resource_by_gs_id(gx_device_pdf * pdev, pdf_resource_type_t rtype,
                 *pprev = pres->next;
                 pres->next = *pchain;
                 *pchain = pres;
+                pres->chain_seq = --pdev->resource_chain_seq;
             }
             return pres;
         }
@@ -1388,9 +1883,9 @@ pdf_find_resource_by_resource_id(gx_device_pdf * pdev, pdf_resource_type_t rtype
     return 0;
 }
 
-/* Find same resource. */
-int
-pdf_find_same_resource(gx_device_pdf * pdev, pdf_resource_type_t rtype, pdf_resource_t **ppres,
+/* Find same resource, by comparing with every resource of the type. */
+static int
+pdf_find_same_resource_linear(gx_device_pdf * pdev, pdf_resource_type_t rtype, pdf_resource_t **ppres,
         int (*eq)(gx_device_pdf * pdev, pdf_resource_t *pres0, pdf_resource_t *pres1))
 {
     pdf_resource_t **pchain = pdev->resources[rtype].chains;
@@ -1424,6 +1919,120 @@ pdf_find_same_resource(gx_device_pdf * pdev, pdf_resource_type_t rtype, pdf_reso
     return 0;
 }
 
+/* Find same resource, using the hash index where possible. */
+int
+pdf_find_same_resource(gx_device_pdf * pdev, pdf_resource_type_t rtype, pdf_resource_t **ppres,
+        int (*eq)(gx_device_pdf * pdev, pdf_resource_t *pres0, pdf_resource_t *pres1))
+{
+    pdf_resource_t *pres0 = *ppres;
+    cos_object_t *pco0 = pres0->object;
+    pdf_resource_index_t *pri;
+    pdf_resource_t *local[16], **cand = local, *pres;
+    uint key, mask, n = 0, max = countof(local), i, j;
+    int code = 0, found = 0;
+
+    if (pco0 == NULL || (cos_type(pco0) != cos_type_dict &&
+                         cos_type(pco0) != cos_type_array && cos_type(pco0) != cos_type_stream))
+        return pdf_find_same_resource_linear(pdev, rtype, ppres, eq);
+    pri = pdf_get_resource_index(pdev, rtype);
+    if (pri == NULL)
+        return pdf_find_same_resource_linear(pdev, rtype, ppres, eq);
+    if (pri->count + pri->num_pending <= (pres0->hash_state != pdf_resource_unindexed ? 1 : 0))
+        return 0;	/* nothing to compare with */
+
+    /* Make sure the new object is hashed, exactly as comparing it would. */
+    code = pco0->cos_procs->equal(pco0, pco0, pdev);
+    if (code < 0 || !pdf_resource_object_key(pco0, &key))
+        return pdf_find_same_resource_linear(pdev, rtype, ppres, eq);
+    if (pdf_resource_index_update(pdev, pri, pres0, true) < 0) {
+        pri->stale = true;
+        return pdf_find_same_resource_linear(pdev, rtype, ppres, eq);
+    }
+    pri->searches++;
+
+    /* Collect the resources with the same key, and the unhashed ones. */
+    mask = pri->table_size - 1;
+    for (i = key & mask; pri->table_size != 0; i = (i + 1) & mask) {
+        pres = pri->table[i];
+        if (pres == NULL)
+            break;
+        if (pres->hash_key != key || pres == pres0 || pres->object == NULL ||
+            cos_type(pres->object) != cos_type(pco0))
+            continue;
+        if (n == max) {
+            code = gs_note_error(gs_error_VMerror);
+            break;
+        }
+        cand[n++] = pres;
+    }
+    for (j = 0; j < pri->num_pending && code >= 0; j++) {
+        pres = pri->pending[j];
+        if (pres == pres0 || pres->object == NULL || cos_type(pres->object) != cos_type(pco0))
+            continue;
+        if (n == max) {
+            code = gs_note_error(gs_error_VMerror);
+            break;
+        }
+        cand[n++] = pres;
+    }
+    if (code < 0) {
+        /* Too many to fit in 'local', count them all and allocate. */
+        n = max;
+        for (i = key & mask; pri->table_size != 0 && pri->table[i] != NULL; i = (i + 1) & mask)
+            n++;
+        n += pri->num_pending;
+        cand = (pdf_resource_t **)gs_alloc_byte_array(PDF_RESOURCE_INDEX_MEM(pdev), n,
+                    sizeof(pdf_resource_t *), "pdf_find_same_resource");
+        if (cand == NULL)
+            return pdf_find_same_resource_linear(pdev, rtype, ppres, eq);
+        max = n;
+        n = 0;
+        for (i = key & mask; pri->table_size != 0 && (pres = pri->table[i]) != NULL; i = (i + 1) & mask)
+            if (pres->hash_key == key && pres != pres0 && pres->object != NULL &&
+                cos_type(pres->object) == cos_type(pco0))
+                cand[n++] = pres;
+        for (j = 0; j < pri->num_pending; j++) {
+            pres = pri->pending[j];
+            if (pres != pres0 && pres->object != NULL && cos_type(pres->object) == cos_type(pco0))
+                cand[n++] = pres;
+        }
+    }
+
+    /* Sort the candidates into chain order, there are usually very few. */
+    for (i = 1; i < n; i++) {
+        pres = cand[i];
+        for (j = i; j > 0 && PDF_RESOURCE_BEFORE(pres, cand[j - 1]); j--)
+            cand[j] = cand[j - 1];
+        cand[j] = pres;
+    }
+
+    code = 0;
+    for (i = 0; i < n; i++) {
+        pres = cand[i];
+        code = pco0->cos_procs->equal(pco0, pres->object, pdev);
+        pri->compared++;
+        if (code < 0)
+            break;
+        /* Comparing it may have (re)computed its hash. */
+        if (pdf_resource_index_update(pdev, pri, pres, false) < 0)
+            pri->stale = true;
+        if (code > 0) {
+            code = eq(pdev, pres0, pres);
+            if (code < 0)
+                break;
+            if (code > 0) {
+                *ppres = pres;
+                pri->matches++;
+                found = 1;
+                break;
+            }
+        }
+    }
+    if (cand != local)
+        gs_free_object(PDF_RESOURCE_INDEX_MEM(pdev), cand, "pdf_find_same_resource");
+    return (code < 0 ? code : found);
+}
+
 void
 pdf_drop_resource_from_chain(gx_device_pdf * pdev, pdf_resource_t *pres1, pdf_resource_type_t rtype)
 {
@@ -1458,6 +2067,7 @@ pdf_drop_resource_from_chain(gx_device_pdf * pdev, pdf_resource_t *pres1, pdf_re
         for (; (pres = *pprev) != 0; pprev = &pres->next)
             if (pres == pres1) {
                 *pprev = pres->next;
+                pdf_resource_index_remove(pdev, rtype, pres);
 #if 0
                 if (pres->object) {
                     COS_RELEASE(pres->object, "pdf_forget_resource");
@@ -1486,6 +2096,7 @@ pdf_drop_resources(gx_device_pdf * pdev, pdf_resource_type_t rtype,
         for (; (pres = *pprev) != 0; ) {
             if (cond(pdev, pres)) {
                 *pprev = pres->next;
+                pdf_resource_index_remove(pdev, rtype, pres);
                 pres->next = pres; /* A temporary mark - see below */
             } else
                 pprev = &pres->next;
@@ -1523,6 +2134,12 @@ pdf_print_resource_statistics(gx_device_pdf * pdev)
         }
         dmprintf3(pdev->pdf_memory, "Resource type %d (%s) has %d instances.\n", rtype,
                 (name ? name : ""), n);
+        if (pdev->resources[rtype].index != NULL) {
+            pdf_resource_index_t *pri = pdev->resources[rtype].index;
+
+            dmprintf3(pdev->pdf_memory, "  %ld searches for the same resource found %ld, %ld comparisons.\n",
+                      pri->searches, pri->matches, pri->compared);
+        }
     }
 }
 
@@ -1579,6 +2196,7 @@ pdf_alloc_aside(gx_device_pdf * pdev, pdf_resource_t ** plist,
     pres->next = *plist;
     pres->rid = 0;
     *plist = pres;
+    pdf_resource_index_add(pdev, plist, pres);
     pres->prev = pdev->last_resource;
     pdev->last_resource = pres;
     pres->named = false;
@@ -1681,7 +2299,12 @@ pdf_resource_id(const pdf_resource_t *pres)
 int
 pdf_end_separate(gx_device_pdf * pdev, pdf_resource_type_t type)
 {
-    int code = pdf_end_obj(pdev, type);
+    int code;
+
+    /* Opened by pdf_open_compressible_separate into an object stream. */
+    if (pdev->ObjStm.strm != NULL && pdev->strm == pdev->ObjStm.strm)
+        return pdf_end_obj(pdev, type);
+    code = pdf_end_obj(pdev, type);
 
     pdev->strm = pdev->asides.save_strm;
     pdev->asides.save_strm = 0;
@@ -1746,6 +2369,8 @@ pdf_reverse_resource_chain(gx_device_pdf *pdev, pdf_resource_type_t rtype)
     }
     pres0->next = NULL;
     pdev->resources[rtype].chains[0] = pres;
+    if (pdev->resources[rtype].index != NULL)
+        pdev->resources[rtype].index->stale = true;
 }
 
 /*
@@ -1770,6 +2395,7 @@ pdf_free_resource_objects(gx_device_pdf *pdev, pdf_resource_type_t rtype)
                     pres->object = 0;
                 }
                 *prev = pres->next;
+                pdf_resource_index_remove(pdev, rtype, pres);
             }
         }
     }
@@ -1804,7 +2430,7 @@ pdf_store_page_resources(gx_device_pdf *pdev, pdf_page_t *page, bool clear_usage
                     if (id == -1L)
                         continue;
                     if (s == 0) {
-                        page->resource_ids[i] = pdf_begin_separate(pdev, i);
+                        page->resource_ids[i] = pdf_open_compressible_separate(pdev, 0L, i);
                         pdf_record_usage(pdev, page->resource_ids[i], pdev->next_page);
                         s = pdev->strm;
                         stream_puts(s, "<<");
@@ -2366,14 +2992,19 @@ pdf_put_filters(cos_dict_t *pcd, gx_device_pdf *pdev, stream *s,
 {
     const char *filter_name = 0;
     bool binary_ok = true;
-    stream *fs = s;
+    stream *fs = s, *next;
     cos_dict_t *decode_parms = 0;
     int code;
 
-    for (; fs != 0; fs = fs->strm) {
+    for (; fs != 0; fs = next) {
         const stream_state *st = fs->state;
         const stream_template *templat = st->templat;
 
+        /* Look through to the filters run by an image thread. */
+        next = psdf_image_thread_filters(fs);
+        if (next == 0)
+            next = fs->strm;
+
 #define TEMPLATE_IS(atemp)\
   (templat->process == (atemp).process)
         if (TEMPLATE_IS(s_A85E_template))
@@ -2733,7 +3364,7 @@ pdf_function(gx_device_pdf *pdev, const gs_function_t *pfn, cos_value_t *pvalue)
     if (code < 0)
         return code;
     if (pres->object->md5_valid)
-        pres->object->md5_valid = 0;
+        cos_object_changed(pres->object);
 
     code = pdf_substitute_resource(pdev, &pres, resourceFunction, functions_equal, false);
     if (code < 0)
@@ -63,9 +63,15 @@
 /* Define the maximum size of a destination array string. */
 #define MAX_DEST_STRING 80
 
+/* Define the maximum number of objects written into one object stream. */
+#define MAX_OBJSTM_OBJECTS 100
+
 /* ================ Types and structures ================ */
 
 typedef struct pdf_base_font_s pdf_base_font_t;
+typedef struct pdf_font_compress_job_s pdf_font_compress_job_t;	/* gdevpdtb.c */
+typedef struct pdf_font_compression_s pdf_font_compression_t;	/* gdevpdtb.c */
+typedef struct pdf_image_hashes_s pdf_image_hashes_t;	/* gdevpdfj.c */
 
 /* Define the possible contexts for the output stream. */
 typedef enum {
@@ -195,6 +201,10 @@ typedef enum {
     bool global;                /* ps2write only */\
     char rname[1/*R*/ + (sizeof(long) * 8 / 3 + 1) + 1/*\0*/];\
     ulong where_used;                /* 1 bit per level of content stream */\
+    int64_t chain_seq;                /* order within its chain, see gdevpdfu.c */\
+    uint hash_key;                /* equality hash key, if hash_state is hashed */\
+    byte chain_index;                /* which of the chains holds it */\
+    byte hash_state;                /* see pdf_resource_hash_state_t in gdevpdfu.c */\
     cos_object_t *object
 typedef struct pdf_resource_s pdf_resource_t;
 struct pdf_resource_s {
@@ -216,6 +226,8 @@ struct pdf_x_object_s {
     pdf_resource_common(pdf_x_object_t);
     int width, height;                /* specified width and height for images */
     int data_height;                /* actual data height for images */
+    bool samples_hashed;            /* samples_hash is valid, see pdf_end_write_image */
+    byte samples_hash[16];
 };
 #define private_st_pdf_x_object()  /* in gdevpdfu.c */\
   gs_private_st_suffix_add0(st_pdf_x_object, pdf_x_object_t,\
@@ -283,8 +295,12 @@ struct pdf_article_s {
  * long lists.
  */
 #define NUM_RESOURCE_CHAINS 16
+typedef struct pdf_resource_index_s pdf_resource_index_t;
 typedef struct pdf_resource_list_s {
     pdf_resource_t *chains[NUM_RESOURCE_CHAINS];
+    /* Resources indexed by the hash of their Cos object, to speed up
+     * pdf_find_same_resource. Not garbage collected, see gdevpdfu.c. */
+    pdf_resource_index_t *index;
 } pdf_resource_list_t;
 
 /* Define the hash function for gs_ids. */
@@ -354,6 +370,16 @@ typedef struct pdf_temp_file_s {
     stream *save_strm;                /* save pdev->strm while writing here */
 } pdf_temp_file_t;
 
+/*
+ * With StreamPages the asides file is copied to the output at the end of
+ * each page. Each piece copied is recorded so that positions in the asides
+ * data can still be mapped to positions in the output.
+ */
+typedef struct pdf_asides_piece_s {
+    gs_offset_t asides_pos;           /* position in the asides data */
+    gs_offset_t file_pos;             /* position in the output file */
+} pdf_asides_piece_t;
+
 typedef struct gx_device_pdf_s gx_device_pdf;
 
 /* Structures and definitions for linearisation */
@@ -724,6 +750,7 @@ struct gx_device_pdf_s {
     int num_pages;
     ulong used_mask;                /* for where_used: page level = 1 */
     pdf_resource_list_t resources[NUM_RESOURCE_TYPES];
+    int64_t resource_chain_seq;     /* last chain_seq assigned to a resource */
     /* cs_Patterns[0] is colored; 1,3,4 are uncolored + Gray,RGB,CMYK */
     pdf_resource_t *cs_Patterns[5];
     pdf_resource_t *Identity_ToUnicode_CMaps[2]; /* WMode = 0,1 */
@@ -959,6 +986,40 @@ struct gx_device_pdf_s {
     bool OmitID;                    /* If true, do not emit a /ID array in the trailer dicionary (must not be true for encrypted files or PDF 2.0) */
     bool ModifiesPageSize;          /* If true, the new PDF interpreter will not preserve *Box values (the media size has been modified, they will be incorrect) */
     bool ModifiesPageOrder;         /* If true, the new PDF interpreter will not preserve Outlines or Dests, because they will refer to the wrong page number */
+    bool WriteObjStms;              /* If true, write non-stream objects into compressed object streams (requires WriteXRefStm) */
+    bool WriteXRefStm;              /* If true, write a cross-reference stream instead of an xref table and trailer */
+    bool ThreadedImageCompression;  /* If true, downsample and compress image data on worker threads */
+    bool StreamPages;               /* If true, copy the resources written for each page to the output when the page is complete */
+    int FontCompressionThreads;     /* If > 0, the number of worker threads compressing embedded fonts */
+    bool OptimizeContentStreams;    /* If true, remove redundant operators from the page contents */
+    /*
+     * Members below here are not parameters. The offsets of parameters
+     * are stored as shorts in pdf_param_items, so they must all come
+     * before these large members.
+     *
+     * ObjStm holds the bodies of the objects collected for the current
+     * object stream (WriteObjStms), and at the end of the document the
+     * compressed cross-reference stream data (WriteXRefStm). It is only
+     * opened when WriteXRefStm is true.
+     */
+    pdf_temp_file_t ObjStm;
+    long ObjStm_id;                 /* id of the current object stream, 0 if none */
+    int NumObjStmObjects;
+    long ObjStmIds[MAX_OBJSTM_OBJECTS];
+    gs_offset_t ObjStmOffsets[MAX_OBJSTM_OBJECTS];
+    /*
+     * With StreamPages, asides_flushed is the amount of asides data already
+     * copied to the output; the asides file is then reused from the start.
+     * asides_map (in non-gc memory) records where each piece was copied.
+     */
+    gs_offset_t asides_flushed;
+    pdf_asides_piece_t *asides_map;
+    int asides_map_count;
+    int asides_map_size;
+    /* Worker threads for FontCompressionThreads (non-gc), or NULL. */
+    pdf_font_compression_t *font_compression;
+    /* Images by the hash of their samples (non-gc), or NULL. */
+    pdf_image_hashes_t *image_hashes;
 };
 
 #define is_in_page(pdev)\
@@ -992,8 +1053,10 @@ struct gx_device_pdf_s {
  m(38, outline_levels)
  m(39, gx_device_pdf, EmbeddedFiles);
  m(40, gx_device_pdf, pdf_font_dir);
- m(41, gx_device_pdf, Extension_Metadata);*/
-#define gx_device_pdf_num_ptrs 43
+ m(41, gx_device_pdf, Extension_Metadata);
+ m(42, gx_device_pdf, PassThroughWriter);
+ m(43,ObjStm.strm) m(44,ObjStm.strm_buf) m(45,ObjStm.save_strm)*/
+#define gx_device_pdf_num_ptrs 46
 #define gx_device_pdf_do_param_strings(m)\
     m(0, OwnerPassword) m(1, UserPassword) m(2, NoEncrypt)\
     m(3, DocumentUUID) m(4, InstanceUUID)
@@ -1096,6 +1159,13 @@ int pdf_open_contents(gx_device_pdf * pdev, pdf_context_t context);
 /* Close the current contents part if we are in one. */
 int pdf_close_contents(gx_device_pdf * pdev, bool last);
 
+/* Content stream optimiser, in gdevpdfs.c. */
+int pdf_begin_content_optimizer(gx_device_pdf *pdev);
+/* Write past the optimiser until pdev->strm is restored; 1 if bypassed. */
+int pdf_bypass_content_optimizer(gx_device_pdf *pdev);
+/* Flush the optimiser; return 1 if pdev->strm is the optimiser. */
+int pdf_end_content_optimizer(gx_device_pdf *pdev);
+
 /* ------ Resources et al ------ */
 
 extern const char *const pdf_resource_type_names[];
@@ -1112,6 +1182,28 @@ int pdf_record_usage_by_parent(gx_device_pdf *const pdev, long resource_id, long
  */
 #define ASIDES_BASE_POSITION min_int64_t
 
+/*
+ * Define the offset that indicates that an object has been written into
+ * an object stream. The id of the object stream and the index of the
+ * object within it are stored in the low bits.
+ */
+#define OBJSTM_BASE_POSITION ((gs_offset_t)1 << 62)
+#define OBJSTM_POSITION(stm_id, index)\
+  (OBJSTM_BASE_POSITION + ((gs_offset_t)(stm_id) << 16) + (index))
+
+/*
+ * Begin an object which may be written into an object stream. If object
+ * streams are not being written, or the object can't be placed in one
+ * here, these are the same as pdf_open_obj and pdf_open_separate. The
+ * object must not be a stream, and is ended with pdf_end_obj or
+ * pdf_end_separate as usual.
+ */
+long pdf_open_compressible_obj(gx_device_pdf * pdev, long id, pdf_resource_type_t type);
+long pdf_open_compressible_separate(gx_device_pdf * pdev, long id, pdf_resource_type_t type);
+
+/* Write out the current object stream, if any. */
+int pdf_flush_ObjStm(gx_device_pdf * pdev);
+
 /* Begin an object logically separate from the contents. */
 /* (I.e., an object in the resource file.) */
 long pdf_open_separate(gx_device_pdf * pdev, long id, pdf_resource_type_t type);
@@ -1168,6 +1260,12 @@ void pdf_drop_resources(gx_device_pdf * pdev, pdf_resource_type_t rtype,
 /* Print resource statistics. */
 void pdf_print_resource_statistics(gx_device_pdf * pdev);
 
+/* Free the resource hash indices, or mark them for rebuilding. */
+void pdf_free_resource_indices(gx_device_pdf * pdev);
+void pdf_invalidate_resource_indices(gx_device_pdf * pdev);
+/* Note that a Cos object in a resource hash index has changed. */
+void pdf_resource_index_changed(pdf_resource_index_t *pri);
+
 /* Cancel a resource (do not write it into PDF). */
 int pdf_cancel_resource(gx_device_pdf * pdev, pdf_resource_t *pres,
         pdf_resource_type_t rtype);
@@ -31,6 +31,9 @@
 #include "gdevpdtf.h"
 #include "gdevpdtd.h"
 #include "smd5.h"
+#include "strimpl.h"
+#include "szlibx.h"
+#include "gxsync.h"
 #include "gxfcache.h"   /* for gs_purge_font_from_char_caches_completely */
 /*
  * Adobe's Distiller Parameters documentation for Acrobat Distiller 5
@@ -183,6 +186,310 @@ pdf_add_subset_prefix(const gx_device_pdf *pdev, gs_string *pstr, byte *used, in
     return 0;
 }
 
+/* ---------------- Threaded FontFile compression ---------------- */
+
+/*
+ * With FontCompressionThreads > 0, pdf_write_embedded_font writes the font
+ * program into a buffer rather than through the Flate filter, and a pool
+ * of worker threads compresses the buffers while the following fonts are
+ * written. pdf_finish_embedded_font then adds the compressed data to the
+ * FontFile stream, in place of what the filter would have written. This
+ * must be done before the data is used, and in particular before the
+ * subset prefixes are computed, since they depend on its MD5 hash.
+ *
+ * The buffers, the jobs and the zlib state are allocated from the thread
+ * safe allocator, so the workers never touch garbage collected memory.
+ * Each worker has its own queue, filled in turn, since a gx_semaphore_t
+ * may only have one thread waiting on it.
+ */
+#define FONT_COMPRESSION_MAX_THREADS 16
+#define FONT_CAPTURE_BUF_SIZE 4096
+
+struct pdf_font_compress_job_s {
+    pdf_font_compress_job_t *next;	/* next in the queue */
+    pdf_font_compress_job_t *link;	/* next of all the jobs */
+    byte *data;				/* font program, then compressed */
+    uint size;
+    uint alloc;
+    int status;
+    gx_semaphore_t *done;
+};
+
+typedef struct pdf_font_compress_worker_s {
+    pdf_font_compression_t *fc;
+    gx_semaphore_t *queued;		/* counts the jobs in the queue */
+    pdf_font_compress_job_t *head;	/* queue, protected by fc->lock */
+    pdf_font_compress_job_t *tail;
+    gp_thread_id thread;
+} pdf_font_compress_worker_t;
+
+struct pdf_font_compression_s {
+    gs_memory_t *memory;		/* thread safe */
+    gx_monitor_t *lock;
+    pdf_font_compress_job_t *jobs;	/* all jobs, for freeing */
+    int num_threads;
+    int next;				/* worker for the next job */
+    pdf_font_compress_worker_t workers[FONT_COMPRESSION_MAX_THREADS];
+};
+
+typedef struct stream_font_capture_state_s {
+    stream_state_common;
+    pdf_font_compress_job_t *job;
+} stream_font_capture_state;
+
+/* The job is in non-garbage-collected memory, so don't trace it. */
+gs_private_st_simple(st_font_capture_state, stream_font_capture_state,
+                     "stream_font_capture_state");
+
+/* Append the font program to the job's buffer. */
+static int
+s_font_capture_process(stream_state *st, stream_cursor_read *pr,
+                       stream_cursor_write *ignore_pw, bool last)
+{
+    pdf_font_compress_job_t *job = ((stream_font_capture_state *)st)->job;
+    uint count = pr->limit - pr->ptr;
+
+    if (count > job->alloc - job->size) {
+        uint alloc = max(job->alloc, FONT_CAPTURE_BUF_SIZE);
+        byte *data;
+
+        while (alloc - job->size < count) {
+            if (alloc > max_uint / 2)
+                return ERRC;
+            alloc *= 2;
+        }
+        data = gs_alloc_bytes(st->memory, alloc, "font compression(data)");
+        if (data == NULL)
+            return ERRC;
+        if (job->size > 0)
+            memcpy(data, job->data, job->size);
+        gs_free_object(st->memory, job->data, "font compression(data)");
+        job->data = data;
+        job->alloc = alloc;
+    }
+    memcpy(job->data + job->size, pr->ptr + 1, count);
+    job->size += count;
+    pr->ptr = pr->limit;
+    return 0;
+}
+
+static const stream_procs s_font_capture_procs = {
+    s_std_noavailable, s_std_noseek, s_std_write_reset,
+    s_std_write_flush, s_std_close, s_font_capture_process
+};
+static const stream_template s_font_capture_template = {
+    &st_font_capture_state, 0, s_font_capture_process, 1, 1
+};
+
+/* Replace a job's data by its Flate compressed form. */
+static int
+font_compress_job_run(gs_memory_t *mem, pdf_font_compress_job_t *job)
+{
+    const stream_template *templat = &s_zlibE_template;
+    stream_state *st = s_alloc_state(mem, templat->stype,
+                                     "font compression(state)");
+    stream_cursor_read r;
+    stream_cursor_write w;
+    byte *out = NULL;
+    uint size = 0, alloc = job->size / 2 + FONT_CAPTURE_BUF_SIZE;
+    int status, code = 0;
+
+    if (st == NULL)
+        return_error(gs_error_VMerror);
+    if (templat->set_defaults)
+        templat->set_defaults(st);
+    st->templat = templat;
+    if (templat->init(st) < 0) {
+        gs_free_object(mem, st, "font compression(state)");
+        return_error(gs_error_VMerror);
+    }
+    r.ptr = job->data - 1;
+    r.limit = r.ptr + job->size;
+    do {
+        if (out == NULL || size == alloc) {
+            byte *data;
+
+            if (out != NULL) {
+                if (alloc > max_uint / 2) {
+                    code = gs_note_error(gs_error_limitcheck);
+                    break;
+                }
+                alloc *= 2;
+            }
+            data = gs_alloc_bytes(mem, alloc, "font compression(data)");
+            if (data == NULL) {
+                code = gs_note_error(gs_error_VMerror);
+                break;
+            }
+            if (size > 0)
+                memcpy(data, out, size);
+            gs_free_object(mem, out, "font compression(data)");
+            out = data;
+        }
+        w.ptr = out + size - 1;
+        w.limit = out + alloc - 1;
+        status = templat->process(st, &r, &w, true);
+        size = w.ptr + 1 - out;
+        if (status < 0)
+            code = gs_note_error(gs_error_ioerror);
+    } while (status > 0 && code >= 0);
+    templat->release(st);
+    gs_free_object(mem, st, "font compression(state)");
+    gs_free_object(mem, job->data, "font compression(data)");
+    job->data = out;
+    job->size = job->alloc = size;
+    return code;
+}
+
+static void
+font_compression_main(void *arg)
+{
+    pdf_font_compress_worker_t *w = (pdf_font_compress_worker_t *)arg;
+    pdf_font_compression_t *fc = w->fc;
+
+    for (;;) {
+        pdf_font_compress_job_t *job;
+
+        gx_semaphore_wait(w->queued);
+        gx_monitor_enter(fc->lock);
+        job = w->head;
+        if (job != NULL) {
+            w->head = job->next;
+            if (w->head == NULL)
+                w->tail = NULL;
+        }
+        gx_monitor_leave(fc->lock);
+        if (job == NULL)
+            break;		/* asked to exit */
+        job->status = font_compress_job_run(fc->memory, job);
+        gx_semaphore_signal(job->done);
+    }
+}
+
+/*
+ * Get the worker threads, starting them if necessary. Return NULL if the
+ * fonts should be compressed by the Flate filter as usual.
+ */
+static pdf_font_compression_t *
+pdf_font_compression(gx_device_pdf *pdev)
+{
+    pdf_font_compression_t *fc = pdev->font_compression;
+    gs_memory_t *mem = pdev->memory->thread_safe_memory;
+    int i, n = min(pdev->FontCompressionThreads, FONT_COMPRESSION_MAX_THREADS);
+
+    if (fc != NULL || n <= 0)
+        return fc;
+    /* zlib allocates from the stable memory. */
+    if (mem == NULL || mem->stable_memory != mem)
+        return NULL;
+    fc = (pdf_font_compression_t *)gs_alloc_bytes(mem, sizeof(*fc),
+                                                   "pdf_font_compression");
+    if (fc == NULL)
+        return NULL;
+    memset(fc, 0, sizeof(*fc));
+    fc->memory = mem;
+    fc->lock = gx_monitor_label(gx_monitor_alloc(mem), "font compression(lock)");
+    for (i = 0; i < n && fc->lock != NULL; i++) {
+        pdf_font_compress_worker_t *w = &fc->workers[i];
+
+        w->fc = fc;
+        w->queued = gx_semaphore_label(gx_semaphore_alloc(mem),
+                                       "font compression(queued)");
+        if (w->queued == NULL)
+            break;
+        if (gp_thread_start(font_compression_main, w, &w->thread) < 0) {
+            gx_semaphore_free(w->queued);
+            w->queued = NULL;
+            break;
+        }
+        gp_thread_label(w->thread, "font compression");
+        fc->num_threads++;
+    }
+    pdev->font_compression = fc;
+    if (fc->num_threads == 0) {
+        pdf_free_font_compression(pdev);
+        return NULL;
+    }
+    return fc;
+}
+
+/* Start capturing a font program for compression by a worker. */
+static int
+pdf_begin_font_capture(pdf_font_compression_t *fc, pdf_data_writer_t *pdw,
+                       pdf_font_compress_job_t **pjob)
+{
+    gs_memory_t *mem = fc->memory;
+    pdf_font_compress_job_t *job;
+    stream_font_capture_state *ss;
+    stream *s;
+    byte *buf;
+
+    job = (pdf_font_compress_job_t *)gs_alloc_bytes(mem, sizeof(*job),
+                                                    "font compression(job)");
+    if (job == NULL)
+        return_error(gs_error_VMerror);
+    memset(job, 0, sizeof(*job));
+    job->link = fc->jobs;
+    fc->jobs = job;
+    job->done = gx_semaphore_label(gx_semaphore_alloc(mem),
+                                   "font compression(done)");
+    s = s_alloc(mem, "font compression(capture)");
+    ss = (stream_font_capture_state *)
+        s_alloc_state(mem, &st_font_capture_state,
+                      "font compression(capture state)");
+    buf = gs_alloc_bytes(mem, FONT_CAPTURE_BUF_SIZE,
+                         "font compression(capture buf)");
+    if (job->done == NULL || s == NULL || ss == NULL || buf == NULL) {
+        gs_free_object(mem, buf, "font compression(capture buf)");
+        gs_free_object(mem, ss, "font compression(capture state)");
+        gs_free_object(mem, s, "font compression(capture)");
+        return_error(gs_error_VMerror);
+    }
+    ss->templat = &s_font_capture_template;
+    ss->job = job;
+    s_std_init(s, buf, FONT_CAPTURE_BUF_SIZE, &s_font_capture_procs,
+               s_mode_write);
+    s->state = (stream_state *)ss;
+    pdw->binary.strm = s;
+    *pjob = job;
+    return 0;
+}
+
+/*
+ * Finish capturing a font program, and queue it for compression unless
+ * code (the result of writing the font) is an error.
+ */
+static int
+pdf_end_font_capture(pdf_font_compression_t *fc, pdf_font_compress_job_t *job,
+                     stream *s, int code)
+{
+    gs_memory_t *mem = fc->memory;
+    pdf_font_compress_worker_t *w;
+    byte *buf = s->cbuf;
+    int status = sflush(s);
+
+    /* sclose frees the state. */
+    if (sclose(s) < 0)
+        status = ERRC;
+    if (status < 0 && code >= 0)
+        code = gs_note_error(gs_error_ioerror);
+    gs_free_object(mem, buf, "font compression(capture buf)");
+    gs_free_object(mem, s, "font compression(capture)");
+    if (code < 0)
+        return code;
+    w = &fc->workers[fc->next];
+    fc->next = (fc->next + 1) % fc->num_threads;
+    gx_monitor_enter(fc->lock);
+    if (w->tail != NULL)
+        w->tail->next = job;
+    else
+        w->head = job;
+    w->tail = job;
+    gx_monitor_leave(fc->lock);
+    gx_semaphore_signal(w->queued);
+    return 0;
+}
+
 /* Finish writing FontFile* data. */
 static int
 pdf_end_fontfile(gx_device_pdf *pdev, pdf_data_writer_t *pdw)
@@ -604,6 +911,9 @@ pdf_write_embedded_font(gx_device_pdf *pdev, pdf_base_font_t *pbfont, font_type
     byte digest[6] = {0,0,0,0,0,0};
     int code = 0;
     int options=0;
+    pdf_font_compression_t *fc = NULL;
+    pdf_font_compress_job_t *job = NULL;
+    stream *capture = NULL;
 
     if (pbfont->written)
         return 0;		/* already written */
@@ -625,9 +935,31 @@ pdf_write_embedded_font(gx_device_pdf *pdev, pdf_base_font_t *pbfont, font_type
     /* Don't set DATA_STREAM_ENCRYPT since we write to a temporary file.
      * See comment in pdf_begin_encrypt.
      */
+    /*
+     * If the font program can be compressed by a worker thread, write it
+     * uncompressed into a buffer, and name the filter here, so that the
+     * FontFile dictionary is the same as when the filter is used.
+     */
+    if ((options & DATA_STREAM_COMPRESS) && pdev->binary_ok &&
+        pdev->CompatibilityLevel >= 1.3 && FontType != ft_composite)
+        fc = pdf_font_compression(pdev);
+    if (fc != NULL)
+        options &= ~DATA_STREAM_COMPRESS;
     code = pdf_begin_data_stream(pdev, &writer, options, 0);
     if (code < 0)
         return code;
+    if (fc != NULL) {
+        code = cos_dict_put_c_strings((cos_dict_t *)writer.pres->object,
+                                      "/Filter", "/FlateDecode");
+        if (code >= 0)
+            code = pdf_begin_font_capture(fc, &writer, &job);
+        if (code < 0) {
+            pdf_end_fontfile(pdev, &writer);
+            pdf_obj_mark_unused(pdev, writer.pres->object->id);
+            return code;
+        }
+        capture = writer.binary.strm;
+    }
     if (pdev->PDFA != 0) {
         stream *s = s_MD5C_make_stream(pdev->pdf_memory, writer.binary.strm);
 
@@ -776,6 +1108,11 @@ pdf_write_embedded_font(gx_device_pdf *pdev, pdf_base_font_t *pbfont, font_type
             s_MD5C_get_digest(writer.binary.strm, digest, sizeof(digest));
         }
         *ppcd = (cos_dict_t *)writer.pres->object;
+        if (capture != NULL) {
+            code = pdf_end_font_capture(fc, job, capture, code);
+            if (code >= 0)
+                pbfont->compress_job = job;
+        }
         if (code < 0) {
             pdf_end_fontfile(pdev, &writer);
             pdf_obj_mark_unused(pdev, writer.pres->object->id);
@@ -792,6 +1129,66 @@ pdf_write_embedded_font(gx_device_pdf *pdev, pdf_base_font_t *pbfont, font_type
     return code;
 }
 
+/*
+ * Add the compressed data for an embedded font, if it was compressed by a
+ * worker thread, to its FontFile stream.
+ */
+int
+pdf_finish_embedded_font(gx_device_pdf *pdev, pdf_base_font_t *pbfont)
+{
+    pdf_font_compress_job_t *job = pbfont->compress_job;
+    cos_stream_t *pcs = (cos_stream_t *)pbfont->FontFile;
+    int code;
+
+    if (job == NULL)
+        return 0;
+    pbfont->compress_job = NULL;
+    gx_semaphore_wait(job->done);
+    code = job->status;
+    if (code >= 0 && pcs != NULL) {
+        gs_md5_init(&pcs->md5);
+        gs_md5_append(&pcs->md5, job->data, job->size);
+        gs_md5_finish(&pcs->md5, (gs_md5_byte_t *)pcs->stream_hash);
+        pcs->stream_md5_valid = 1;
+        code = cos_stream_add_bytes(pdev, pcs, job->data, job->size);
+    }
+    gs_free_object(pdev->font_compression->memory, job->data,
+                   "font compression(data)");
+    job->data = NULL;
+    if (code < 0 && pcs != NULL)
+        pdf_obj_mark_unused(pdev, pcs->id);
+    return code;
+}
+
+/* Stop the font compression threads, and free the jobs. */
+void
+pdf_free_font_compression(gx_device_pdf *pdev)
+{
+    pdf_font_compression_t *fc = pdev->font_compression;
+    pdf_font_compress_job_t *job;
+    gs_memory_t *mem;
+    int i;
+
+    if (fc == NULL)
+        return;
+    mem = fc->memory;
+    /* Each thread exits when it finds its queue empty. */
+    for (i = 0; i < fc->num_threads; i++) {
+        gx_semaphore_signal(fc->workers[i].queued);
+        gp_thread_finish(fc->workers[i].thread);
+        gx_semaphore_free(fc->workers[i].queued);
+    }
+    while ((job = fc->jobs) != NULL) {
+        fc->jobs = job->link;
+        gs_free_object(mem, job->data, "font compression(data)");
+        gx_semaphore_free(job->done);
+        gs_free_object(mem, job, "font compression(job)");
+    }
+    gx_monitor_free(fc->lock);
+    gs_free_object(mem, fc, "pdf_font_compression");
+    pdev->font_compression = NULL;
+}
+
 /*
  * Write the CharSet for a subsetted font, as a PDF string.
  */
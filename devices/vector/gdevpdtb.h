@@ -133,6 +133,17 @@ int pdf_write_FontFile_entry(gx_device_pdf *pdev, pdf_base_font_t *pbfont);
 int pdf_write_embedded_font(gx_device_pdf *pdev, pdf_base_font_t *pbfont, font_type FontType,
                         gs_int_rect *FontBBox, gs_id rid, cos_dict_t **ppcd);
 
+/*
+ * Add the FontFile data compressed by a worker thread, if any, to the
+ * FontFile stream of an embedded font.
+ */
+int pdf_finish_embedded_font(gx_device_pdf *pdev, pdf_base_font_t *pbfont);
+
+/*
+ * Stop the FontCompressionThreads workers, if they were started.
+ */
+void pdf_free_font_compression(gx_device_pdf *pdev);
+
 /*
  * Write the CharSet data for a subsetted font, as a PDF string.
  */
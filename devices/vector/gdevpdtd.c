@@ -130,7 +130,7 @@ write_FontDescriptor_common(gx_device_pdf *pdev,
     gs_param_list *const plist = (gs_param_list *)&rlist;
     char *base14_name = NULL;
 
-    pdf_open_separate(pdev, pdf_font_descriptor_common_id(pfd), resourceFontDescriptor);
+    pdf_open_compressible_separate(pdev, pdf_font_descriptor_common_id(pfd), resourceFontDescriptor);
     s = pdev->strm;
     stream_puts(s, "<</Type/FontDescriptor/FontName");
     if (!embed) {
@@ -658,6 +658,20 @@ pdf_finish_FontDescriptor(gx_device_pdf *pdev, pdf_resource_t *pres)
     return code;
 }
 
+/*
+ * Finish the FontFile of a FontDescriptor, adding the data compressed by
+ * a FontCompressionThreads worker.
+ */
+int
+pdf_finish_FontFile(gx_device_pdf *pdev, pdf_resource_t *pres)
+{
+    pdf_font_descriptor_t *pfd = (pdf_font_descriptor_t *)pres;
+
+    if (pfd->base_font == NULL)
+        return 0;
+    return pdf_finish_embedded_font(pdev, pfd->base_font);
+}
+
 /* Write a FontDescriptor. */
 int
 pdf_write_FontDescriptor(gx_device_pdf *pdev, pdf_resource_t *pres)
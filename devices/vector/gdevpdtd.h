@@ -178,6 +178,12 @@ int pdf_compute_font_descriptor(gx_device_pdf *pdev, pdf_font_descriptor_t *pfd)
 int pdf_finish_FontDescriptor(gx_device_pdf *pdev,
                               pdf_resource_t *pfd);
 
+/*
+ * Finish the FontFile of a FontDescriptor, once all the embedded fonts
+ * have been written.
+ */
+int pdf_finish_FontFile(gx_device_pdf *pdev, pdf_resource_t *pfd);
+
 int pdf_finish_resources(gx_device_pdf *pdev, pdf_resource_type_t type,
                         int (*finish_proc)(gx_device_pdf *,
                                            pdf_resource_t *));
@@ -178,6 +178,7 @@ struct pdf_base_font_s {
     gs_string font_name;
     bool written;
     cos_dict_t *FontFile;
+    pdf_font_compress_job_t *compress_job; /* FontFile data being compressed (non-gc), or NULL */
 };
 #define private_st_pdf_base_font()\
 BASIC_PTRS(pdf_base_font_ptrs) {\
@@ -571,7 +571,7 @@ pdf_write_bitmap_fonts_Encoding(gx_device_pdf *pdev)
         stream *s;
         int i;
 
-        pdf_open_separate(pdev, pbfs->bitmap_encoding_id, resourceEncoding);
+        pdf_open_compressible_separate(pdev, pbfs->bitmap_encoding_id, resourceEncoding);
         s = pdev->strm;
         /*
          * Even though the PDF reference documentation says that a
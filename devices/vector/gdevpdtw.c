@@ -158,7 +158,7 @@ pdf_write_encoding(gx_device_pdf *pdev, const pdf_font_resource_t *pdfont, long
     const int sl = strlen(gx_extendeg_glyph_name_separator);
     int prev = 256, code, cnt = 0;
 
-    pdf_open_separate(pdev, id, resourceEncoding);
+    pdf_open_compressible_separate(pdev, id, resourceEncoding);
     s = pdev->strm;
     stream_puts(s, "<</Type/Encoding");
     if (base_encoding < 0 && pdev->ForOPDFRead)
@@ -599,13 +599,13 @@ pdf_write_font_resource(gx_device_pdf *pdev, pdf_font_resource_t *pdfont)
 
         pcd_Resources = pdfont->u.simple.s.type3.Resources;
         pcd_Resources->id = pdf_obj_ref(pdev);
-        pdf_open_separate(pdev, pcd_Resources->id, resourceFont);
+        pdf_open_compressible_separate(pdev, pcd_Resources->id, resourceFont);
         code = COS_WRITE(pcd_Resources, pdev);
         if (code < 0)
             return code;
         pdf_end_separate(pdev, resourceFont);
     }
-    pdf_open_separate(pdev, pdf_font_id(pdfont), resourceFont);
+    pdf_open_compressible_separate(pdev, pdf_font_id(pdfont), resourceFont);
     s = pdev->strm;
     stream_puts(s, "<<");
     if (pdfont->BaseFont.size > 0) {
@@ -751,7 +751,7 @@ pdf_write_cid_systemInfo_separate(gx_device_pdf *pdev, const gs_cid_system_info_
 {
     int code;
 
-    *id = pdf_begin_separate(pdev, resourceCIDSystemInfo);
+    *id = pdf_open_compressible_separate(pdev, 0L, resourceCIDSystemInfo);
     code = pdf_write_cid_system_info(pdev, pcidsi, *id);
     pdf_end_separate(pdev, resourceCIDSystemInfo);
     return code;
@@ -414,7 +414,7 @@ extern_st(st_psdf_binary_writer);
 int psdf_begin_binary(gx_device_psdf * pdev, psdf_binary_writer * pbw);
 
 /* Add an encoding filter.  The client must have allocated the stream state, */
-/* if any, using pdev->v_memory. */
+/* if any, using pbw->memory. */
 int psdf_encode_binary(psdf_binary_writer * pbw,
                        const stream_template * template, stream_state * ss);
 
@@ -463,6 +463,22 @@ int new_setup_lossless_filters(gx_device_psdf *pdev, psdf_binary_writer *pbw,
 
 int new_resize_input(psdf_binary_writer *pbw, int width, int num_comps, int bpc_in, int bpc_out);
 
+/*
+ * Run the filters set up between psdf_begin_image_thread and
+ * psdf_end_image_thread (normally by one of the procedures above) on a
+ * worker thread.  pbw->memory is switched to a thread safe allocator in
+ * between.  code is the result of setting up the filters, and is returned
+ * by psdf_end_image_thread unless that fails.  If *ppt is NULL after
+ * psdf_begin_image_thread, threads aren't available and nothing changes.
+ */
+typedef struct psdf_image_thread_s psdf_image_thread;
+int psdf_begin_image_thread(psdf_binary_writer *pbw, psdf_image_thread **ppt);
+int psdf_end_image_thread(psdf_binary_writer *pbw, psdf_image_thread *pt,
+                          int code);
+
+/* Return the filters run by an image thread filter, or NULL. */
+stream *psdf_image_thread_filters(const stream *s);
+
 /* Finish writing binary data. */
 int psdf_end_binary(psdf_binary_writer * pbw);
 
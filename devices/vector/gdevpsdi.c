@@ -19,6 +19,7 @@
 #include "jpeglib_.h"		/* for sdct.h */
 #include "math_.h"
 #include "string_.h"
+#include "memory_.h"
 #include "gx.h"
 #include "gserrors.h"
 #include "gscspace.h"
@@ -34,6 +35,7 @@
 #include "szlibx.h"
 #include "gsicc_manage.h"
 #include "sisparam.h"
+#include "gxsync.h"
 
 /* Define parameter-setting procedures. */
 extern stream_state_proc_put_params(s_CF_put_params, stream_CF_state);
@@ -50,7 +52,7 @@ static int
 pixel_resize(psdf_binary_writer * pbw, int width, int num_components,
              int bpc_in, int bpc_out)
 {
-    gs_memory_t *mem = pbw->dev->v_memory;
+    gs_memory_t *mem = pbw->memory;
     const stream_template *templat;
     stream_1248_state *st;
     int code;
@@ -229,7 +231,7 @@ setup_image_compression(psdf_binary_writer *pbw, const psdf_image_params *pdip,
                         bool lossless)
 {
     gx_device_psdf *pdev = pbw->dev;
-    gs_memory_t *mem = pdev->v_memory;
+    gs_memory_t *mem = pbw->memory;
     const stream_template *templat = pdip->filter_template;
     const stream_template *lossless_template =
         (pdev->params.UseFlateCompression &&
@@ -375,6 +377,7 @@ setup_downsampling(psdf_binary_writer * pbw, const psdf_image_params * pdip,
                    double resolution, bool lossless)
 {
     gx_device_psdf *pdev = pbw->dev;
+    gs_memory_t *mem = pbw->memory;
     const stream_template *templat = &s_Subsample_template;
     float factor = resolution / pdip->Resolution;
     int orig_bpc = pim->BitsPerComponent;
@@ -423,7 +426,7 @@ setup_downsampling(psdf_binary_writer * pbw, const psdf_image_params * pdip,
         }
     }
 
-    st = s_alloc_state(pdev->v_memory, templat->stype,
+    st = s_alloc_state(mem, templat->stype,
                        "setup_downsampling");
     if (st == 0)
         return_error(gs_error_VMerror);
@@ -451,7 +454,7 @@ setup_downsampling(psdf_binary_writer * pbw, const psdf_image_params * pdip,
             code = templat->init(st);
             if (code < 0) {
                 dmprintf(st->memory, "Failed to initialise downsample filter, downsampling aborted\n");
-                gs_free_object(pdev->v_memory, st, "setup_image_compression");
+                gs_free_object(mem, st, "setup_image_compression");
                 return 0;
             }
         }
@@ -469,7 +472,7 @@ setup_downsampling(psdf_binary_writer * pbw, const psdf_image_params * pdip,
             (code = pixel_resize(pbw, orig_width, ss->Colors,
                                  orig_bpc, 8)) < 0
             ) {
-            gs_free_object(pdev->v_memory, st, "setup_image_compression");
+            gs_free_object(mem, st, "setup_image_compression");
             return code;
         }
     } else {
@@ -517,7 +520,7 @@ setup_downsampling(psdf_binary_writer * pbw, const psdf_image_params * pdip,
             code = templat->init(st);
             if (code < 0) {
                 dmprintf(st->memory, "Failed to initialise downsample filter, downsampling aborted\n");
-                gs_free_object(pdev->v_memory, st, "setup_image_compression");
+                gs_free_object(mem, st, "setup_image_compression");
                 return 0;
             }
         }
@@ -535,7 +538,7 @@ setup_downsampling(psdf_binary_writer * pbw, const psdf_image_params * pdip,
             (code = pixel_resize(pbw, orig_width, Colors,
                                  orig_bpc, 8)) < 0
             ) {
-            gs_free_object(pdev->v_memory, st, "setup_image_compression");
+            gs_free_object(mem, st, "setup_image_compression");
             return code;
         }
     }
@@ -963,3 +966,453 @@ int new_resize_input(psdf_binary_writer *pbw, int width, int num_comps, int bpc_
 {
     return pixel_resize(pbw, width, num_comps, bpc_in, bpc_out);
 }
+
+/* ---------------- Threaded image encoding ---------------- */
+
+/*
+ * The downsampling and compression filters for an image can be run by a
+ * worker thread, so that they overlap with the interpreter producing the
+ * image data.  The filters are built as usual, but on top of a collector
+ * stream rather than the client's stream, and allocated from the thread
+ * safe allocator, so the worker never touches garbage collected memory.
+ * In their place the client gets a single filter which hands its input to
+ * the worker in blocks, and copies the encoded data the worker collected
+ * to its own target, in order.
+ *
+ * As for the read-ahead files in gpreadahead.c, the 'free' semaphore
+ * counts the blocks the client may fill, and 'full' the blocks the worker
+ * may encode.  Encoded data is appended to a list of chunks under 'lock',
+ * so the worker never waits for the client.  The worker is only started
+ * when the first block is handed over, so until then the client can still
+ * inspect the filters (see pdf_put_filters).  If the first block is also
+ * the last, or no thread can be started, the client encodes the blocks
+ * itself.
+ */
+#define IMAGE_THREAD_BLOCKS 4
+#define IMAGE_THREAD_BLOCK_SIZE 65536
+#define IMAGE_THREAD_CHUNK_SIZE 65536
+#define IMAGE_THREAD_COLLECT_SIZE 4096
+
+typedef struct image_thread_block_s {
+    byte *data;
+    uint count;
+    bool last;			/* close the filters after this block */
+} image_thread_block;
+
+typedef struct image_thread_chunk_s image_thread_chunk;
+struct image_thread_chunk_s {
+    image_thread_chunk *next;
+    uint count;
+    byte data[IMAGE_THREAD_CHUNK_SIZE];
+};
+
+struct psdf_image_thread_s {
+    gs_memory_t *memory;	/* thread safe */
+    stream *inner;		/* top of the worker's filters */
+    stream *collect;		/* bottom of the worker's filters */
+    stream *target;		/* the client's stream */
+    image_thread_block blocks[IMAGE_THREAD_BLOCKS];
+    gx_semaphore_t *free;
+    gx_semaphore_t *full;
+    gx_monitor_t *lock;
+    gp_thread_id thread;
+    volatile int status;	/* first error from the filters */
+    /* Protected by lock. */
+    image_thread_chunk *done_head;
+    image_thread_chunk *done_tail;
+    /* Used only by whoever is encoding. */
+    int fill;			/* next block to encode */
+    image_thread_chunk *out;	/* chunk being collected */
+    /* Used only by the client. */
+    bool started;		/* encoding has started */
+    bool running;		/* ... on a worker thread */
+    bool finished;		/* the filters have been closed */
+    int next;			/* next block to fill */
+    image_thread_block *cur;	/* block being filled, or NULL */
+    image_thread_chunk *drain;	/* chunks being copied to the target */
+    uint drain_pos;
+};
+
+typedef struct stream_image_thread_state_s {
+    stream_state_common;
+    psdf_image_thread *t;
+} stream_image_thread_state;
+
+static void s_image_thread_finalize(const gs_memory_t *, void *);
+
+/* The pointers are to non-garbage-collected memory, so don't trace them. */
+gs_private_st_simple(st_image_collect_state, stream_image_thread_state,
+                     "stream_image_collect_state");
+gs_private_st_simple_final(st_image_thread_state, stream_image_thread_state,
+                           "stream_image_thread_state",
+                           s_image_thread_finalize);
+
+/* Move the chunk being collected to the list of encoded data. */
+static void
+image_thread_publish(psdf_image_thread *t)
+{
+    image_thread_chunk *c = t->out;
+
+    if (c == NULL)
+        return;
+    t->out = NULL;
+    gx_monitor_enter(t->lock);
+    if (t->done_tail != NULL)
+        t->done_tail->next = c;
+    else
+        t->done_head = c;
+    t->done_tail = c;
+    gx_monitor_leave(t->lock);
+}
+
+/* Collect the output of the worker's filters. */
+static int
+s_image_collect_process(stream_state *st, stream_cursor_read *pr,
+                        stream_cursor_write *ignore_pw, bool last)
+{
+    psdf_image_thread *t = ((stream_image_thread_state *)st)->t;
+
+    while (pr->ptr < pr->limit) {
+        image_thread_chunk *c = t->out;
+        uint n;
+
+        if (c == NULL) {
+            c = (image_thread_chunk *)gs_alloc_bytes(t->memory, sizeof(*c),
+                                                     "image thread(chunk)");
+            if (c == NULL)
+                return ERRC;
+            c->next = NULL;
+            c->count = 0;
+            t->out = c;
+        }
+        n = min(pr->limit - pr->ptr, IMAGE_THREAD_CHUNK_SIZE - c->count);
+        memcpy(c->data + c->count, pr->ptr + 1, n);
+        c->count += n;
+        pr->ptr += n;
+        if (c->count == IMAGE_THREAD_CHUNK_SIZE)
+            image_thread_publish(t);
+    }
+    return 0;
+}
+
+static const stream_procs s_image_collect_procs = {
+    s_std_noavailable, s_std_noseek, s_std_write_reset,
+    s_std_write_flush, s_std_close, s_image_collect_process
+};
+static const stream_template s_image_collect_template = {
+    &st_image_collect_state, 0, s_image_collect_process, 1, 1
+};
+
+/* Encode a block, closing the filters after the last one. */
+static void
+image_thread_encode(psdf_image_thread *t, image_thread_block *b)
+{
+    if (b->count > 0 && t->status >= 0) {
+        uint used;
+
+        if (sputs(t->inner, b->data, b->count, &used) < 0 ||
+            used != b->count)
+            t->status = gs_note_error(gs_error_ioerror);
+    }
+    if (b->last) {
+        if (s_close_filters(&t->inner, t->collect) < 0 && t->status >= 0)
+            t->status = gs_note_error(gs_error_ioerror);
+        image_thread_publish(t);
+    }
+}
+
+static void
+image_thread_main(void *arg)
+{
+    psdf_image_thread *t = (psdf_image_thread *)arg;
+    bool last;
+
+    do {
+        image_thread_block *b;
+
+        gx_semaphore_wait(t->full);
+        b = &t->blocks[t->fill];
+        t->fill = (t->fill + 1) % IMAGE_THREAD_BLOCKS;
+        last = b->last;		/* b may be reused once it is free */
+        image_thread_encode(t, b);
+        gx_semaphore_signal(t->free);
+    } while (!last);
+}
+
+/* Get the block being filled, waiting for one if necessary. */
+static image_thread_block *
+image_thread_block_get(psdf_image_thread *t)
+{
+    if (t->cur == NULL) {
+        gx_semaphore_wait(t->free);
+        t->cur = &t->blocks[t->next];
+        t->cur->count = 0;
+        t->cur->last = false;
+    }
+    return t->cur;
+}
+
+/* Hand the block being filled over for encoding. */
+static void
+image_thread_submit(psdf_image_thread *t)
+{
+    image_thread_block *b = t->cur;
+    bool last = b->last;
+
+    t->cur = NULL;
+    t->next = (t->next + 1) % IMAGE_THREAD_BLOCKS;
+    if (!t->started) {
+        t->started = true;
+        /* Images which fit in one block aren't worth a thread. */
+        if (!last && gp_thread_start(image_thread_main, t, &t->thread) >= 0) {
+            gp_thread_label(t->thread, "image encoder");
+            t->running = true;
+        }
+    }
+    if (t->running)
+        gx_semaphore_signal(t->full);
+    else {
+        image_thread_encode(t, b);
+        gx_semaphore_signal(t->free);
+    }
+    if (last) {
+        if (t->running)
+            gp_thread_finish(t->thread);
+        t->running = false;
+        t->finished = true;
+    }
+}
+
+/* Copy encoded data to the target.  Return 1 if its buffer fills up. */
+static int
+image_thread_drain(psdf_image_thread *t, stream_cursor_write *pw)
+{
+    for (;;) {
+        image_thread_chunk *c = t->drain;
+        uint n;
+
+        if (c == NULL) {
+            gx_monitor_enter(t->lock);
+            c = t->done_head;
+            t->done_head = t->done_tail = NULL;
+            gx_monitor_leave(t->lock);
+            if (c == NULL)
+                return 0;
+            t->drain = c;
+            t->drain_pos = 0;
+        }
+        n = min(c->count - t->drain_pos, pw->limit - pw->ptr);
+        memcpy(pw->ptr + 1, c->data + t->drain_pos, n);
+        pw->ptr += n;
+        t->drain_pos += n;
+        if (t->drain_pos < c->count)
+            return 1;
+        t->drain = c->next;
+        t->drain_pos = 0;
+        gs_free_object(t->memory, c, "image thread(chunk)");
+    }
+}
+
+static void
+image_thread_free_chunks(psdf_image_thread *t, image_thread_chunk *c)
+{
+    while (c != NULL) {
+        image_thread_chunk *next = c->next;
+
+        gs_free_object(t->memory, c, "image thread(chunk)");
+        c = next;
+    }
+}
+
+/* Stop encoding if necessary, and free everything. */
+static void
+image_thread_free(psdf_image_thread *t)
+{
+    gs_memory_t *mem = t->memory;
+    int i;
+
+    if (!t->finished) {
+        /* Don't start a worker just to close the filters. */
+        t->started = true;
+        image_thread_block_get(t)->last = true;
+        image_thread_submit(t);
+    }
+    image_thread_free_chunks(t, t->drain);
+    image_thread_free_chunks(t, t->done_head);
+    image_thread_free_chunks(t, t->out);
+    if (t->collect != NULL) {
+        gs_free_object(mem, t->collect->cbuf, "image thread(collect buf)");
+        gs_free_object(mem, t->collect->state, "image thread(collect state)");
+        gs_free_object(mem, t->collect, "image thread(collect)");
+    }
+    for (i = 0; i < IMAGE_THREAD_BLOCKS; i++)
+        gs_free_object(mem, t->blocks[i].data, "image thread(block)");
+    if (t->free != NULL)
+        gx_semaphore_free(t->free);
+    if (t->full != NULL)
+        gx_semaphore_free(t->full);
+    if (t->lock != NULL)
+        gx_monitor_free(t->lock);
+    gs_free_object(mem, t, "image thread");
+}
+
+static int
+s_image_thread_process(stream_state *st, stream_cursor_read *pr,
+                       stream_cursor_write *pw, bool last)
+{
+    psdf_image_thread *t = ((stream_image_thread_state *)st)->t;
+    bool submitted = false;
+
+    while (pr->ptr < pr->limit) {
+        image_thread_block *b = image_thread_block_get(t);
+        uint n = min(pr->limit - pr->ptr, IMAGE_THREAD_BLOCK_SIZE - b->count);
+
+        memcpy(b->data + b->count, pr->ptr + 1, n);
+        b->count += n;
+        pr->ptr += n;
+        if (b->count == IMAGE_THREAD_BLOCK_SIZE) {
+            image_thread_submit(t);
+            submitted = true;
+        }
+    }
+    if (last && !t->finished) {
+        image_thread_block_get(t)->last = true;
+        image_thread_submit(t);
+        submitted = true;
+    }
+    /* Only look for encoded data now and then, to save locking. */
+    if ((submitted || t->drain != NULL) && image_thread_drain(t, pw))
+        return 1;
+    return (t->status < 0 ? ERRC : 0);
+}
+
+static void
+s_image_thread_release(stream_state *st)
+{
+    stream_image_thread_state *const ss = (stream_image_thread_state *)st;
+
+    if (ss->t != NULL)
+        image_thread_free(ss->t);
+    ss->t = NULL;
+}
+
+/* The stream may be freed without being closed if the image is abandoned. */
+static void
+s_image_thread_finalize(const gs_memory_t *cmem, void *vptr)
+{
+    s_image_thread_release((stream_state *)vptr);
+}
+
+static const stream_template s_image_thread_template = {
+    &st_image_thread_state, 0, s_image_thread_process, 1, 1,
+    s_image_thread_release
+};
+
+/*
+ * Prepare to set up the image filters for pbw on a worker thread.  If this
+ * succeeds, *ppt is non-NULL and psdf_end_image_thread must be called once
+ * the filters have been added, whether that succeeded or not.
+ */
+int
+psdf_begin_image_thread(psdf_binary_writer *pbw, psdf_image_thread **ppt)
+{
+    gs_memory_t *mem = pbw->dev->memory->thread_safe_memory;
+    psdf_image_thread *t;
+    stream_image_thread_state *ss;
+    byte *buf;
+    int i;
+
+    *ppt = NULL;
+    /* Filters (zlib in particular) allocate from the stable memory. */
+    if (mem == NULL || mem->stable_memory != mem)
+        return 0;
+    t = (psdf_image_thread *)gs_alloc_bytes(mem, sizeof(*t), "image thread");
+    if (t == NULL)
+        return_error(gs_error_VMerror);
+    memset(t, 0, sizeof(*t));
+    t->memory = mem;
+    t->finished = true;		/* nothing to close yet */
+    for (i = 0; i < IMAGE_THREAD_BLOCKS; i++) {
+        t->blocks[i].data = gs_alloc_bytes(mem, IMAGE_THREAD_BLOCK_SIZE,
+                                           "image thread(block)");
+        if (t->blocks[i].data == NULL)
+            goto fail;
+    }
+    t->free = gx_semaphore_label(gx_semaphore_alloc(mem), "image thread(free)");
+    t->full = gx_semaphore_label(gx_semaphore_alloc(mem), "image thread(full)");
+    t->lock = gx_monitor_label(gx_monitor_alloc(mem), "image thread(lock)");
+    if (t->free == NULL || t->full == NULL || t->lock == NULL)
+        goto fail;
+    for (i = 0; i < IMAGE_THREAD_BLOCKS; i++)
+        gx_semaphore_signal(t->free);
+    t->collect = s_alloc(mem, "image thread(collect)");
+    ss = (stream_image_thread_state *)
+        s_alloc_state(mem, &st_image_collect_state,
+                      "image thread(collect state)");
+    buf = gs_alloc_bytes(mem, IMAGE_THREAD_COLLECT_SIZE,
+                         "image thread(collect buf)");
+    if (t->collect == NULL || ss == NULL || buf == NULL) {
+        gs_free_object(mem, buf, "image thread(collect buf)");
+        gs_free_object(mem, ss, "image thread(collect state)");
+        gs_free_object(mem, t->collect, "image thread(collect)");
+        t->collect = NULL;
+        goto fail;
+    }
+    ss->templat = &s_image_collect_template;
+    ss->t = t;
+    s_std_init(t->collect, buf, IMAGE_THREAD_COLLECT_SIZE,
+               &s_image_collect_procs, s_mode_write);
+    t->collect->state = (stream_state *)ss;
+    t->target = pbw->strm;
+    pbw->strm = t->collect;
+    pbw->memory = mem;
+    *ppt = t;
+    return 0;
+ fail:
+    image_thread_free(t);
+    return_error(gs_error_VMerror);
+}
+
+/*
+ * Finish setting up the image filters for a worker thread.  code is the
+ * result of adding them, which is returned unless this fails.  If there
+ * are no filters, or adding them failed, pbw is left as it was before
+ * psdf_begin_image_thread.
+ */
+int
+psdf_end_image_thread(psdf_binary_writer *pbw, psdf_image_thread *t, int code)
+{
+    gs_memory_t *mem = pbw->memory = pbw->dev->v_memory;
+    stream_image_thread_state *ss;
+
+    if (code < 0 || pbw->strm == t->collect) {
+        s_close_filters(&pbw->strm, t->collect);
+        pbw->strm = t->target;
+        image_thread_free(t);
+        return code;
+    }
+    t->inner = pbw->strm;
+    t->finished = false;
+    pbw->strm = t->target;
+    ss = (stream_image_thread_state *)
+        s_alloc_state(mem, &st_image_thread_state, "psdf_end_image_thread");
+    if (ss == NULL) {
+        image_thread_free(t);
+        return_error(gs_error_VMerror);
+    }
+    ss->t = t;
+    code = psdf_encode_binary(pbw, &s_image_thread_template,
+                              (stream_state *)ss);
+    if (code < 0)
+        gs_free_object(mem, ss, "psdf_end_image_thread"); /* frees t */
+    return code;
+}
+
+/* Return the filters run by an image thread filter, or NULL. */
+stream *
+psdf_image_thread_filters(const stream *s)
+{
+    if (s->procs.process != s_image_thread_process)
+        return NULL;
+    return ((const stream_image_thread_state *)s->state)->t->inner;
+}
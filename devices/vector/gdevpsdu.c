@@ -344,7 +344,7 @@ psdf_begin_binary(gx_device_psdf * pdev, psdf_binary_writer * pbw)
 }
 
 /* Add an encoding filter.  The client must have allocated the stream state, */
-/* if any, using pdev->v_memory. */
+/* if any, using pbw->memory. */
 int
 psdf_encode_binary(psdf_binary_writer * pbw, const stream_template * templat,
                    stream_state * ss)
@@ -671,7 +671,8 @@ static gp_file_ops_t buffered_file_ops = {
     NULL, /* ferror */
     NULL, /* get_file */
     NULL, /* clearerr */
-    NULL /* reopen */
+    NULL, /* reopen */
+    NULL /* mmap */
 };
 
 static int
@@ -2437,6 +2438,21 @@ pl_main_process_options(pl_main_instance_t * pmi, arg_list * pal,
                         pmi->saved_pages_test_mode = true;
 #endif /* OMIT_SAVED_PAGES_TEST */
                     break;
+                } else if (strcmp(arg, "mmap") == 0) {
+                    pmi->memory->gs_lib_ctx->core->mmap_files = 1;
+                    break;
+                } else if (strcmp(arg, "no-mmap") == 0) {
+                    pmi->memory->gs_lib_ctx->core->mmap_files = 0;
+                    break;
+                } else if (strncmp(arg, "readahead=", 10) == 0) {
+                    uint size;
+
+                    if (sscanf(arg + 10, "%u", &size) != 1) {
+                        errprintf(pmi->memory, "--readahead= must be followed by a size in bytes\n");
+                        return -1;
+                    }
+                    pmi->memory->gs_lib_ctx->core->readahead_size = size;
+                    break;
                 }
                 /* Now handle the explicitly added paths to the file control lists */
                 else if (arg_match(&arg, "permit-file-read")) {
@@ -34,6 +34,7 @@
 #include "pdf_page.h"
 #include "pdf_check.h"
 #include "pdf_optcontent.h"
+#include "pdf_image.h"
 #include "pdf_sec.h"
 #include "pdf_doc.h"
 #include "pdf_repair.h"
@@ -2042,6 +2043,8 @@ int pdfi_clear_context(pdf_context *ctx)
 
     pdfi_free_DefaultQState(ctx);
     pdfi_oc_free(ctx);
+    pdfi_image_cache_free(ctx);
+    pdfi_free_jbig2_globals(ctx);
 
     if(ctx->encryption.EKey) {
         pdfi_countdown(ctx->encryption.EKey);
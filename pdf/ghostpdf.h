@@ -90,6 +90,9 @@ typedef enum pdf_type3_d_type_e {
 #define INITIAL_STACK_SIZE 32
 #define MAX_STACK_SIZE 524288
 #define MAX_OBJECT_CACHE_SIZE 200
+#define MAX_IMAGE_CACHE_ENTRIES 64
+#define MAX_IMAGE_CACHE_BYTES (32 * 1024 * 1024)
+#define MAX_JBIG2_GLOBALS_CACHE_ENTRIES 32
 #define INITIAL_LOOP_TRACKER_SIZE 32
 
 typedef struct pdf_transfer_s {
@@ -445,6 +448,7 @@ typedef struct pdf_context_s
     pdf_dict *PagesTree;
     uint64_t num_pages;
     uint32_t *page_array; /* cache of page dict object_num's for pdfmark Dest */
+    void *page_index; /* Kids array offsets for page lookup, see pdf_doc.c */
     pdf_dict *AcroForm;
     bool NeedAppearances; /* From AcroForm, if any */
 
@@ -459,6 +463,21 @@ typedef struct pdf_context_s
     pdf_obj_cache_entry *cache_LRU;
     pdf_obj_cache_entry *cache_MRU;
 
+    /* The decoded image cache */
+    uint32_t image_cache_entries;
+    uint64_t image_cache_bytes;
+    pdf_image_cache_entry *image_cache_LRU;
+    pdf_image_cache_entry *image_cache_MRU;
+
+    /* Decoded JBIG2Globals streams, see pdf_file.c */
+    uint32_t jbig2_globals_entries;
+    void *jbig2_globals;
+    /* Power of 2 by which the DCTDecode and JPXDecode filters may reduce
+     * the resolution of the image whose data is being opened (see
+     * pdfi_do_image)
+     */
+    int image_reduce;
+
     /* The loop detection state */
     uint32_t loop_detection_size;
     uint32_t loop_detection_entries;
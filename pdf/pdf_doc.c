@@ -583,6 +583,122 @@ void pdfi_free_OptionalRoot(pdf_context *ctx)
     }
 }
 
+/* Looking up a page walks the Kids array of each Pages node from the start,
+ * which is quadratic in the number of pages for large, flat, page trees. To
+ * avoid this we remember, for each Kids array, the page offset at which each
+ * of the entries we have already stepped over begins, so that a later search
+ * can start directly at the right entry. Entries are only recorded once their
+ * page count is known, so the result is exactly the same as walking the array.
+ */
+#define PDFI_PAGE_INDEX_BUCKETS 256
+
+typedef struct pdfi_page_index_node_s pdfi_page_index_node;
+
+struct pdfi_page_index_node_s {
+    pdfi_page_index_node *next;
+    pdf_array *Kids;
+    uint64_t base;      /* Page offset of the node */
+    uint64_t scanned;   /* Number of Kids entries whose page counts are known */
+    uint64_t *start;    /* Page offset of Kids[i] relative to the node, for i <= scanned */
+};
+
+typedef struct {
+    pdfi_page_index_node *buckets[PDFI_PAGE_INDEX_BUCKETS];
+} pdfi_page_index;
+
+/* Find the index for a Kids array, creating it if needed. Returns NULL if we
+ * can't allocate one, or if the same Kids array turns up at a different page
+ * offset (a broken tree), in which case the caller simply walks the array.
+ */
+static pdfi_page_index_node *pdfi_page_index_find(pdf_context *ctx, pdf_array *Kids, uint64_t base)
+{
+    pdfi_page_index *index = (pdfi_page_index *)ctx->page_index;
+    pdfi_page_index_node *node;
+    uint64_t size = pdfi_array_size(Kids);
+    uint h = (uint)(((size_t)Kids >> 4) % PDFI_PAGE_INDEX_BUCKETS);
+
+    if (index == NULL) {
+        index = (pdfi_page_index *)gs_alloc_bytes(ctx->memory, sizeof(pdfi_page_index),
+                                                  "pdfi_page_index_find(index)");
+        if (index == NULL)
+            return NULL;
+        memset(index, 0x00, sizeof(pdfi_page_index));
+        ctx->page_index = index;
+    }
+
+    for (node = index->buckets[h]; node != NULL; node = node->next) {
+        if (node->Kids == Kids)
+            return (node->base == base ? node : NULL);
+    }
+
+    node = (pdfi_page_index_node *)gs_alloc_bytes(ctx->memory, sizeof(pdfi_page_index_node),
+                                                  "pdfi_page_index_find(node)");
+    if (node == NULL)
+        return NULL;
+    node->start = (uint64_t *)gs_alloc_bytes(ctx->memory, (size + 1) * sizeof(uint64_t),
+                                             "pdfi_page_index_find(start)");
+    if (node->start == NULL) {
+        gs_free_object(ctx->memory, node, "pdfi_page_index_find(node)");
+        return NULL;
+    }
+    node->start[0] = 0;
+    node->base = base;
+    node->scanned = 0;
+    node->Kids = Kids;
+    pdfi_countup(Kids);
+    node->next = index->buckets[h];
+    index->buckets[h] = node;
+    return node;
+}
+
+/* Record that Kids[i] ends at relative page offset 'end' */
+static void pdfi_page_index_note(pdfi_page_index_node *node, uint64_t i, uint64_t end)
+{
+    if (node != NULL && i == node->scanned) {
+        node->start[i + 1] = end;
+        node->scanned++;
+    }
+}
+
+/* Return the Kids entry containing relative page offset 'rel', or the first
+ * entry we haven't yet stepped over if it lies beyond those.
+ */
+static uint64_t pdfi_page_index_search(pdfi_page_index_node *node, uint64_t rel)
+{
+    uint64_t lo = 0, hi = node->scanned;
+
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo + 1) / 2;
+
+        if (node->start[mid] <= rel)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    return lo;
+}
+
+static void pdfi_page_index_free(pdf_context *ctx)
+{
+    pdfi_page_index *index = (pdfi_page_index *)ctx->page_index;
+    pdfi_page_index_node *node, *next;
+    int i;
+
+    if (index == NULL)
+        return;
+
+    for (i = 0; i < PDFI_PAGE_INDEX_BUCKETS; i++) {
+        for (node = index->buckets[i]; node != NULL; node = next) {
+            next = node->next;
+            pdfi_countdown(node->Kids);
+            gs_free_object(ctx->memory, node->start, "pdfi_page_index_free(start)");
+            gs_free_object(ctx->memory, node, "pdfi_page_index_free(node)");
+        }
+    }
+    gs_free_object(ctx->memory, index, "pdfi_page_index_free(index)");
+    ctx->page_index = NULL;
+}
+
 /* Handle child node processing for page_dict */
 static int pdfi_get_child(pdf_context *ctx, pdf_array *Kids, int i, pdf_dict **pchild)
 {
@@ -751,6 +867,8 @@ int pdfi_get_page_dict(pdf_context *ctx, pdf_dict *d, uint64_t page_num, uint64_
     pdf_dict *child = NULL;
     pdf_name *Type = NULL;
     pdf_dict *inheritable = NULL;
+    pdfi_page_index_node *node = NULL;
+    uint64_t base = *page_offset;
     int64_t num;
     double dbl;
 
@@ -815,8 +933,16 @@ int pdfi_get_page_dict(pdf_context *ctx, pdf_dict *d, uint64_t page_num, uint64_
         goto exit;
     }
 
+    /* Start with the entry containing the page, if we've been here before */
+    i = 0;
+    node = pdfi_page_index_find(ctx, Kids, base);
+    if (node != NULL && page_num >= base) {
+        i = (int)pdfi_page_index_search(node, page_num - base);
+        *page_offset = base + node->start[i];
+    }
+
     /* Check each entry in the Kids array */
-    for (i = 0;i < pdfi_array_size(Kids);i++) {
+    for (;i < pdfi_array_size(Kids);i++) {
         pdfi_countdown(child);
         child = NULL;
         pdfi_countdown(Type);
@@ -842,6 +968,7 @@ int pdfi_get_page_dict(pdf_context *ctx, pdf_dict *d, uint64_t page_num, uint64_
                         code = gs_note_error(gs_error_rangecheck);
                         goto exit;
                     } else {
+                        pdfi_page_index_note(node, i, *page_offset + num - base);
                         if (num + *page_offset <= page_num) {
                             *page_offset += num;
                         } else {
@@ -852,6 +979,7 @@ int pdfi_get_page_dict(pdf_context *ctx, pdf_dict *d, uint64_t page_num, uint64_
                 }
             } else {
                 if (pdfi_name_is(Type, "PageRef")) {
+                    pdfi_page_index_note(node, i, *page_offset + 1 - base);
                     if ((*page_offset) == page_num) {
                         pdf_dict *page_dict = NULL;
 
@@ -869,6 +997,7 @@ int pdfi_get_page_dict(pdf_context *ctx, pdf_dict *d, uint64_t page_num, uint64_
                 } else {
                     if (!pdfi_name_is(Type, "Page"))
                         pdfi_set_error(ctx, 0, NULL, E_PDF_BADPAGETYPE, "pdfi_get_page_dict", NULL);
+                    pdfi_page_index_note(node, i, *page_offset + 1 - base);
                     if ((*page_offset) == page_num) {
                         code = pdfi_merge_dicts(ctx, child, inheritable);
                         *target = child;
@@ -910,6 +1039,7 @@ int pdfi_doc_page_array_init(pdf_context *ctx)
 
 void pdfi_doc_page_array_free(pdf_context *ctx)
 {
+    pdfi_page_index_free(ctx);
     if (!ctx->page_array)
         return;
     gs_free_object(ctx->memory, ctx->page_array, "pdfi_doc_page_array_free(page_array)");
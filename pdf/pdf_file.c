@@ -343,6 +343,71 @@ static int pdfi_Flate_filter(pdf_context *ctx, pdf_dict *d, stream *source, stre
     return code;
 }
 
+/* A decoded JBIG2Globals stream, shared by all the images which use it.
+ * 'gd' is passed to the decoder as the global_struct, which tells it that
+ * the global context belongs to us.
+ */
+typedef struct pdfi_jbig2_globals_s {
+    struct pdfi_jbig2_globals_s *next;
+    uint32_t object_num;
+    uint32_t generation_num;
+    s_jbig2_global_data_t gd;
+} pdfi_jbig2_globals;
+
+/* The entries are only freed with the context, since a stream
+ * using one may still be open, so the cache is simply limited in size.
+ */
+static pdfi_jbig2_globals *
+pdfi_find_jbig2_globals(pdf_context *ctx, pdf_stream *Globals)
+{
+    pdfi_jbig2_globals *entry = (pdfi_jbig2_globals *)ctx->jbig2_globals;
+
+    for (; entry != NULL; entry = entry->next)
+        if (entry->object_num == Globals->object_num &&
+            entry->generation_num == Globals->generation_num)
+            return entry;
+    return NULL;
+}
+
+static void
+pdfi_add_jbig2_globals(pdf_context *ctx, pdf_stream *Globals, void *globalctx,
+                       s_jbig2_global_data_t **pgd)
+{
+    pdfi_jbig2_globals *entry;
+
+    *pgd = NULL;
+    if (Globals->object_num == 0 ||
+        ctx->jbig2_globals_entries >= MAX_JBIG2_GLOBALS_CACHE_ENTRIES)
+        return;
+    entry = (pdfi_jbig2_globals *)gs_alloc_bytes(ctx->memory->non_gc_memory,
+                                    sizeof(*entry), "pdfi_add_jbig2_globals");
+    if (entry == NULL)
+        return;
+    entry->object_num = Globals->object_num;
+    entry->generation_num = Globals->generation_num;
+    entry->gd.data = globalctx;
+    entry->next = (pdfi_jbig2_globals *)ctx->jbig2_globals;
+    ctx->jbig2_globals = entry;
+    ctx->jbig2_globals_entries++;
+    *pgd = &entry->gd;
+}
+
+void
+pdfi_free_jbig2_globals(pdf_context *ctx)
+{
+    pdfi_jbig2_globals *entry = (pdfi_jbig2_globals *)ctx->jbig2_globals;
+
+    while (entry != NULL) {
+        pdfi_jbig2_globals *next = entry->next;
+
+        s_jbig2decode_free_global_data(entry->gd.data);
+        gs_free_object(ctx->memory->non_gc_memory, entry, "pdfi_free_jbig2_globals");
+        entry = next;
+    }
+    ctx->jbig2_globals = NULL;
+    ctx->jbig2_globals_entries = 0;
+}
+
 static int
 pdfi_JBIG2Decode_filter(pdf_context *ctx, pdf_dict *dict, pdf_dict *decode,
                         stream *source, stream **new_stream)
@@ -354,6 +419,8 @@ pdfi_JBIG2Decode_filter(pdf_context *ctx, pdf_dict *dict, pdf_dict *decode,
     byte *buf = NULL;
     int64_t buflen = 0;
     void *globalctx;
+    pdfi_jbig2_globals *entry;
+    s_jbig2_global_data_t *gd;
 
     s_jbig2decode_set_global_data((stream_state*)&state, NULL, NULL);
 
@@ -364,16 +431,24 @@ pdfi_JBIG2Decode_filter(pdf_context *ctx, pdf_dict *dict, pdf_dict *decode,
             goto cleanupExit;
         }
 
-        /* read in the globals from stream */
+        /* read in the globals from stream, unless an earlier image used them */
         if (code > 0) {
-            code = pdfi_stream_to_buffer(ctx, Globals, &buf, &buflen);
-            if (code == 0) {
-                code = s_jbig2decode_make_global_data(ctx->memory->non_gc_memory,
-                                                      buf, buflen, &globalctx);
-                if (code < 0)
-                    goto cleanupExit;
-
-                s_jbig2decode_set_global_data((stream_state*)&state, NULL, globalctx);
+            entry = pdfi_find_jbig2_globals(ctx, Globals);
+            if (entry != NULL) {
+                s_jbig2decode_set_global_data((stream_state*)&state, &entry->gd, entry->gd.data);
+            } else {
+                code = pdfi_stream_to_buffer(ctx, Globals, &buf, &buflen);
+                if (code == 0) {
+                    code = s_jbig2decode_make_global_data(ctx->memory->non_gc_memory,
+                                                          buf, buflen, &globalctx);
+                    if (code < 0)
+                        goto cleanupExit;
+
+                    gd = NULL;
+                    if (globalctx != NULL)
+                        pdfi_add_jbig2_globals(ctx, Globals, globalctx, &gd);
+                    s_jbig2decode_set_global_data((stream_state*)&state, gd, globalctx);
+                }
             }
         }
     }
@@ -460,6 +535,7 @@ pdfi_JPX_filter(pdf_context *ctx, pdf_dict *dict, pdf_dict *decode,
     state.memory = ctx->memory->non_gc_memory;
     if (s_jpxd_template.set_defaults)
       (*s_jpxd_template.set_defaults)((stream_state *)&state);
+    state.reduce = ctx->image_reduce;
 
     /* Pull some extra params out of the image dict */
     if (dict) {
@@ -640,6 +716,7 @@ static int pdfi_DCT_filter(pdf_context *ctx, pdf_dict *stream_dict, pdf_dict *de
     if (code < 0)
         return code;
     jddp->Height = (int)floor(Height);
+    dcts.Reduce = ctx->image_reduce;
 
     jddp->templat = s_DCTD_template;
 
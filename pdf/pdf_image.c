@@ -43,6 +43,7 @@
 #include "gspath.h"         /* For gs_moveto() and friends */
 #include "gsstate.h"        /* For gs_setoverprintmode() */
 #include "gscoord.h"        /* for gs_concat() and others */
+#include "math_.h"         /* for hypot() */
 
 int pdfi_BI(pdf_context *ctx)
 {
@@ -57,6 +58,7 @@ typedef struct {
     int bpc;
     uint32_t cs_enum;
     bool iccbased;
+    bool palette;
     bool no_data;
     bool is_valid;
     uint32_t icc_offset;
@@ -406,6 +408,7 @@ pdfi_scan_jpxfilter(pdf_context *ctx, pdf_c_stream *source, int length, pdfi_jpx
                       data[0], data[1], data[2], data[3], data[4], data[5], data[6]);
             bpc = data[3];
             bpc = (bpc & 0x7) + 1;
+            info->palette = true;
             if (ctx->args.pdfdebug)
                 dbgmprintf1(ctx->memory, "    PCLR BPC: %d\n", bpc);
             break;
@@ -1642,6 +1645,212 @@ pdfi_make_smask_dict(pdf_context *ctx, pdf_stream *image_stream, pdfi_image_info
     return code;
 }
 
+/* The decoded image cache.
+ * Documents often draw the same image XObject on many pages (a logo, say),
+ * and every time we would read and decompress the stream again. So we keep
+ * the decoded samples of images which have been drawn more than once, up to
+ * MAX_IMAGE_CACHE_BYTES in total, keyed on the object and generation number
+ * and the offset of the stream data. The first time an image is drawn we
+ * only record that we have seen it, so images used once are never copied.
+ * Entries are kept in LRU order, in the same way as the object cache.
+ */
+static void
+pdfi_image_cache_unlink(pdf_context *ctx, pdf_image_cache_entry *entry)
+{
+    if (entry->previous)
+        ((pdf_image_cache_entry *)entry->previous)->next = entry->next;
+    else
+        ctx->image_cache_LRU = entry->next;
+    if (entry->next)
+        ((pdf_image_cache_entry *)entry->next)->previous = entry->previous;
+    else
+        ctx->image_cache_MRU = entry->previous;
+    entry->next = entry->previous = NULL;
+}
+
+static void
+pdfi_image_cache_link_MRU(pdf_context *ctx, pdf_image_cache_entry *entry)
+{
+    entry->previous = ctx->image_cache_MRU;
+    entry->next = NULL;
+    if (ctx->image_cache_MRU)
+        ctx->image_cache_MRU->next = entry;
+    ctx->image_cache_MRU = entry;
+    if (ctx->image_cache_LRU == NULL)
+        ctx->image_cache_LRU = entry;
+}
+
+static void
+pdfi_image_cache_free_entry(pdf_context *ctx, pdf_image_cache_entry *entry)
+{
+    pdfi_image_cache_unlink(ctx, entry);
+    ctx->image_cache_bytes -= entry->size;
+    ctx->image_cache_entries--;
+    gs_free_object(ctx->memory, entry->data, "pdfi_image_cache_free_entry (data)");
+    gs_free_object(ctx->memory, entry, "pdfi_image_cache_free_entry");
+}
+
+/* Evict least recently used entries until there is room for 'size' more bytes
+ * and one more entry. Entries whose data is being read are left alone.
+ */
+static bool
+pdfi_image_cache_make_room(pdf_context *ctx, uint64_t size)
+{
+    pdf_image_cache_entry *entry = ctx->image_cache_LRU, *next;
+
+    while (entry != NULL && (ctx->image_cache_bytes + size > MAX_IMAGE_CACHE_BYTES ||
+                             ctx->image_cache_entries >= MAX_IMAGE_CACHE_ENTRIES)) {
+        next = entry->next;
+        if (entry->in_use == 0)
+            pdfi_image_cache_free_entry(ctx, entry);
+        entry = next;
+    }
+    return (ctx->image_cache_bytes + size <= MAX_IMAGE_CACHE_BYTES &&
+            ctx->image_cache_entries < MAX_IMAGE_CACHE_ENTRIES);
+}
+
+/* Find the cache entry for an image, creating one if this is the first time
+ * we have seen it. Returns NULL if the image is not to be cached.
+ */
+static pdf_image_cache_entry *
+pdfi_image_cache_find(pdf_context *ctx, pdf_stream *image_stream, gs_offset_t stream_offset,
+                      uint64_t size)
+{
+    pdf_image_cache_entry *entry;
+
+    /* Devices like pdfwrite may pass the compressed data straight through */
+    if (ctx->device_state.HighLevelDevice || image_stream->object_num == 0 ||
+        size == 0 || size > MAX_IMAGE_CACHE_BYTES)
+        return NULL;
+
+    for (entry = ctx->image_cache_MRU; entry != NULL; entry = entry->previous) {
+        if (entry->object_num == image_stream->object_num &&
+            entry->generation_num == image_stream->generation_num &&
+            entry->stream_offset == stream_offset) {
+            if (entry->data != NULL && entry->size != size)
+                return NULL;
+            pdfi_image_cache_unlink(ctx, entry);
+            pdfi_image_cache_link_MRU(ctx, entry);
+            return entry;
+        }
+    }
+
+    if (!pdfi_image_cache_make_room(ctx, 0))
+        return NULL;
+    entry = (pdf_image_cache_entry *)gs_alloc_bytes(ctx->memory, sizeof(pdf_image_cache_entry),
+                                                    "pdfi_image_cache_find");
+    if (entry == NULL)
+        return NULL;
+    memset(entry, 0x00, sizeof(pdf_image_cache_entry));
+    entry->object_num = image_stream->object_num;
+    entry->generation_num = image_stream->generation_num;
+    entry->stream_offset = stream_offset;
+    pdfi_image_cache_link_MRU(ctx, entry);
+    ctx->image_cache_entries++;
+    /* Only seen once so far; leave 'data' NULL */
+    return NULL;
+}
+
+/* Read the decoded data for a second sighting of an image into the cache.
+ * Returns 1 if the data was cached, in which case *stream is replaced by a
+ * memory stream reading the cached data. Returns 0 if the image can't be
+ * cached; if the data was already read *stream is closed and set to NULL, and
+ * the caller must open the filters again.
+ */
+static int
+pdfi_image_cache_fill(pdf_context *ctx, pdf_image_cache_entry *entry, uint64_t size,
+                      pdf_c_stream **stream)
+{
+    byte *data = NULL;
+    uint nread = 0;
+    int code;
+
+    if (pdfi_image_cache_make_room(ctx, size))
+        data = gs_alloc_bytes(ctx->memory, size, "pdfi_image_cache_fill");
+    if (data == NULL)
+        return 0;
+
+    (void)sgets((*stream)->s, data, size, &nread);
+    pdfi_close_file(ctx, *stream);
+    *stream = NULL;
+    if (nread != size) {
+        /* Truncated or broken data; leave it to the normal path to deal with */
+        gs_free_object(ctx->memory, data, "pdfi_image_cache_fill");
+        return 0;
+    }
+    entry->data = data;
+    entry->size = size;
+    ctx->image_cache_bytes += size;
+
+    code = pdfi_open_memory_stream_from_memory(ctx, (unsigned int)size, entry->data, stream, true);
+    if (code < 0) {
+        *stream = NULL;
+        return code;
+    }
+    return 1;
+}
+
+void
+pdfi_image_cache_free(pdf_context *ctx)
+{
+    while (ctx->image_cache_LRU != NULL)
+        pdfi_image_cache_free_entry(ctx, ctx->image_cache_LRU);
+    ctx->image_cache_bytes = 0;
+    ctx->image_cache_entries = 0;
+}
+
+/* A JPEG or JPEG 2000 image which is much larger than its size on the
+ * device can be decoded at a lower resolution (see the DCTDecode and
+ * JPXDecode filters). Work out how many factors of 2 we can lose while
+ * still leaving at least 2 samples per device pixel in each direction.
+ */
+#define PDFI_IMAGE_MAX_REDUCE 5
+
+static int
+pdfi_image_reduce(pdf_context *ctx, pdfi_image_info_t *image_info, gs_color_space *pcs)
+{
+    double dev_width, dev_height;
+    int reduce = 0;
+
+    if (ctx->device_state.HighLevelDevice || image_info->ImageMask)
+        return 0;
+    /* Can't average palette indices */
+    if (image_info->is_JPXDecode && image_info->jpx_info.palette)
+        return 0;
+    if (pcs != NULL && gs_color_space_get_index(pcs) == gs_color_space_index_Indexed)
+        return 0;
+
+    dev_width = hypot(ctx->pgs->ctm.xx, ctx->pgs->ctm.xy);
+    dev_height = hypot(ctx->pgs->ctm.yx, ctx->pgs->ctm.yy);
+
+    while (reduce < PDFI_IMAGE_MAX_REDUCE &&
+           (image_info->Width >> (reduce + 1)) >= 2 * dev_width &&
+           (image_info->Height >> (reduce + 1)) >= 2 * dev_height)
+        reduce++;
+
+    return reduce;
+}
+
+/* Open the filter chain which decodes the data of an image */
+static int
+pdfi_image_open_data(pdf_context *ctx, pdf_stream *image_stream, pdf_c_stream *source,
+                     gs_offset_t stream_offset, bool inline_image,
+                     pdf_c_stream **SFD_stream, pdf_c_stream **new_stream)
+{
+    int code;
+
+    if (!inline_image) {
+        pdfi_seek(ctx, source, stream_offset, SEEK_SET);
+
+        code = pdfi_apply_SubFileDecode_filter(ctx, 0, "endstream", source, SFD_stream, false);
+        if (code < 0)
+            return code;
+        source = *SFD_stream;
+    }
+
+    return pdfi_filter(ctx, image_stream, source, new_stream, inline_image);
+}
+
 /* NOTE: "source" is the current input stream.
  * on exit:
  *  inline_image = TRUE, stream it will point to after the image data.
@@ -1678,6 +1887,8 @@ pdfi_do_image(pdf_context *ctx, pdf_dict *page_dict, pdf_dict *stream_dict, pdf_
     gs_offset_t stream_offset;
     float save_strokeconstantalpha = 0.0f, save_fillconstantalpha = 0.0f;
     int trans_required;
+    pdf_image_cache_entry *cache_entry = NULL;
+    uint64_t image_size = 0;
 
 #if DEBUG_IMAGES
     dbgmprintf(ctx->memory, "pdfi_do_image BEGIN\n");
@@ -2044,17 +2255,45 @@ pdfi_do_image(pdf_context *ctx, pdf_dict *page_dict, pdf_dict *stream_dict, pdf_
     }
     /* Setup the data stream for the image data */
     if (!inline_image) {
-        pdfi_seek(ctx, source, stream_offset, SEEK_SET);
-
-        code = pdfi_apply_SubFileDecode_filter(ctx, 0, "endstream", source, &SFD_stream, false);
+        image_size = pdfi_get_image_data_size((gs_data_image_t *)pim, comps);
+        cache_entry = pdfi_image_cache_find(ctx, image_stream, stream_offset, image_size);
+    }
+    if (cache_entry != NULL && cache_entry->data != NULL) {
+        code = pdfi_open_memory_stream_from_memory(ctx, (unsigned int)cache_entry->size,
+                                                   cache_entry->data, &new_stream, true);
+        if (code < 0)
+            goto cleanupExit;
+    } else {
+        /* Don't keep reduced resolution data in the cache */
+        if (cache_entry == NULL && !inline_image)
+            ctx->image_reduce = pdfi_image_reduce(ctx, &image_info, pcs);
+        code = pdfi_image_open_data(ctx, image_stream, source, stream_offset, inline_image,
+                                    &SFD_stream, &new_stream);
+        ctx->image_reduce = 0;
         if (code < 0)
             goto cleanupExit;
-        source = SFD_stream;
-    }
 
-    code = pdfi_filter(ctx, image_stream, source, &new_stream, inline_image);
-    if (code < 0)
-        goto cleanupExit;
+        if (cache_entry != NULL) {
+            /* Second time we've seen this image, keep the decoded data */
+            code = pdfi_image_cache_fill(ctx, cache_entry, image_size, &new_stream);
+            if (code < 0)
+                goto cleanupExit;
+            if (code == 0) {
+                cache_entry = NULL;
+                if (new_stream == NULL) {
+                    /* The data was consumed, start again */
+                    pdfi_close_file(ctx, SFD_stream);
+                    SFD_stream = NULL;
+                    code = pdfi_image_open_data(ctx, image_stream, source, stream_offset,
+                                                inline_image, &SFD_stream, &new_stream);
+                    if (code < 0)
+                        goto cleanupExit;
+                }
+            }
+        }
+    }
+    if (cache_entry != NULL)
+        cache_entry->in_use++;
 
     /* This duplicates the code in gs_img.ps; if we have an imagemask, with 1 bit per component (is there any other kind ?)
      * and the image is to be interpolated, and we are nto sending it to a high level device. Then check the scaling.
@@ -2168,6 +2407,8 @@ pdfi_do_image(pdf_context *ctx, pdf_dict *page_dict, pdf_dict *stream_dict, pdf_
         pdfi_close_file(ctx, new_stream);
     if (SFD_stream)
         pdfi_close_file(ctx, SFD_stream);
+    if (cache_entry != NULL && cache_entry->in_use > 0)
+        cache_entry->in_use--;
     if (mask_buffer)
         gs_free_object(ctx->memory, mask_buffer, "pdfi_do_image (mask_buffer)");
 
@@ -26,5 +26,6 @@ int pdfi_do_highlevel_form(pdf_context *ctx, pdf_dict *page_dict, pdf_stream *fo
 int pdfi_do_image_or_form(pdf_context *ctx, pdf_dict *stream_dict, pdf_dict *page_dict, pdf_obj *xobject_obj);
 int pdfi_form_execgroup(pdf_context *ctx, pdf_dict *page_dict, pdf_stream *xobject_dict,
                         gs_gstate *GroupGState, gs_color_space *pcs, gs_client_color *pcc, gs_matrix *matrix);
+void pdfi_image_cache_free(pdf_context *ctx);
 
 #endif
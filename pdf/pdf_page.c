@@ -785,41 +785,50 @@ page_error:
 
 /* Find the page number that corresponds to a page dictionary
  * Uses page_array cache to minimize the number of times a page_dict needs to
- * be fetched, because this is expensive.
+ * be fetched, because this is expensive. We first look for the page among the
+ * pages already cached, and then only fetch the uncached pages before it (or
+ * all of them if it wasn't found), so that we return the first matching page.
  */
 int pdfi_page_get_number(pdf_context *ctx, pdf_dict *target_dict, uint64_t *page_num)
 {
-    uint64_t i;
+    uint64_t i, found;
     int code = 0;
     pdf_dict *page_dict = NULL;
     uint32_t object_num;
 
-    for (i=0; i<ctx->num_pages; i++) {
+    /* A zero entry means the page isn't cached, so can't be used to find a direct object */
+    found = ctx->num_pages;
+    if (target_dict->object_num != 0) {
+        for (found = 0; found < ctx->num_pages; found++) {
+            if (ctx->page_array[found] == target_dict->object_num)
+                break;
+        }
+    }
+
+    for (i=0; i<found; i++) {
         /* If the page has been processed before, then its object_num should already
-         * be cached in the page_array, so check that first
+         * be cached in the page_array, in which case we know it isn't the target.
          */
+        if (ctx->page_array[i] != 0)
+            continue;
+        /* It wasn't cached, so this will cache it */
+        code = pdfi_page_get_dict(ctx, i, &page_dict);
+        pdfi_countdown(page_dict);
+        page_dict = NULL;
+        if (code < 0)
+            continue;
         object_num = ctx->page_array[i];
-        if (object_num == 0) {
-            /* It wasn't cached, so this will cache it */
-            code = pdfi_page_get_dict(ctx, i, &page_dict);
-            if (code < 0)
-                continue;
-            object_num = ctx->page_array[i];
-        }
         if (target_dict->object_num == object_num) {
             *page_num = i;
-            goto exit;
+            return 0;
         }
-
-        pdfi_countdown(page_dict);
-        page_dict = NULL;
     }
 
-    code = gs_note_error(gs_error_undefined);
-
- exit:
-    pdfi_countdown(page_dict);
-    return code;
+    if (found < ctx->num_pages) {
+        *page_num = found;
+        return 0;
+    }
+    return_error(gs_error_undefined);
 }
 
 static void release_page_DefaultSpaces(pdf_context *ctx)
@@ -81,6 +81,50 @@ static int pdfi_repair_add_object(pdf_context *ctx, int64_t obj, int64_t gen, gs
     return 0;
 }
 
+/* Skip the data of a stream, up to and including the next 'endstream'.
+ * This is where almost all the time goes when repairing a large file, so
+ * rather than reading a byte at a time we search the stream buffer directly
+ * for the next 'e' whenever we aren't part way through a match. The match
+ * itself is done exactly as before, a byte at a time.
+ * Returns 0 if the keyword was found or we reached EOF, ERRC on error.
+ */
+static int pdfi_repair_skip_stream_data(pdf_context *ctx, pdf_c_stream *s)
+{
+    static const char test[] = "endstream";
+    int index = 0;
+
+    do {
+        int c;
+
+        if (index == 0 && s->unread_size == 0 && !s->eof) {
+            const byte *p = sbufptr(s->s);
+            uint avail = sbufavailable(s->s);
+            const byte *e = memchr(p, test[0], avail);
+
+            if (e == NULL) {
+                (void)sbufskip(s->s, avail);
+            } else {
+                (void)sbufskip(s->s, e - p + 1);
+                index = 1;
+            }
+            if (avail != 0)
+                continue;
+        }
+        c = pdfi_read_byte(ctx, s);
+        if (c == EOFC)
+            break;
+        if (c < 0)
+            return c;
+        if (c == test[index])
+            index++;
+        else if (c == test[0]) /* Pesky 'e' appears twice */
+            index = 1;
+        else
+            index = 0;
+    } while (index < 9);
+    return 0;
+}
+
 int pdfi_repair_file(pdf_context *ctx)
 {
     int code = 0;
@@ -229,22 +273,8 @@ int pdfi_repair_file(pdf_context *ctx)
                                     break;
                                 } else {
                                     if (k == PDF_TOKEN_AS_OBJ(TOKEN_STREAM)) {
-                                        static const char test[] = "endstream";
-                                        int index = 0;
-
-                                        do {
-                                            int c = pdfi_read_byte(ctx, ctx->main_stream);
-                                            if (c == EOFC)
-                                                break;
-                                            if (c < 0)
-                                                goto exit;
-                                            if (c == test[index])
-                                                index++;
-                                            else if (c == test[0]) /* Pesky 'e' appears twice */
-                                                index = 1;
-                                            else
-                                                index = 0;
-                                        } while (index < 9);
+                                        if (pdfi_repair_skip_stream_data(ctx, ctx->main_stream) < 0)
+                                            goto exit;
                                         do {
                                             code = pdfi_read_bare_keyword(ctx, ctx->main_stream);
                                             if (code == gs_error_VMerror || code == gs_error_ioerror)
@@ -217,6 +217,20 @@ typedef struct pdf_obj_cache_entry_s {
     pdf_obj *o;
 }pdf_obj_cache_entry;
 
+/* An entry in the decoded image cache, see pdf_image.c. 'data' is NULL
+ * until the image has been drawn a second time.
+ */
+typedef struct pdf_image_cache_entry_s {
+    void *next;
+    void *previous;
+    uint32_t object_num;
+    uint32_t generation_num;
+    gs_offset_t stream_offset;
+    byte *data;
+    uint64_t size;
+    int in_use;
+}pdf_image_cache_entry;
+
 /* The compressed and uncompressed xref entries are identical, they only differ
  * in the names used for the variables. Its simply less confusing not to overload
  * the names.
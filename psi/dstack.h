@@ -68,6 +68,8 @@
 #define dict_find_name(pnref) dict_find_name_by_index(name_index(imemory, pnref))
 #define dict_find_name_by_index_inline(nidx, htemp)\
   dstack_find_name_by_index_inline(&idict_stack, nidx, htemp)
+#define dict_find_name_cached(pname, nidx)\
+  dstack_find_name_cached(&idict_stack, pname, nidx)
 #define if_dict_find_name_by_index_top(nidx, htemp, pvslot)\
   if_dstack_find_name_by_index_top(&idict_stack, nidx, htemp, pvslot)
 
@@ -109,6 +111,13 @@ Each name N has a pointer N.V that has one of 3 states:
         In this case, N.V points to the value slot.
         - This name has some other status.
 
+Each name N also has a lookup cache N.C, holding the value pointer found
+by the last full lookup of N on the dictionary stack and the generation
+G of the stack at that time.  The interpreter uses N.C when N.V can't be
+used and G is still current.  The stack's generation changes on begin,
+end, restore, garbage collection, and anything else that calls
+dstack_set_top; adding or removing N in any dictionary invalidates N.C.
+
 We cache some pointers to the top dictionary on the stack if it is a
 readable dictionary with packed keys, which allows us to do fast,
 single-probe lookups in this dictionary.  We also cache a value that
@@ -134,6 +134,7 @@ context_state_alloc(gs_context_state_t ** ppcst,
     pcst->dict_stack.system_dict = *psystem_dict;
     pcst->dict_stack.min_size = 0;
     pcst->dict_stack.userdict_index = 0;
+    pcst->dict_stack.lookup_gen = 1;
     pcst->pgs = int_gstate_alloc(dmem);
     if (pcst->pgs == 0) {
         code = gs_note_error(gs_error_VMerror);
@@ -145,6 +146,10 @@ context_state_alloc(gs_context_state_t ** ppcst,
     pcst->nv_page_count = 0;
     pcst->rand_state = rand_state_initial;
     pcst->usertime_inited = false;
+    pcst->reclaim_stats.count = 0;
+    pcst->reclaim_stats.time = 0;
+    pcst->reclaim_stats.max_time = 0;
+    pcst->reclaim_stats.last_time = 0;
     pcst->plugin_list = 0;
     make_t(&pcst->error_object, t__invalid);
     {	/*
@@ -41,6 +41,13 @@ struct gs_context_state_s {
     long rand_state;		/* (not in Red Book) */
     long usertime_0[2];         /* initial value first time usertime was called */
     bool usertime_inited;       /* has usertime been called yet? */
+    /* Garbage collection pause statistics, in milliseconds. */
+    struct {
+        long count;		/* number of collections */
+        long time;		/* total time spent collecting */
+        long max_time;		/* longest single collection */
+        long last_time;		/* most recent collection */
+    } reclaim_stats;
     /* View clipping is handled in the graphics state. */
     ref error_object;		/* t__invalid or error object from operator */
     ref userparams;		/* t_dictionary */
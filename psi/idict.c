@@ -525,6 +525,8 @@ dict_put(ref * pdref /* t_dictionary */ , const ref * pkey, const ref * pvalue,
                 if_debug0m('d', (const gs_memory_t *)mem, "[d]no cache\n");
                 pname->pvalue = pv_other;
             }
+            /* The name may now be found in a different dictionary. */
+            pname->lookup_gen = 0;
         }
         rcode = 1;
     }
@@ -582,6 +584,7 @@ dict_undef(ref * pdref, const ref * pkey, dict_stack_t *pds)
     ref *pvslot;
     dict *pdict;
     uint index;
+    name *pkname = 0;
     int code = dict_find(pdref, pkey, &pvslot);
 
     switch (code) {
@@ -604,6 +607,12 @@ dict_undef(ref * pdref, const ref * pkey, dict_stack_t *pds)
         if_debug3m('d', (const gs_memory_t *)mem,
                    "[d]"PRI_INTPTR": removing key at "PRI_INTPTR": 0x%x\n",
                    (intptr_t)pdict, (intptr_t)pkp, (uint)*pkp);
+        if (r_packed_is_name(pkp)) {
+            ref key;
+
+            packed_get((const gs_memory_t *)mem, pkp, &key);
+            pkname = key.value.pname;
+        }
         /* See the initial comment for why it is safe not to save */
         /* the change if the keys array itself is new. */
         if (must_save)
@@ -639,6 +648,8 @@ dict_undef(ref * pdref, const ref * pkey, dict_stack_t *pds)
         if_debug4m('d', (const gs_memory_t *)mem,
                    "[d]"PRI_INTPTR": removing key at "PRI_INTPTR": 0x%lx 0x%lx\n",
                    (intptr_t)pdict, (intptr_t)kp, ((ulong *)kp)[0], ((ulong *)kp)[1]);
+        if (r_has_type(kp, t_name))
+            pkname = kp->value.pname;
         make_null_old_in(mem, &pdict->keys, kp, "dict_undef(key)");
         /*
          * Accumulating deleted entries slows down lookup.
@@ -668,6 +679,9 @@ dict_undef(ref * pdref, const ref * pkey, dict_stack_t *pds)
             pname->pvalue = pv_no_defn;
         }
     }
+    /* The name may now be found in a different dictionary, or not at all. */
+    if (pkname != 0)
+        pkname->lookup_gen = 0;
     make_null_old_in(mem, &pdict->values, pvslot, "dict_undef(value)");
     return 0;
 }
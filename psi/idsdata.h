@@ -61,6 +61,14 @@ struct dict_stack_s {
     uint top_npairs;
     ref *top_values;
 
+/*
+ * The generation for the name lookup caches (see inamedef.h).
+ * dstack_set_top increments it, so it changes whenever the stack changes,
+ * after a restore or a garbage collection, and when a dictionary's values
+ * may have moved.  It is never 0.
+ */
+    uint lookup_gen;
+
 /*
  * Cache a copy of the bottom entry on the stack, which is never deleted.
  */
@@ -201,6 +201,24 @@ dstack_find_name_by_index(dict_stack_t * pds, uint nidx)
 #undef hash
 }
 
+/*
+ * Look up a name on the dictionary stack, and remember the result in the
+ * name's lookup cache.  dstack_find_name_cached calls this when the cache
+ * isn't valid.
+ */
+ref *
+dstack_find_name_and_cache(dict_stack_t * pds, name * pname, uint nidx)
+{
+    uint htemp;
+    ref *pvalue = dstack_find_name_by_index_inline(pds, nidx, htemp);
+
+    if (pvalue != 0) {
+        pname->lookup_value = pvalue;
+        pname->lookup_gen = pds->lookup_gen;
+    }
+    return pvalue;
+}
+
 /* Set the cached values computed from the top entry on the dstack. */
 /* See idstack.h for details. */
 static const ref_packed no_packed_keys[2] =
@@ -227,6 +245,12 @@ dstack_set_top(dict_stack_t * pds)
         pds->def_space = -1;
     else
         pds->def_space = r_space(dsp);
+    /* Invalidate all the name lookup caches. */
+    if (++pds->lookup_gen == 0) {
+        /* Don't let old cache entries become valid again. */
+        names_clear_lookup_caches(dict_mem(pdict)->gs_lib_ctx->gs_name_table);
+        pds->lookup_gen = 1;
+    }
 }
 
 /* After a garbage collection, scan the permanent dictionaries and */
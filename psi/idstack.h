@@ -49,6 +49,14 @@ ref *dstack_find_name_by_index(dict_stack_t *, uint);
   ((pds)->top_keys[htemp = dict_hash_mod_inline(dict_name_index_hash(nidx),\
      (pds)->top_npairs) + 1] == pt_tag(pt_literal_name) + (nidx) ?\
    (pds)->top_values + htemp : dstack_find_name_by_index(pds, nidx))
+/*
+ * Define a macro for name lookup that checks the name's own lookup cache
+ * first, and fills it in if the name isn't in the cache.
+ */
+ref *dstack_find_name_and_cache(dict_stack_t *, name *, uint);
+#define dstack_find_name_cached(pds,pname,nidx)\
+  ((pname)->lookup_gen == (pds)->lookup_gen ? (pname)->lookup_value :\
+   dstack_find_name_and_cache(pds, pname, nidx))
 /*
  * Define a similar macro that only checks the top dictionary on the stack.
  */
@@ -453,6 +453,23 @@ run_stdin:
             } else if (strncmp(arg, "saved-pages-test", 16) == 0) {
                 minst->saved_pages_test_mode = true;
                 break;
+            } else if (strcmp(arg, "mmap") == 0) {
+                minst->heap->gs_lib_ctx->core->mmap_files = 1;
+                break;
+            } else if (strcmp(arg, "no-mmap") == 0) {
+                minst->heap->gs_lib_ctx->core->mmap_files = 0;
+                break;
+            } else if (strncmp(arg, "readahead=", 10) == 0) {
+                uint size;
+
+                if (sscanf((const char *)arg + 10, "%u", &size) != 1) {
+                    outprintf(minst->heap,
+                              "--readahead= must be followed by a size in bytes\n");
+                    arg_finit(pal);
+                    return gs_error_Fatal;
+                }
+                minst->heap->gs_lib_ctx->core->readahead_size = size;
+                break;
             /* Now handle the explicitly added paths to the file control lists */
             } else if (arg_match(&arg, "permit-file-read")) {
                 code = gs_add_explicit_control_path(minst->heap, arg, gs_permit_file_reading);
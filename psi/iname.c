@@ -121,6 +121,7 @@ names_init(ulong count, gs_ref_memory_t *imem)
         pnstr->foreign_string = 1;
         pnstr->mark = 1;
         pname->pvalue = pv_no_defn;
+        pname->lookup_gen = 0;
     }
     nt->perm_count = NT_1CHAR_FIRST + NT_1CHAR_SIZE;
     /* Reconstruct the free list. */
@@ -231,6 +232,7 @@ names_ref(name_table *nt, const byte *ptr, uint size, ref *pref, int enterflag)
     pnstr->string_size = size;
     pname = name_index_ptr_inline(nt, nidx);
     pname->pvalue = pv_no_defn;
+    pname->lookup_gen = 0;
     nt->free = name_next_index(nidx, pnstr);
     set_name_next_index(nidx, pnstr, *phash);
     *phash = nidx;
@@ -283,6 +285,21 @@ names_invalidate_value_cache(name_table * nt, const ref * pnref)
     pnref->value.pname->pvalue = pv_other;
 }
 
+/* Invalidate the dictionary stack lookup caches of all names. */
+void
+names_clear_lookup_caches(name_table * nt)
+{
+    uint i, j;
+
+    for (i = 0; i < nt->sub_count; ++i) {
+        name_sub_table *sub = nt->sub[i].names;
+
+        if (sub != 0)
+            for (j = 0; j < nt_sub_size; ++j)
+                sub->names[j].lookup_gen = 0;
+    }
+}
+
 /* Convert between names and indices. */
 #undef names_index
 name_index_t
@@ -65,6 +65,15 @@ struct name_s {
 #define pv_valid(pvalue) ((uintptr_t)(pvalue) > 1)
     ref *pvalue;		/* if only defined in systemdict or */
                                 /* userdict, this points to the value */
+/*
+ * lookup_value caches the result of the last lookup of the name on the
+ * dictionary stack.  It is valid only while lookup_gen is equal to the
+ * lookup_gen of the dictionary stack (see idsdata.h), which changes
+ * whenever the stack does.  Adding or removing the name in any dictionary
+ * resets lookup_gen to 0, which is never valid.
+ */
+    ref *lookup_value;
+    uint lookup_gen;
 };
 
 /*typedef struct name_s name; *//* in iref.h */
@@ -129,7 +129,7 @@ struct stats_interp_s {
     long find_name, name_lit, name_proc, name_oparray, name_operator;
     long p_full, p_exec_operator, p_exec_oparray, p_exec_non_x_operator,
         p_integer, p_lit_name, p_exec_name;
-    long p_find_name, p_name_lit, p_name_proc;
+    long p_find_name, p_name_lit, p_name_proc, p_name_operator;
 } stats_interp;
 # define INCR(v) (++(stats_interp.v))
 #else
@@ -1011,7 +1011,8 @@ interp(/* lgtm [cpp/use-of-goto] */
  * occurs, so as not to slow down the non-error case.
  */
 #define return_with_error_tx_op(err_code)\
-  { if (r_has_type(IREF, t_name)) {\
+  { if (r_is_packed(iref_packed) ? r_packed_is_name(iref_packed) :\
+        r_has_type(IREF, t_name)) {\
         return_with_error(err_code, pvalue);\
     } else {\
         return_with_error_iref(err_code);\
@@ -1406,10 +1407,9 @@ remap:              if (iesp + 2 >= estop) {
             pvalue = IREF->value.pname->pvalue;
             if (!pv_valid(pvalue)) {
                 uint nidx = names_index(int_nt, IREF);
-                uint htemp = 0;
 
                 INCR(find_name);
-                if ((pvalue = dict_find_name_by_index_inline(nidx, htemp)) == 0)
+                if ((pvalue = dict_find_name_cached(IREF->value.pname, nidx)) == 0)
                     return_with_error_iref(gs_error_undefined);
             }
             /* Dispatch on the type of the value. */
@@ -1798,13 +1798,12 @@ remap:              if (iesp + 2 >= estop) {
                         INCR(p_exec_name);
                         {
                             uint nidx = *iref_packed & packed_value_mask;
+                            name *pname = name_index_ptr_inline(int_nt, nidx);
 
-                            pvalue = name_index_ptr_inline(int_nt, nidx)->pvalue;
+                            pvalue = pname->pvalue;
                             if (!pv_valid(pvalue)) {
-                                uint htemp = 0;
-
                                 INCR(p_find_name);
-                                if ((pvalue = dict_find_name_by_index_inline(nidx, htemp)) == 0) {
+                                if ((pvalue = dict_find_name_cached(pname, nidx)) == 0) {
                                     names_index_ref(int_nt, nidx, &token);
                                     return_with_error(gs_error_undefined, &token);
                                 }
@@ -1823,6 +1822,70 @@ remap:              if (iesp + 2 >= estop) {
                                 store_state_short(iesp);
                                 goto pr;
                             }
+                            /*
+                             * Call operators without reinterpreting them, so
+                             * that names in unbound procedures don't need a
+                             * trip through the e-stack.  We store the state
+                             * first, and leave things as reinterpretation
+                             * would if there is an error.
+                             */
+                            switch (r_type_xe(pvalue)) {
+#if PACKED_SPECIAL_OPS
+                                case plain_exec(tx_op_add):
+                                    goto x_add;
+                                case plain_exec(tx_op_def):
+                                    goto x_def;
+                                case plain_exec(tx_op_dup):
+                                    goto x_dup;
+                                case plain_exec(tx_op_exch):
+                                    goto x_exch;
+                                case plain_exec(tx_op_if):
+                                    goto x_if;
+                                case plain_exec(tx_op_ifelse):
+                                    goto x_ifelse;
+                                case plain_exec(tx_op_index):
+                                    goto x_index;
+                                case plain_exec(tx_op_pop):
+                                    goto x_pop;
+                                case plain_exec(tx_op_roll):
+                                    goto x_roll;
+                                case plain_exec(tx_op_sub):
+                                    goto x_sub;
+#endif
+                                case plain_exec(t_operator):
+                                    INCR(p_name_operator);
+                                    --(*ticks_left);
+                                    store_state_short(iesp);
+                                    esp = iesp;
+                                    osp = iosp;
+                                    switch (code = call_operator(real_opproc(pvalue),
+                                                                 i_ctx_p)) {
+                                        case 0:
+                                        case 1:
+                                            iosp = osp;
+                                            next_short();
+                                        case o_push_estack:
+                                            goto opush;
+                                        case o_pop_estack:
+                                            iosp = osp;
+                                            if (esp == iesp) {
+                                                next_short();
+                                            }
+                                            iesp = esp;
+                                            goto up;
+                                        case gs_error_Remap_Color:
+                                            icount = 0;
+                                            SET_IREF(pvalue);
+                                            goto remap;
+                                    }
+                                    iosp = osp;
+                                    iesp = esp;
+                                    icount = 0;
+                                    SET_IREF(pvalue);
+                                    return_with_code_iref();
+                                default:
+                                    break;
+                            }
                             /* Not a literal or procedure, reinterpret it. */
                             store_state_short(iesp);
                             icount = 0;
@@ -16,6 +16,7 @@
 
 /* Interpreter's interface to garbage collector */
 #include "ghost.h"
+#include "gp.h"			/* for gp_get_realtime */
 #include "ierrors.h"
 #include "gsstruct.h"
 #include "iastate.h"
@@ -113,9 +114,11 @@ gs_vmreclaim(gs_dual_memory_t *dmem, bool global)
     gs_ref_memory_t *memories[5];
     gs_ref_memory_t *mem;
     int nmem, i;
+    long t0[2], t1[2], ms;
 
     if (code < 0)
         return code;
+    gp_get_realtime(t0);
 
     memories[0] = dmem->space_system;
     memories[1] = mem = dmem->space_global;
@@ -188,7 +191,21 @@ gs_vmreclaim(gs_dual_memory_t *dmem, bool global)
        we would lose those allocations when the clumps were opened */
 
     code = context_state_load(i_ctx_p);
-    return code;
+    if (code < 0)
+        return code;
+
+    /* Record the pause time, now that i_ctx_p is final. */
+
+    gp_get_realtime(t1);
+    ms = (t1[0] - t0[0]) * 1000 + (t1[1] - t0[1]) / 1000000;
+    if (ms < 0)
+        ms = 0;
+    i_ctx_p->reclaim_stats.count++;
+    i_ctx_p->reclaim_stats.time += ms;
+    i_ctx_p->reclaim_stats.last_time = ms;
+    if (ms > i_ctx_p->reclaim_stats.max_time)
+        i_ctx_p->reclaim_stats.max_time = ms;
+    return 0;
 }
 
 /* ------ Initialization procedure ------ */
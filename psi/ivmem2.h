@@ -24,5 +24,6 @@
 /* Exported by zvmem2.c for zusparam.c */
 int set_vm_reclaim(i_ctx_t *, long);
 int set_vm_threshold(i_ctx_t *, int64_t);
+int set_vm_threshold_percent(i_ctx_t *, long);
 
 #endif /* ivmem2_INCLUDED */
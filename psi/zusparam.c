@@ -231,6 +231,27 @@ current_PageCount(i_ctx_t *i_ctx_p)
     return 1000 + i_ctx_p->nv_page_count; /* Add 1000 to imitate NV memory */
 }
 
+static long
+current_VMReclaimCount(i_ctx_t *i_ctx_p)
+{
+    return i_ctx_p->reclaim_stats.count;
+}
+static long
+current_VMReclaimTime(i_ctx_t *i_ctx_p)
+{
+    return i_ctx_p->reclaim_stats.time;
+}
+static long
+current_VMReclaimMaxTime(i_ctx_t *i_ctx_p)
+{
+    return i_ctx_p->reclaim_stats.max_time;
+}
+static long
+current_VMReclaimLastTime(i_ctx_t *i_ctx_p)
+{
+    return i_ctx_p->reclaim_stats.last_time;
+}
+
 static const size_t_param_def_t system_size_t_params[] =
 {
     /* Extensions */
@@ -243,7 +264,11 @@ static const long_param_def_t system_long_params[] =
     {"MaxFontCache", 0, MAX_UINT_PARAM, current_MaxFontCache, set_MaxFontCache},
     {"CurFontCache", 0, MAX_UINT_PARAM, current_CurFontCache, NULL},
     {"Revision", min_long, max_long, current_Revision, NULL},
-    {"PageCount", min_long, max_long, current_PageCount, NULL}
+    {"PageCount", min_long, max_long, current_PageCount, NULL},
+    {"VMReclaimCount", 0, max_long, current_VMReclaimCount, NULL},
+    {"VMReclaimTime", 0, max_long, current_VMReclaimTime, NULL},
+    {"VMReclaimMaxTime", 0, max_long, current_VMReclaimMaxTime, NULL},
+    {"VMReclaimLastTime", 0, max_long, current_VMReclaimLastTime, NULL}
 };
 
 /* Boolean values */
@@ -469,6 +494,14 @@ current_VMThreshold(i_ctx_t *i_ctx_p)
     return stat.vm_threshold;
 }
 static long
+current_VMThresholdPercent(i_ctx_t *i_ctx_p)
+{
+    gs_memory_gc_status_t stat;
+
+    gs_memory_gc_status(iimemory_local, &stat);
+    return stat.threshold_percent;
+}
+static long
 current_WaitTimeout(i_ctx_t *i_ctx_p)
 {
     return 0;
@@ -636,6 +669,8 @@ static const long_param_def_t user_long_params[] =
      current_MaxExecStack, set_MaxExecStack},
     {"VMReclaim", -2, 0,
      current_VMReclaim, set_vm_reclaim},
+    {"VMThresholdPercent", 0, MAX_VM_THRESHOLD_PERCENT,
+     current_VMThresholdPercent, set_vm_threshold_percent},
     {"WaitTimeout", 0, MAX_UINT_PARAM,
      current_WaitTimeout, set_WaitTimeout},
     /* Extensions */
@@ -102,6 +102,17 @@ set_vm_reclaim(i_ctx_t *i_ctx_p, long val)
         return_error(gs_error_rangecheck);
 }
 
+int
+set_vm_threshold_percent(i_ctx_t *i_ctx_p, long val)
+{
+    if (val < 0 || val > MAX_VM_THRESHOLD_PERCENT)
+        return_error(gs_error_rangecheck);
+    gs_memory_set_vm_threshold_percent(idmemory->space_system, (int)val);
+    gs_memory_set_vm_threshold_percent(idmemory->space_global, (int)val);
+    gs_memory_set_vm_threshold_percent(idmemory->space_local, (int)val);
+    return 0;
+}
+
 /*
  * <int> .vmreclaim -
  *